@@ -0,0 +1,100 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <filesystem>
+#include <vector>
+#include "src/io/io_fb.h"
+using namespace io_fb;
+#include "src/filemanager/filemanager.h"
+
+#pragma region Exit Codes
+//Exit codes, same meaning as fsck(8) ones: no problems, problems fixed, problems left, operational error.
+#define FSCK_CLEAN 0
+#define FSCK_REPAIRED 1
+#define FSCK_UNCORRECTED 4
+#define FSCK_FAILED 8
+#pragma endregion
+#pragma region Report
+/**
+ * @brief Print usage.
+ * @param program Program name.
+**/
+void PrintUsage(const char* program){
+    cout << "Usage: " << program << " [--check-only | --repair] [--orphans=keep|restore|delete] [--jobs N]\n";
+    cout << "Checks the data folder of the current directory without asking anything.\n";
+    cout << "--check-only (default) reports what would be changed, --repair changes it.\n";
+    return;
+}
+/**
+ * @brief Print a files check report, one tab-separated record per line:
+ * issue <user> <action> <path>; upkeep <user> <action> <path>; error <user> <error code>; summary <mode> <users> <issues> <upkeep> <errors>.
+ * Data folder records use "-" as user. Upkeep (derived files rebuilt, default schema written) is not a problem and does not change the exit code.
+ * @param results Files check results.
+ * @param check_only 1 if it was a check only run.
+ * @returns Exit code.
+**/
+int PrintReport(const vector<filemanager::s_check_result>& results, const bool check_only){
+    size_t issues = 0, upkeep = 0, kept = 0, errors = 0;
+    for (const filemanager::s_check_result& result : results){
+        string user = result.user.empty() ? "-" : result.user;
+        for (const filemanager::s_check_issue& issue : result.issues){
+            cout << (issue.upkeep ? "upkeep\t" : "issue\t") << user << '\t' << issue.action << '\t' << issue.path.string() << '\n';
+            if (issue.upkeep){
+                upkeep++;
+                continue;
+            }
+            issues++;
+            kept += issue.action == "orphan" || issue.action == "quarantine";
+        }
+        if (result.status != EC_None){
+            cout << "error\t" << user << '\t' << (int)result.status << '\n';
+            errors++;
+        }
+    }
+    cout << "summary\tmode=" << (check_only ? "check" : "repair") << "\tusers=" << (results.empty() ? 0 : results.size() - 1);
+    cout << "\tissues=" << issues << "\tupkeep=" << upkeep << "\terrors=" << errors << '\n';
+    //Kept orphan folders and quarantined files are not fixed, even on repair runs.
+    if (errors != 0 || kept != 0 || (check_only && issues != 0)){
+        return FSCK_UNCORRECTED;
+    }
+    return issues != 0 ? FSCK_REPAIRED : FSCK_CLEAN;
+}
+#pragma endregion
+
+int main(int argc, char* argv[]) {
+    //Parse arguments
+    filemanager::s_check_options options = {1, filemanager::OP_Keep, 0};
+    bool mode_set = 0;
+    for (int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if ((arg == "--check-only" || arg == "--repair") && !mode_set){
+            options.check_only = arg == "--check-only";
+            mode_set = 1;
+        }
+        else if (arg == "--orphans=keep"){
+            options.orphans = filemanager::OP_Keep;
+        }
+        else if (arg == "--orphans=restore"){
+            options.orphans = filemanager::OP_Restore;
+        }
+        else if (arg == "--orphans=delete"){
+            options.orphans = filemanager::OP_Delete;
+        }
+        else if (arg == "--jobs" && i + 1 < argc && strings::IsNumericStr(argv[i + 1], Mode_UIntLong) && string(argv[i + 1]).length() < 5){
+            options.jobs = stoul(argv[++i]);
+        }
+        else {
+            PrintUsage(argv[0]);
+            return FSCK_FAILED;
+        }
+    }
+    //Check files
+    vector<filemanager::s_check_result> results;
+    ErrorCode ec = filemanager::CheckFiles(options, results);
+    int exit_code = PrintReport(results, options.check_only);
+    if (ec != EC_None){
+        cerr << "Files check failed (error " << (int)ec << ").\n";
+        return FSCK_FAILED;
+    }
+    return exit_code;
+}
@@ -3,10 +3,128 @@ using namespace std;
 #include <string>
 #include <filesystem>
 #include <fstream>
+#include <map>
 #include "src/user/user.h"
 #include "src/filemanager/filemanager.h"
+#include "src/backup/backup.h"
+#include "src/persist/persist.h"
+#include "src/latency/latency.h"
+#include "src/profiler/profiler.h"
 
+#pragma region Latency
+//Slow operations log, outside the data folder (which only holds known files).
+#define slow_log_p "foodbook_slow.log"
+//If 1, a latency report is printed on exit and slow operations are logged (see ParseSessionOptions()).
+static bool c_latency_report = 0;
+static bool c_slow_log = 0;
+/**
+ * @brief Stop timing the running operation (see latency::Begin()). Slow operations are appended to the slow operations log, one tab-separated record per line:
+ * <epoch seconds> <operation> <total ms> <phase>=<ms>... (every phase, input included).
+ * @param op Operation that was timed.
+**/
+void EndOperation(const latency::operation op){
+    latency::s_sample sample;
+    if (!latency::End(op, sample) || !c_slow_log){
+        return;
+    }
+    ofstream log_out;
+    log_out.open(slow_log_p, ios_base::app);
+    if (!log_out.is_open()){
+        return;
+    }
+    log_out << chrono::system_clock::to_time_t(chrono::system_clock::now()) << '\t' << latency::GetOperationName(op) << '\t' << sample.total_us / 1000.0;
+    for (uint8_t i = 0; i < latency::PH_Count; i++){
+        log_out << '\t' << latency::GetPhaseName((latency::phase)i) << '=' << sample.phase_us[i] / 1000.0;
+    }
+    log_out << '\n';
+    log_out.close();
+    return;
+}
+/**
+ * @brief Print the latency of every timed operation (exit handler): count, p50, p99, p999 and max, in milliseconds.
+**/
+void PrintLatencyReport(){
+    cout << "\nLatency (ms)\tcount\tp50\tp99\tp999\tmax\n";
+    for (uint8_t i = 0; i < latency::OP_Count; i++){
+        const latency::histogram& h = latency::GetHistogram((latency::operation)i);
+        cout << latency::GetOperationName((latency::operation)i) << '\t' << h.Count() << '\t' << h.Percentile(50) / 1000.0 << '\t';
+        cout << h.Percentile(99) / 1000.0 << '\t' << h.Percentile(99.9) / 1000.0 << '\t' << h.Max() / 1000.0 << '\n';
+    }
+    return;
+}
+#pragma endregion
+#pragma region Startup Profile
+//Startup trace file (Chrome trace event format), outside the data folder.
+#define startup_trace_p "foodbook_startup.json"
+//If 1, the first initial files check is profiled. Result of writing its trace.
+static bool c_profile_startup = 0;
+static ErrorCode c_trace_ec = EC_None;
+/**
+ * @brief Print the startup profile (exit handler): time, files read, bytes read and repairs of every phase of the initial files check, and of every user folder.
+**/
+void PrintStartupProfile(){
+    vector<profiler::s_span> spans;
+    profiler::GetSpans(spans);
+    //Add up phases, and users (a user gets its folder span and everything nested into it)
+    profiler::s_span phases[profiler::SP_Count] = {};
+    uint64_t phase_spans[profiler::SP_Count] = {};
+    map<string, profiler::s_span> users;
+    for (const profiler::s_span& s : spans){
+        profiler::s_span* totals[2] = {&phases[s.phase], s.user.empty() ? NULL : &users[s.user]};
+        phase_spans[s.phase]++;
+        phases[s.phase].duration_us += s.duration_us;
+        for (profiler::s_span* t : totals){
+            if (t == NULL){
+                continue;
+            }
+            t->self_us += s.self_us;
+            t->files += s.files;
+            t->bytes += s.bytes;
+            t->repairs += s.repairs;
+        }
+    }
+    cout << "\nStartup profile\tspans\tms\tself ms\tfiles\tbytes\trepairs\n";
+    for (uint8_t i = 0; i < profiler::SP_Count; i++){
+        const profiler::s_span& t = phases[i];
+        cout << profiler::GetPhaseName((profiler::startup_phase)i) << '\t' << phase_spans[i] << '\t' << t.duration_us / 1000.0 << '\t' << t.self_us / 1000.0 << '\t';
+        cout << t.files << '\t' << t.bytes << '\t' << t.repairs << '\n';
+    }
+    cout << "\nUser\tms\tfiles\tbytes\trepairs\n";
+    for (const auto& [name, t] : users){
+        cout << name << '\t' << t.self_us / 1000.0 << '\t' << t.files << '\t' << t.bytes << '\t' << t.repairs << '\n';
+    }
+    if (c_trace_ec != EC_None){
+        cout << "\nTrace could not be written (error " << (int)c_trace_ec << ").\n";
+    }
+    else {
+        cout << "\nTrace written to " << startup_trace_p << ".\n";
+    }
+    return;
+}
+#pragma endregion
 #pragma region Welcome Menu
+/**
+ * @brief Asks the user what to do with the folder of an unregistered user (initial files check callback). If restored, the user is simply added to the user database.
+ * @param orphan_p Path to orphan folder.
+ * @returns filemanager::OP_Restore or filemanager::OP_Delete.
+ * @warning Exits the program if the user cancels.
+**/
+filemanager::orphan_policy JudgeOrphanFolder(const filesystem::path& orphan_p){
+    uint8_t num_input;
+    do {
+        ClearConsole;
+        //Print input
+        cout << "An unregistered user folder has been found.\n";
+        cout << "User: " << name::InFileNameToName(orphan_p.filename().string(), 2) << '\n';
+        cout << "Do you want to restore the user?\n";
+        cout << "1.Yes\n2.No, delete it.\n\n";
+        //Get input
+        if (!input::GetNumericInput(&num_input, Mode_UInt8)){
+            exit(0);
+        }
+    } while (num_input != 1 && num_input != 2);
+    return num_input == 1 ? filemanager::OP_Restore : filemanager::OP_Delete;
+}
 /**
  * @brief Asks the user for a valid username.
  * @param name Reference to a string that will contain the name.
@@ -127,7 +245,7 @@ void WelcomeMenu(user_lib::user& l_user){
             InvokeFatalError(ec, "MainMenu->NoUserFound->RegisterForm");
         }
         //Register user
-        ec = user_lib::RegisterNewUser(name);
+        ec = persist::RegisterUser(name);
         if (ec != EC_None){            
             InvokeFatalError(ec, "MainMenu->NoUserFound->RegisterNewUser");
         }
@@ -146,7 +264,9 @@ void WelcomeMenu(user_lib::user& l_user){
             input::GetNumericInput(&num_input, Mode_UInt8);
             //Log in
             if (num_input == 1){
+                latency::Begin();
                 ec = LogIn(l_user);
+                EndOperation(latency::OP_LogIn);
                 if (ec == EC_None){
                     break;
                 }
@@ -163,7 +283,7 @@ void WelcomeMenu(user_lib::user& l_user){
                 //If user name was successfully input, register it.
                 if (ec == EC_None){
                     //Register user
-                    ec = user_lib::RegisterNewUser(name);
+                    ec = persist::RegisterUser(name);
                     //Load user and break
                     if (ec == EC_None){
                         ec = l_user.LoadUser(name);
@@ -212,12 +332,13 @@ void FoodOptions(user_lib::user& l_user){
         cout << "2.Add new food\n";
         cout << "3.Remove food\n";
         cout << "4.Modify food\n";
+        cout << "5.Food book format\n";
         //Get user input
         if (!input::GetNumericInput(&num_input, Mode_UInt8)){
             break;
         }
         //If user input was valid
-        if (num_input > 0 && num_input < 5){
+        if (num_input > 0 && num_input < 6){
             //Enter selected mode
             switch (num_input){
                 //Consult food macros
@@ -237,7 +358,9 @@ void FoodOptions(user_lib::user& l_user){
                 //Register food
                 case 2: {
                     //Ask the user for a food name and register it.
+                    latency::Begin();
                     ec = l_user.RegisterFood();
+                    EndOperation(latency::OP_RegisterFood);
                     //If there was a problem
                     if (ec != EC_UserCancelled && ec != EC_None){
                         InvokeFatalError(ec, "MainMenu->FoodOptions->RegisterFood");
@@ -267,7 +390,9 @@ void FoodOptions(user_lib::user& l_user){
                 //Modify food
                 case 4: {
                     //We ask for a food name and return in case of user cancel or success
+                    latency::Begin();
                     ec = l_user.ModifyFood();
+                    EndOperation(latency::OP_ModifyFood);
                     //If food not found, we inform the user and break
                     if(ec == EC_ItemNotFound){
                         cout << "\nFood is not registered.\n";
@@ -279,6 +404,15 @@ void FoodOptions(user_lib::user& l_user){
                     }
                     break;
                 }
+                //Convert food book format
+                case 5: {
+                    ec = l_user.ConvertFoodBook();
+                    //If there was a problem
+                    if (ec != EC_UserCancelled && ec != EC_None){
+                        InvokeFatalError(ec, "MainMenu->FoodOptions->ConvertFoodBook");
+                    }
+                    break;
+                }
             }
             break;
         }
@@ -298,7 +432,7 @@ void MacrosOptions(user_lib::user& l_user){
         ClearConsole;
         cout << "Choose a time frame:\n\n";
         cout << "1.Today\n2.Current week\n3.Current month\n";
-        cout << "4.Current year\n5.History\n\n";
+        cout << "4.Current year\n5.History\n6.Top foods\n\n";
         //Get input
         if (!input::GetNumericInput(&num_input, Mode_UInt8)){
             break;
@@ -316,11 +450,21 @@ void MacrosOptions(user_lib::user& l_user){
         //History browser
         else if (num_input == 5){
             //Browse history
+            latency::Begin();
             ec = l_user.BrowseHistory();
+            EndOperation(latency::OP_BrowseHistory);
             //If there was an error, crash.
             if (ec != EC_None && ec != EC_UserCancelled){
                 InvokeFatalError(ec, "MainMenu->ConsultMacros->BrowseHistory");
             }
+        }
+        //Top foods report
+        else if (num_input == 6){
+            ec = l_user.PrintTopFoods();
+            //If there was an error, crash.
+            if (ec != EC_None && ec != EC_UserCancelled){
+                InvokeFatalError(ec, "MainMenu->ConsultMacros->PrintTopFoods");
+            }
         }    
     } while (true);
     return;
@@ -378,16 +522,210 @@ bool UserOptions(user_lib::user& l_user){
     return 0;
 }     
 #pragma endregion
+#pragma region Admin Commands
+/**
+ * @brief Runs an admin command given as program arguments, instead of the interactive menus. Supported commands: --backup-all <dir> [--jobs N] (backs up users.dat, nutrients.dat and every user folder, copying up to N users at once) and --compact-years (folds the past year folders of every user into compacted year files). Arguments are checked before anything is touched; then the data files are checked without asking anything (folders of unregistered users are kept) and the command runs.
+ * @param argc Argument count.
+ * @param argv Arguments.
+ * @returns Process exit code (0 on success).
+**/
+int AdminCommand(int argc, char* argv[]){
+    //Parse arguments
+    bool compact = argc == 2 && string(argv[1]) == "--compact-years";
+    string dir;
+    unsigned long jobs = 0;
+    for (int i = 1; i < argc && !compact; i++){
+        string arg = argv[i];
+        if (arg == "--backup-all" && i + 1 < argc){
+            dir = argv[++i];
+        }
+        else if (arg == "--jobs" && i + 1 < argc && strings::IsNumericStr(argv[i + 1], Mode_UIntLong) && string(argv[i + 1]).length() < 5){
+            jobs = stoul(argv[++i]);
+        }
+        else {
+            dir.clear();
+            break;
+        }
+    }
+    if (!compact && (dir.empty() || (argc > 3 && jobs == 0))){
+        cout << "Usage: " << argv[0] << " --backup-all <dir> [--jobs N] | --compact-years\n";
+        return 1;
+    }
+    //Check data files, without asking anything.
+    vector<filesystem::path> quarantined;
+    ErrorCode ec = filemanager::InitialFilesCheck(NULL, &quarantined);
+    if (ec != EC_None){
+        InvokeFatalError(ec, "AdminCommand->InitialFilesCheck");
+    }
+    for (filesystem::path& p : quarantined){
+        cout << "Corrupted file moved aside: " << p.string() << '\n';
+    }
+    //Compact past years of every user
+    if (compact){
+        vector<string> all_users;
+        ec = user_lib::GetAllUsers(all_users);
+        if (ec != EC_None && ec != EC_FileEmpty){
+            InvokeFatalError(ec, "AdminCommand->GetAllUsers");
+        }
+        size_t years = 0;
+        for (string& name : all_users){
+            size_t compacted;
+            ec = filemanager::CompactPastYears(name, &compacted);
+            if (ec != EC_None && ec != EC_DirNotFound){
+                InvokeFatalError(ec, "AdminCommand->CompactPastYears");
+            }
+            years += compacted;
+        }
+        cout << "Compacted " << years << " past years of " << all_users.size() << " users.\n";
+        return 0;
+    }
+    //Back up every user
+    filesystem::path backup_p;
+    vector<backup::s_user_backup> users;
+    ec = backup::BackupAll(dir, jobs, backup_p, users, [](const uint64_t done, const uint64_t total){
+        cout << '\r' << done << '/' << total << " users" << flush;
+    });
+    if (ec != EC_None){
+        InvokeFatalError(ec, "AdminCommand->BackupAll");
+    }
+    //Print summary
+    uint64_t files = 0, bytes = 0;
+    for (backup::s_user_backup& user : users){
+        files += user.files;
+        bytes += user.bytes;
+    }
+    cout << "\nBackup " << backup_p.string() << " created: " << users.size() << " users, ";
+    cout << files << " files, " << bytes << " bytes.\n";
+    return 0;
+}
+#pragma endregion
+#pragma region Session Options
+//If 1, group commit statistics are printed on exit.
+static bool c_commit_stats = 0;
+/**
+ * @brief Take the session options out of the program arguments:
+ * --durability=immediate|batched|exit (when changes are written, see persist::durability_mode), --batch-ms N (milliseconds between batched writes, the group commit interval), --commit-stats (print group commit throughput and latency on exit),
+ * --latency-report (print operation latencies on exit), --slow-ms N (log operations slower than N milliseconds to slow_log_p) and --profile-startup (profile the initial files check, see PrintStartupProfile()).
+ * @param argc Argument count.
+ * @param argv Arguments.
+ * @param args Vector that will contain every other argument (program name included).
+ * @param mode Durability mode. Left as it is if not given.
+ * @param batch_ms Batch milliseconds. Left as it is if not given.
+ * @returns 1(true) if options are valid, 0(false) if not.
+**/
+bool ParseSessionOptions(int argc, char* argv[], vector<char*>& args, persist::durability_mode& mode, unsigned long& batch_ms){
+    args.assign(argv, argv + 1);
+    for (int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if (arg == "--durability=immediate"){
+            mode = persist::DM_Immediate;
+        }
+        else if (arg == "--durability=batched"){
+            mode = persist::DM_Batched;
+        }
+        else if (arg == "--durability=exit"){
+            mode = persist::DM_OnExit;
+        }
+        else if (arg == "--batch-ms"){
+            if (i + 1 >= argc || !strings::IsNumericStr(argv[i + 1], Mode_UIntLong) || string(argv[i + 1]).length() > 6){
+                return 0;
+            }
+            batch_ms = stoul(argv[++i]);
+        }
+        else if (arg == "--commit-stats"){
+            c_commit_stats = 1;
+        }
+        else if (arg == "--latency-report"){
+            c_latency_report = 1;
+        }
+        else if (arg == "--profile-startup"){
+            c_profile_startup = 1;
+        }
+        else if (arg == "--slow-ms"){
+            if (i + 1 >= argc || !strings::IsNumericStr(argv[i + 1], Mode_UIntLong) || string(argv[i + 1]).length() > 6){
+                return 0;
+            }
+            latency::SetSlowThreshold(stoul(argv[++i]));
+            c_slow_log = 1;
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+    return 1;
+}
+/**
+ * @brief Write pending changes before the program ends (exit handler). Prints group commit statistics if asked.
+**/
+void StopPersistence(){
+    ErrorCode ec = persist::Stop();
+    if (ec != EC_None){
+        cout << "\nPending changes could not be written (error " << (int)ec << ").\n";
+    }
+    if (c_commit_stats){
+        persist::s_stats stats;
+        persist::GetStats(stats);
+        cout << "\nGroup commit: " << stats.mutations << " changes in " << stats.batches << " batches, " << stats.synced << " flushes.\n";
+        if (stats.mutations != 0){
+            cout << "Throughput: " << (stats.write_ms > 0 ? stats.mutations * 1000 / stats.write_ms : 0) << " changes/s of write time (" << stats.write_ms << " ms).\n";
+            cout << "Latency (queued to on disk): avg " << stats.latency_ms / stats.mutations << " ms, max " << stats.max_latency_ms << " ms.\n";
+        }
+    }
+    return;
+}
+#pragma endregion
 
-int main() {
+int main(int argc, char* argv[]) {
+    //Render terminal output in process
+    io_fb::screen::Start();
+    //Get session options
+    vector<char*> args;
+    persist::durability_mode mode = persist::DM_Immediate;
+    unsigned long batch_ms = PERSIST_BATCH_MS;
+    if (!ParseSessionOptions(argc, argv, args, mode, batch_ms)){
+        cout << "Usage: " << argv[0] << " [--durability=immediate|batched|exit] [--batch-ms N] [--commit-stats] [--latency-report] [--slow-ms N] [--profile-startup]\n";
+        return 1;
+    }
+    //Report latencies on exit, after pending changes are written.
+    if (c_latency_report){
+        atexit(PrintLatencyReport);
+    }
+    //Write user changes in the background
+    persist::Start(mode, batch_ms);
+    atexit(StopPersistence);
+    //Run admin command, if any, before the interactive files check.
+    if (args.size() > 1){
+        return AdminCommand(args.size(), args.data());
+    }
+    //Profile the first files check
+    profiler::Enable(c_profile_startup);
     start:
     user_lib::user local_user;
     //Do an initial files check
-    ErrorCode ec = filemanager::InitialFilesCheck();
+    latency::Begin();
+    vector<filesystem::path> quarantined;
+    ErrorCode ec = filemanager::InitialFilesCheck(JudgeOrphanFolder, &quarantined);
+    EndOperation(latency::OP_Startup);
+    //Write startup profile trace, print summary on exit
+    if (profiler::IsEnabled()){
+        profiler::Enable(0);
+        c_trace_ec = profiler::WriteTrace(startup_trace_p);
+        atexit(PrintStartupProfile);
+    }
     //If there was an error, return it.
     if (ec != EC_None){
         InvokeFatalError(ec, "InitialFilesCheck");
     }
+    //Report corrupted files moved aside
+    if (!quarantined.empty()){
+        ClearConsole;
+        cout << "Some data files are corrupted and were moved aside (they were not removed):\n";
+        for (filesystem::path& p : quarantined){
+            cout << p.string() << '\n';
+        }
+        cout << "Their data will be missing until they are restored from a backup.\n\n";
+        input::ConsoleWait();
+    }
     //Enter welcome menu.
     WelcomeMenu(local_user);
     //Main Menu
@@ -401,6 +739,26 @@ int main() {
         cout << "3.Consult user macros\n";
         cout << "4.User options\n";
         cout << "5.Log out\n\n";
+        //Apply outside changes to user files
+        ec = local_user.SyncDataChanges();
+        //If user was removed from outside, log out.
+        if (ec == EC_ItemNotFound){
+            cout << "User is no longer registered.\n";
+            input::ConsoleWait();
+            ec = local_user.LogOut();
+            if (ec != EC_None){
+                InvokeFatalError(ec,"MainMenu->LogOut");
+            }
+            goto start;
+        }
+        else if (ec != EC_None){
+            InvokeFatalError(ec,"MainMenu->SyncDataChanges");
+        }
+        //Changes are written in the background. Crash if any could not be written.
+        ec = persist::GetError();
+        if (ec != EC_None){
+            InvokeFatalError(ec,"MainMenu->Persist");
+        }
         //Print daily data
         ec = local_user.PrintCurrentMacros(0,0);
         if (ec != EC_None){
@@ -411,7 +769,9 @@ int main() {
         switch(num_input){
             //Eat
             case 1: {
+                latency::Begin();
                 ec = local_user.EatFood();
+                EndOperation(latency::OP_Eat);
                 //If food was not found.
                 if (ec == EC_ItemNotFound){
                     cout << "Food not found.\n";
@@ -442,14 +802,20 @@ int main() {
             case 4: {
                 //If user options returns 1, restart.
                 if (UserOptions(local_user)){
-                    local_user.LogOut();
+                    ec = local_user.LogOut();
+                    if (ec != EC_None){
+                        InvokeFatalError(ec, "MainMenu->UserOptions->LogOut");
+                    }
                     goto start;
                 }
                 break;
             }
             //Log out
             case 5: {
-                local_user.LogOut();
+                ec = local_user.LogOut();
+                if (ec != EC_None){
+                    InvokeFatalError(ec, "MainMenu->LogOut");
+                }
                 //Re enter program
                 goto start;
             }           
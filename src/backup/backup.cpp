@@ -0,0 +1,1168 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <filesystem>
+namespace fs = filesystem;
+#include <fstream>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <set>
+#include <algorithm>
+#include "backup.h"
+#include "../events/events.h"
+#include "../nutrients/nutrients.h"
+using namespace backup;
+#include "../io/io_fb.h"
+using namespace io_fb;
+
+#pragma region Internal Use Functions
+/**
+ * @brief Split a data string (brackets already removed) by '/'. The last field keeps any remaining '/' (used for paths).
+ * @param data Data string.
+ * @param fields Vector that will contain the fields. It will be cleared.
+ * @param count Amount of fields to split into.
+ * @returns 1(true) if data has exactly that amount of fields, 0(false) if not.
+**/
+bool SplitFields(const string& data, vector<string>& fields, const size_t count){
+    fields.clear();
+    size_t start = 0;
+    while (fields.size() + 1 < count){
+        size_t end = data.find('/', start);
+        if (end == string::npos){
+            return 0;
+        }
+        fields.push_back(data.substr(start, end - start));
+        start = end + 1;
+    }
+    fields.push_back(data.substr(start));
+    return 1;
+}
+/**
+ * @brief Checks if every field is an unsigned number.
+ * @param fields Fields to check.
+ * @param first First field to check.
+ * @param last Last field to check (included).
+ * @returns 1(true) if all are numeric, 0(false) if not.
+**/
+bool AreNumericFields(const vector<string>& fields, const size_t first, const size_t last){
+    for (size_t i = first; i <= last; i++){
+        if (!strings::IsNumericStr(fields[i], Mode_UIntLong) || fields[i].length() > 20){
+            return 0;
+        }
+    }
+    return 1;
+}
+/**
+ * @brief Build a snapshot name from the current local time (YYYY-MM-DD_hh-mm-ss).
+ * @returns Snapshot name.
+**/
+string NewSnapshotName(){
+    time_t epoch_time = chrono::system_clock::to_time_t(chrono::system_clock::now());
+    tm* time_local = localtime(&epoch_time);
+    char name[32];
+    strftime(name, sizeof(name), "%Y-%m-%d_%H-%M-%S", time_local);
+    return name;
+}
+/**
+ * @brief Copy a file while hashing it (FNV-1a), so changed files are only read once.
+ * @param from Source file.
+ * @param to Destination file. It will be overwritten.
+ * @param size Variable that will contain the amount of copied bytes.
+ * @param hash Variable that will contain the file hash.
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_FileCopy; EC_None;
+**/
+ErrorCode CopyAndHash(const fs::path& from, const fs::path& to, uint64_t& size, uint64_t& hash){
+    //Open both files
+    ifstream data_in;
+    data_in.open(from, ios_base::binary);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    ofstream data_out;
+    data_out.open(to, ios_base::binary | ios_base::trunc);
+    if (!data_out.is_open()){
+        return EC_FileCopy;
+    }
+    //Copy and hash every chunk
+    size = 0;
+    hash = FNV_OFFSET;
+    vector<char> buffer(1 << 16);
+    while (data_in.read(buffer.data(), buffer.size()) || data_in.gcount() > 0){
+        hash = filemanager::HashData(buffer.data(), data_in.gcount(), hash);
+        data_out.write(buffer.data(), data_in.gcount());
+        size += data_in.gcount();
+    }
+    data_in.close();
+    data_out.close();
+    if (data_out.fail()){
+        return EC_FileCopy;
+    }
+    return EC_None;
+}
+/**
+ * @brief Append an LZ length extension (255 per byte while it does not fit, then the rest).
+ * @param out Output buffer.
+ * @param length Length left after the 4 bit token part.
+**/
+void LzWriteLength(string& out, size_t length){
+    while (length >= 255){
+        out += (char)255;
+        length -= 255;
+    }
+    out += (char)length;
+    return;
+}
+/**
+ * @brief Append an LZ sequence: token, literals and (unless last) a back reference.
+ * @param out Output buffer.
+ * @param literals Pointer to the literal bytes.
+ * @param lit_len Amount of literal bytes.
+ * @param offset Distance of the match (0 for the last sequence, which has no match).
+ * @param match_len Match length (4 or more, ignored in the last sequence).
+**/
+void LzWriteSequence(string& out, const char* literals, const size_t lit_len, const size_t offset, const size_t match_len){
+    //Token: literal length and match length nibbles
+    size_t match_code = offset == 0 ? 0 : match_len - 4;
+    out += (char)((min<size_t>(lit_len, 15) << 4) | min<size_t>(match_code, 15));
+    if (lit_len >= 15){
+        LzWriteLength(out, lit_len - 15);
+    }
+    //Literals
+    out.append(literals, lit_len);
+    //Back reference
+    if (offset != 0){
+        out += (char)(offset & 0xFF);
+        out += (char)(offset >> 8);
+        if (match_code >= 15){
+            LzWriteLength(out, match_code - 15);
+        }
+    }
+    return;
+}
+/**
+ * @brief Compress a block with a small LZ77 codec (LZ4-like sequences: literal run + back reference of 4 or more bytes within 64KB).
+ * @param in Pointer to the raw bytes.
+ * @param size Amount of raw bytes.
+ * @param out String that will contain the compressed bytes. It will be cleared.
+**/
+void LzCompress(const char* in, const size_t size, string& out){
+    out.clear();
+    //Last position each 4 byte sequence was seen at (+1, 0 means empty).
+    vector<uint32_t> table(1 << 14, 0);
+    size_t anchor = 0, i = 0;
+    while (i + 4 <= size){
+        //Look up current sequence
+        uint32_t seq;
+        memcpy(&seq, in + i, 4);
+        uint32_t h = (seq * 2654435761U) >> 18;
+        size_t candidate = table[h];
+        table[h] = i + 1;
+        //If a match is found, extend it and write the sequence.
+        if (candidate != 0 && i - (candidate - 1) <= 65535 && memcmp(in + candidate - 1, in + i, 4) == 0){
+            size_t ref = candidate - 1, length = 4;
+            while (i + length < size && in[ref + length] == in[i + length]){
+                length++;
+            }
+            LzWriteSequence(out, in + anchor, i - anchor, i - ref, length);
+            i += length;
+            anchor = i;
+        }
+        else {
+            i++;
+        }
+    }
+    //Last sequence: remaining literals only
+    LzWriteSequence(out, in + anchor, size - anchor, 0, 0);
+    return;
+}
+/**
+ * @brief Read an LZ length extension.
+ * @param in Compressed bytes.
+ * @param size Amount of compressed bytes.
+ * @param pos Read position, moved past the extension.
+ * @param length Length to add the extension to.
+ * @returns 1(true) if read, 0(false) if input ended.
+**/
+bool LzReadLength(const char* in, const size_t size, size_t& pos, size_t& length){
+    uint8_t b;
+    do {
+        if (pos >= size){
+            return 0;
+        }
+        b = in[pos++];
+        length += b;
+    } while (b == 255);
+    return 1;
+}
+/**
+ * @brief Decompress a block written by LzCompress(). Every length and offset is bounds checked, so corrupted input fails instead of overflowing.
+ * @param in Compressed bytes.
+ * @param size Amount of compressed bytes.
+ * @param out Buffer for the raw bytes.
+ * @param raw_size Expected amount of raw bytes.
+ * @returns 1(true) if the block is valid and decodes to exactly raw_size bytes, 0(false) if not.
+**/
+bool LzDecompress(const char* in, const size_t size, char* out, const size_t raw_size){
+    size_t ip = 0, op = 0;
+    while (ip < size){
+        uint8_t token = in[ip++];
+        //Literals
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !LzReadLength(in, size, ip, lit_len)){
+            return 0;
+        }
+        if (ip + lit_len > size || op + lit_len > raw_size){
+            return 0;
+        }
+        memcpy(out + op, in + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        //Last sequence has no match
+        if (ip == size){
+            break;
+        }
+        //Back reference
+        if (ip + 2 > size){
+            return 0;
+        }
+        size_t offset = (uint8_t)in[ip] | ((size_t)(uint8_t)in[ip + 1] << 8);
+        ip += 2;
+        size_t length = token & 15;
+        if (length == 15 && !LzReadLength(in, size, ip, length)){
+            return 0;
+        }
+        length += 4;
+        if (offset == 0 || offset > op || op + length > raw_size){
+            return 0;
+        }
+        //Copy byte by byte, matches may overlap themselves.
+        for (size_t k = 0; k < length; k++, op++){
+            out[op] = out[op - offset];
+        }
+    }
+    return op == raw_size;
+}
+/**
+ * @brief Checks if an archive entry path stays inside the folder it is extracted to (relative, no '..' parts).
+ * @param path Entry path.
+ * @returns 1(true) if safe, 0(false) if not.
+**/
+bool IsSafeEntryPath(const string& path){
+    fs::path p = path;
+    if (path.empty() || p.is_absolute() || p.has_root_name() || p.has_root_directory()){
+        return 0;
+    }
+    for (const fs::path& part : p){
+        if (part == ".." || part == "."){
+            return 0;
+        }
+    }
+    return 1;
+}
+/**
+ * @brief Decompress an archive file block by block (random access through the index entry), handing every raw block to a writer. The whole entry is checked against its stored size and hash.
+ * @param archive_p Path to archive file.
+ * @param entry Index entry of the file (see ReadArchiveIndex()).
+ * @param write Receives every decompressed block, in order. Returns 0(false) if the block could not be written.
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_FileWriteNoPerm; EC_FileCorrupted; EC_None;
+**/
+ErrorCode DecompressArchiveEntry(const fs::path& archive_p, const s_archive_entry& entry, const function<bool(const char*, size_t)>& write){
+    //Open archive at entry offset
+    ifstream data_in;
+    data_in.open(archive_p, ios_base::binary);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    data_in.seekg(entry.offset);
+    //Decompress every block
+    uint64_t written = 0, consumed = 0, hash = FNV_OFFSET;
+    vector<char> raw_buf(ARCHIVE_BLOCK);
+    string block;
+    while (written < entry.size){
+        //Read block header and check it against the entry.
+        uint32_t raw, stored;
+        if (!data_in.read((char*)&raw, sizeof(raw)) || !data_in.read((char*)&stored, sizeof(stored))){
+            return EC_FileCorrupted;
+        }
+        consumed += sizeof(raw) + sizeof(stored) + stored;
+        if (raw == 0 || raw > ARCHIVE_BLOCK || stored > raw || consumed > entry.stored || written + raw > entry.size){
+            return EC_FileCorrupted;
+        }
+        //Read block and decompress it (blocks as big as their raw size are stored).
+        block.resize(stored);
+        if (!data_in.read(block.data(), stored)){
+            return EC_FileCorrupted;
+        }
+        if (stored == raw){
+            memcpy(raw_buf.data(), block.data(), raw);
+        }
+        else if (!LzDecompress(block.data(), stored, raw_buf.data(), raw)){
+            return EC_FileCorrupted;
+        }
+        hash = filemanager::HashData(raw_buf.data(), raw, hash);
+        if (!write(raw_buf.data(), raw)){
+            return EC_FileWriteNoPerm;
+        }
+        written += raw;
+    }
+    //Check result
+    if (consumed != entry.stored || hash != entry.hash){
+        return EC_FileCorrupted;
+    }
+    return EC_None;
+}
+/**
+ * @brief Run a job for every index from 0 to count - 1 across worker threads. The calling thread reports progress until every job is done.
+ * @param count Amount of jobs.
+ * @param job Job to run, receives the job index. Jobs must not share data.
+ * @param progress Progress callback, or NULL.
+ * @param max_jobs Maximum worker threads (jobs running at once). If 0 (default), hardware threads are used, up to RESTORE_MAX_JOBS.
+**/
+void RunParallel(const size_t count, const function<void(size_t)>& job, progress_callback progress, const size_t max_jobs = 0){
+    atomic<size_t> next(0), done(0);
+    //Choose worker count
+    size_t jobs = max_jobs != 0 ? max_jobs : min<size_t>(RESTORE_MAX_JOBS, max(thread::hardware_concurrency(), 1U));
+    jobs = min(jobs, count);
+    vector<thread> workers;
+    for (size_t w = 0; w < jobs; w++){
+        workers.emplace_back([&](){
+            for (size_t i = next++; i < count; i = next++){
+                job(i);
+                done++;
+            }
+        });
+    }
+    //Report progress while workers run
+    while (progress != NULL && done < count){
+        progress(done, count);
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+    for (thread& worker : workers){
+        worker.join();
+    }
+    if (progress != NULL){
+        progress(count, count);
+    }
+    return;
+}
+/**
+ * @brief Read a backup file once and validate it with the rules of its file type.
+ * @param file_p Path to the backup file, or to the archive holding it.
+ * @param usr User the backup belongs to.
+ * @param entry Restore entry to fill (path must be set).
+ * @param archived Index entry of the file if file_p is an archive, or NULL.
+**/
+void ReadRestoreEntry(const fs::path& file_p, const string& usr, s_restore_entry& entry, const s_archive_entry* archived = NULL){
+    fs::path rel = entry.path;
+    vector<fs::path> parts(rel.begin(), rel.end());
+    string file_data;
+    bool binary = 0;
+    bool year_bin = 0, year_map = 0, events_log = 0, events_idx = 0;
+    int year = 0;
+    filemanager::files type;
+    //Find file type from its place inside the user folder.
+    if (parts.size() == 1 && entry.path == usr + "_foods.dat"){
+        type = filemanager::usr_foods_dat;
+    }
+    else if (parts.size() == 1 && entry.path == usr + "_foods.bin"){
+        binary = 1;
+    }
+    else if (parts.size() == 1 && filemanager::IsYearFileName(entry.path, "_year.bin", &year)){
+        year_bin = 1;
+    }
+    else if (parts.size() == 1 && filemanager::IsYearFileName(entry.path, "_days.map", &year)){
+        year_map = 1;
+    }
+    else if (parts.size() == 1 && filemanager::IsYearFileName(entry.path, "_events.log", &year)){
+        events_log = 1;
+    }
+    else if (parts.size() == 1 && filemanager::IsYearFileName(entry.path, "_events.idx", &year)){
+        events_idx = 1;
+    }
+    else if (parts.size() == 4 && strings::IsNumericStr(parts[0].string(), Mode_UIntLong) && strings::IsNumericStr(parts[1].string(), Mode_UIntLong) && strings::IsNumericStr(parts[2].string(), Mode_UIntLong) && parts[3].string().length() == 9 && parts[3].string().ends_with("_day.dat")){
+        type = filemanager::x_day_dat;
+    }
+    else {
+        entry.status = EC_WrongFile;
+        return;
+    }
+    //Read file (archived files are decompressed into memory).
+    if (archived == NULL){
+        entry.status = filemanager::ReadFileData(file_p, file_data);
+    }
+    else {
+        entry.status = DecompressArchiveEntry(file_p, *archived, [&](const char* data, size_t size) -> bool {
+            file_data.append(data, size);
+            return 1;
+        });
+    }
+    if (entry.status != EC_None){
+        return;
+    }
+    //Validate compacted year file
+    if (year_bin){
+        entry.status = filemanager::YearBinDataCheck(file_data, year);
+        if (entry.status == EC_None){
+            entry.data = move(file_data);
+        }
+        return;
+    }
+    //Validate year presence map (it is rebuilt anyway once restored).
+    if (year_map){
+        entry.status = filemanager::YearMapDataCheck(file_data, year);
+        if (entry.status == EC_None){
+            entry.data = move(file_data);
+        }
+        return;
+    }
+    //Validate event log, or event day index (checked against its log once restored), migrating older formats.
+    if (events_log || events_idx){
+        entry.repaired = events_log ? events::MigrateEventsLogData(file_data) : events::MigrateEventsIndexData(file_data);
+        entry.status = events_log ? events::EventsLogDataCheck(file_data, year) : events::EventsIndexDataCheck(file_data, year, UINT64_MAX);
+        if (entry.status == EC_None){
+            entry.data = move(file_data);
+        }
+        return;
+    }
+    //Validate binary catalog, migrating older formats.
+    if (binary){
+        entry.repaired = filemanager::MigrateFoodsBinData(file_data);
+        entry.status = filemanager::FoodsBinDataCheck(file_data);
+        if (entry.status == EC_FileEmpty){
+            entry.status = EC_None;
+        }
+        if (entry.status == EC_None){
+            entry.data = move(file_data);
+        }
+        return;
+    }
+    //Validate text file (an empty food catalog is valid).
+    entry.status = filemanager::ValidateData(type, file_data, entry.data, entry.repaired);
+    if (entry.status == EC_FileEmpty){
+        entry.status = type == filemanager::usr_foods_dat ? EC_None : EC_FileCorrupted;
+    }
+    return;
+}
+/**
+ * @brief Copy a whole user folder, hashing it on the way. Files are copied in path order so the user hash does not depend on directory listing order.
+ * @param from User folder.
+ * @param to Destination folder. It will be created.
+ * @param user Struct that will contain file count, size and hash.
+ * @returns Possible ErrorCodes: EC_DirNotFound; EC_DirCreateNoPerm; EC_None;
+ * @returns [OR] ErrorCodes thrown by CopyAndHash();
+**/
+ErrorCode CopyUserFolder(const fs::path& from, const fs::path& to, s_user_backup& user){
+    user.files = user.bytes = 0;
+    user.hash = FNV_OFFSET;
+    if (!fs::is_directory(from)){
+        return EC_DirNotFound;
+    }
+    //List files in path order (skipping files being committed right now).
+    vector<fs::path> files;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(from)){
+        if (entry.is_regular_file() && entry.path().filename().string().rfind(".new_", 0) != 0){
+            files.push_back(fs::relative(entry.path(), from));
+        }
+    }
+    sort(files.begin(), files.end());
+    //Copy every file
+    error_code f_ec;
+    for (fs::path& rel : files){
+        if (!fs::exists((to / rel).parent_path()) && !fs::create_directories((to / rel).parent_path(), f_ec)){
+            return EC_DirCreateNoPerm;
+        }
+        uint64_t size, hash;
+        ErrorCode ec = CopyAndHash(from / rel, to / rel, size, hash);
+        if (ec != EC_None){
+            return ec;
+        }
+        //Add path and content hash to the user hash
+        string path = rel.generic_string();
+        user.hash = filemanager::HashData(path.c_str(), path.size() + 1, user.hash);
+        user.hash = filemanager::HashData((const char*)&hash, sizeof(hash), user.hash);
+        user.files++;
+        user.bytes += size;
+    }
+    return EC_None;
+}
+#pragma endregion
+#pragma region Public Functions
+/**
+ * @brief Create an incremental snapshot of the user folder under <root>/<usr>/<timestamp>. Files unchanged since the previous snapshot (same size and write time, or same size and hash) are hard-linked from it; only new and changed files are copied. The snapshot is built in a hidden folder and renamed into place once complete, then its manifest is written and it is added to snapshots.dat.
+ * @param root Backup root folder. It must exist.
+ * @param usr User to back up.
+ * @param snapshot Struct that will contain the new snapshot summary.
+ * @returns Possible ErrorCodes: EC_DirNotFound; EC_DirCreateNoPerm; EC_FileCopy; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: filemanager::HashFile(); filemanager::CommitFile(); filemanager::ReadFileData();
+ * @warning If the hard link can not be created (file system without hard links), the file is copied instead.
+**/
+ErrorCode backup::CreateSnapshot(const fs::path& root, const string& usr, s_snapshot& snapshot){
+    fs::path from = user_folder(usr);
+    fs::path base = backup_folder(root, usr);
+    error_code f_ec;
+    //Check user folder and create user backup folder.
+    if (!fs::is_directory(from) || !fs::is_directory(root)){
+        return EC_DirNotFound;
+    }
+    if (!fs::exists(base) && !fs::create_directories(base, f_ec)){
+        return EC_DirCreateNoPerm;
+    }
+    //Remove snapshots left behind by interrupted backups.
+    for (const fs::directory_entry& entry : fs::directory_iterator(base)){
+        if (entry.is_directory() && entry.path().filename().string().rfind(".new_", 0) == 0){
+            fs::remove_all(entry.path(), f_ec);
+        }
+    }
+    //Load previous snapshot manifest, if any (a missing or broken manifest means a full copy).
+    vector<s_snapshot> snapshots;
+    unordered_map<string, s_manifest_entry> previous;
+    fs::path prev_p;
+    ErrorCode ec = ListSnapshots(root, usr, snapshots);
+    if (ec != EC_None && ec != EC_FileNotFound){
+        return ec;
+    }
+    if (!snapshots.empty()){
+        vector<s_manifest_entry> entries;
+        prev_p = GetSnapshotPath(root, usr, snapshots.back().name);
+        if (fs::is_directory(prev_p) && ReadManifest(root, usr, snapshots.back().name, entries) == EC_None){
+            for (s_manifest_entry& entry : entries){
+                previous[entry.path] = entry;
+            }
+        }
+    }
+    //Choose a free snapshot name
+    snapshot = {NewSnapshotName(), 0, 0, 0};
+    for (int i = 2; fs::exists(GetSnapshotPath(root, usr, snapshot.name)); i++){
+        snapshot.name = NewSnapshotName() + '_' + to_string(i);
+    }
+    //Create work folder
+    fs::path work = base / (".new_" + snapshot.name);
+    if (!fs::create_directory(work, f_ec)){
+        return EC_DirCreateNoPerm;
+    }
+    //Walk user folder
+    string manifest;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(from)){
+        fs::path rel = fs::relative(entry.path(), from);
+        //Recreate folders
+        if (entry.is_directory()){
+            if (!fs::create_directories(work / rel, f_ec) && f_ec){
+                fs::remove_all(work, f_ec);
+                return EC_DirCreateNoPerm;
+            }
+            continue;
+        }
+        //Skip files being committed right now.
+        if (!entry.is_regular_file() || entry.path().filename().string().rfind(".new_", 0) == 0){
+            continue;
+        }
+        //Get file size and write time
+        s_manifest_entry file = {rel.generic_string(), entry.file_size(), (uint64_t)entry.last_write_time().time_since_epoch().count(), 0};
+        auto prev = previous.find(file.path);
+        bool unchanged = 0;
+        //Same size and write time as in the previous snapshot: unchanged.
+        if (prev != previous.end() && prev->second.size == file.size && prev->second.mtime == file.mtime){
+            file.hash = prev->second.hash;
+            unchanged = 1;
+        }
+        //Same size but different write time: compare content hash.
+        else if (prev != previous.end() && prev->second.size == file.size){
+            ec = filemanager::HashFile(entry.path(), file.hash);
+            if (ec != EC_None){
+                fs::remove_all(work, f_ec);
+                return ec;
+            }
+            unchanged = file.hash == prev->second.hash;
+        }
+        //Link unchanged files from the previous snapshot.
+        if (unchanged){
+            fs::create_hard_link(prev_p / rel, work / rel, f_ec);
+            unchanged = !f_ec;
+        }
+        //Copy new and changed files (or files that could not be linked).
+        if (!unchanged){
+            ec = CopyAndHash(entry.path(), work / rel, file.size, file.hash);
+            if (ec != EC_None){
+                fs::remove_all(work, f_ec);
+                return ec;
+            }
+            snapshot.copied++;
+        }
+        //Add manifest entry
+        snapshot.files++;
+        snapshot.bytes += file.size;
+        manifest += '{' + to_string(file.size) + '/' + to_string(file.mtime) + '/' + to_string(file.hash) + '/' + file.path + "}|";
+    }
+    //Move snapshot into place
+    fs::rename(work, GetSnapshotPath(root, usr, snapshot.name), f_ec);
+    if (f_ec){
+        fs::remove_all(work, f_ec);
+        return EC_FileCopy;
+    }
+    //Write manifest
+    ec = filemanager::CommitFile(snapshot_manifest(root, usr, snapshot.name), manifest);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Add snapshot to snapshots.dat
+    string list;
+    ec = filemanager::ReadFileData(snapshots_dat(root, usr), list);
+    if (ec != EC_None && ec != EC_FileNotFound){
+        return ec;
+    }
+    list += '{' + snapshot.name + '/' + to_string(snapshot.files) + '/' + to_string(snapshot.bytes) + '/' + to_string(snapshot.copied) + "}|";
+    return filemanager::CommitFile(snapshots_dat(root, usr), list);
+}
+/**
+ * @brief Get every snapshot of a user from snapshots.dat (no snapshot folder is read), oldest first.
+ * @param root Backup root folder.
+ * @param usr User to list snapshots from.
+ * @param snapshots Vector that will contain the snapshots. It will be cleared.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+ * @returns [OR] ErrorCodes thrown by filemanager::ReadFileData();
+**/
+ErrorCode backup::ListSnapshots(const fs::path& root, const string& usr, vector<s_snapshot>& snapshots){
+    snapshots.clear();
+    //Read snapshots.dat
+    string list;
+    ErrorCode ec = filemanager::ReadFileData(snapshots_dat(root, usr), list);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Parse every entry
+    size_t start = 0, end;
+    vector<string> fields;
+    while ((end = list.find('|', start)) != string::npos){
+        string data = list.substr(start, end - start);
+        start = end + 1;
+        if (data.length() < 2 || data.front() != '{' || data.back() != '}'){
+            return EC_FileCorrupted;
+        }
+        strings::RemoveBrackets(data);
+        if (!SplitFields(data, fields, 4) || fields[0].empty() || !AreNumericFields(fields, 1, 3)){
+            return EC_FileCorrupted;
+        }
+        snapshots.push_back({fields[0], stoull(fields[1]), stoull(fields[2]), stoull(fields[3])});
+    }
+    return EC_None;
+}
+/**
+ * @brief Read the manifest of a snapshot.
+ * @param root Backup root folder.
+ * @param usr Snapshot owner.
+ * @param snapshot Snapshot name.
+ * @param entries Vector that will contain one entry per file. It will be cleared.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+ * @returns [OR] ErrorCodes thrown by filemanager::ReadFileData();
+**/
+ErrorCode backup::ReadManifest(const fs::path& root, const string& usr, const string& snapshot, vector<s_manifest_entry>& entries){
+    entries.clear();
+    //Read manifest
+    string manifest;
+    ErrorCode ec = filemanager::ReadFileData(snapshot_manifest(root, usr, snapshot), manifest);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Parse every entry
+    size_t start = 0, end;
+    vector<string> fields;
+    while ((end = manifest.find('|', start)) != string::npos){
+        string data = manifest.substr(start, end - start);
+        start = end + 1;
+        if (data.length() < 2 || data.front() != '{' || data.back() != '}'){
+            return EC_FileCorrupted;
+        }
+        strings::RemoveBrackets(data);
+        if (!SplitFields(data, fields, 4) || fields[3].empty() || !AreNumericFields(fields, 0, 2)){
+            return EC_FileCorrupted;
+        }
+        entries.push_back({fields[3], stoull(fields[0]), stoull(fields[1]), stoull(fields[2])});
+    }
+    return EC_None;
+}
+/**
+ * @brief Get the folder of a snapshot.
+ * @param root Backup root folder.
+ * @param usr Snapshot owner.
+ * @param snapshot Snapshot name.
+ * @returns Path to the snapshot folder (a copy of the user folder).
+ * @warning The function does NOT check if the folder exists.
+**/
+fs::path backup::GetSnapshotPath(const fs::path& root, const string& usr, const string& snapshot){
+    return backup_folder(root, usr) / snapshot;
+}
+#pragma endregion
+#pragma region Archive
+/**
+ * @brief Stream the whole user folder into a single compressed archive file (<folder>/<usr>_<timestamp>.fbk). Files are split in blocks compressed with the built-in LZ codec; a trailing index keeps the offset, size and hash of every file. The archive is written to a hidden sibling and renamed into place once complete.
+ * @param folder Folder where the archive will be created. It must exist.
+ * @param usr User to back up.
+ * @param archive_p Path that will contain the created archive file.
+ * @param entries Vector that will contain the archive index. It will be cleared.
+ * @returns Possible ErrorCodes: EC_DirNotFound; EC_FileReadNoPerm; EC_FileWriteNoPerm; EC_None;
+**/
+ErrorCode backup::CreateArchive(const fs::path& folder, const string& usr, fs::path& archive_p, vector<s_archive_entry>& entries){
+    fs::path from = user_folder(usr);
+    entries.clear();
+    //Check folders
+    if (!fs::is_directory(from) || !fs::is_directory(folder)){
+        return EC_DirNotFound;
+    }
+    //Choose a free archive name
+    archive_p = fs::path(folder) / (usr + '_' + NewSnapshotName() + ARCHIVE_EXT);
+    for (int i = 2; fs::exists(archive_p); i++){
+        archive_p = fs::path(folder) / (usr + '_' + NewSnapshotName() + '_' + to_string(i) + ARCHIVE_EXT);
+    }
+    fs::path new_p = archive_p;
+    new_p.replace_filename(".new_" + archive_p.filename().string());
+    //Open archive and write header
+    ofstream data_out;
+    data_out.open(new_p, ios_base::binary | ios_base::trunc);
+    if (!data_out.is_open()){
+        return EC_FileWriteNoPerm;
+    }
+    s_archive_header header = {{0}, ARCHIVE_VERSION};
+    memcpy(header.magic, ARCHIVE_MAGIC, 4);
+    data_out.write((const char*)&header, sizeof(header));
+    uint64_t offset = sizeof(header);
+    //Walk user folder
+    error_code f_ec;
+    vector<char> buffer(ARCHIVE_BLOCK);
+    string block;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(from)){
+        //Skip folders and files being committed right now.
+        if (!entry.is_regular_file() || entry.path().filename().string().rfind(".new_", 0) == 0){
+            continue;
+        }
+        ifstream data_in;
+        data_in.open(entry.path(), ios_base::binary);
+        if (!data_in.is_open()){
+            data_out.close();
+            fs::remove(new_p, f_ec);
+            return EC_FileReadNoPerm;
+        }
+        //Compress file block by block
+        s_archive_entry file = {fs::relative(entry.path(), from).generic_string(), offset, 0, 0, FNV_OFFSET};
+        while (data_in.read(buffer.data(), buffer.size()) || data_in.gcount() > 0){
+            uint32_t raw = data_in.gcount();
+            file.hash = filemanager::HashData(buffer.data(), raw, file.hash);
+            file.size += raw;
+            //Store raw bytes if compression does not help.
+            LzCompress(buffer.data(), raw, block);
+            if (block.size() >= raw){
+                block.assign(buffer.data(), raw);
+            }
+            uint32_t stored = block.size();
+            data_out.write((const char*)&raw, sizeof(raw));
+            data_out.write((const char*)&stored, sizeof(stored));
+            data_out.write(block.data(), stored);
+            file.stored += sizeof(raw) + sizeof(stored) + stored;
+        }
+        data_in.close();
+        offset += file.stored;
+        entries.push_back(file);
+    }
+    //Write index
+    string index;
+    for (s_archive_entry& file : entries){
+        uint16_t path_len = file.path.size();
+        index.append((const char*)&path_len, sizeof(path_len));
+        index.append(file.path);
+        index.append((const char*)&file.offset, sizeof(file.offset));
+        index.append((const char*)&file.size, sizeof(file.size));
+        index.append((const char*)&file.stored, sizeof(file.stored));
+        index.append((const char*)&file.hash, sizeof(file.hash));
+    }
+    data_out.write(index.data(), index.size());
+    //Write footer
+    s_archive_footer footer = {offset, filemanager::HashData(index.data(), index.size()), (uint32_t)entries.size(), {0}};
+    memcpy(footer.magic, ARCHIVE_INDEX_MAGIC, 4);
+    data_out.write((const char*)&footer, sizeof(footer));
+    data_out.close();
+    if (data_out.fail()){
+        fs::remove(new_p, f_ec);
+        return EC_FileWriteNoPerm;
+    }
+    //Move archive into place
+    fs::rename(new_p, archive_p, f_ec);
+    if (f_ec){
+        fs::remove(new_p, f_ec);
+        return EC_FileWriteNoPerm;
+    }
+    return EC_None;
+}
+/**
+ * @brief Read the index of an archive file (only the footer and the index are read).
+ * @param archive_p Path to archive file.
+ * @param entries Vector that will contain one entry per file. It will be cleared.
+ * @returns Possible ErrorCodes: EC_FileNotFound; EC_FileReadNoPerm; EC_WrongFile; EC_FileCorrupted; EC_None;
+**/
+ErrorCode backup::ReadArchiveIndex(const fs::path& archive_p, vector<s_archive_entry>& entries){
+    entries.clear();
+    //If path is invalid or is directory, return error.
+    if (!fs::exists(archive_p) || fs::is_directory(archive_p)){
+        return EC_FileNotFound;
+    }
+    ifstream data_in;
+    data_in.open(archive_p, ios_base::binary);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    //Check header
+    uint64_t file_size = fs::file_size(archive_p);
+    s_archive_header header;
+    if (file_size < sizeof(header) + sizeof(s_archive_footer) || !data_in.read((char*)&header, sizeof(header)) || memcmp(header.magic, ARCHIVE_MAGIC, 4) != 0){
+        return EC_WrongFile;
+    }
+    if (header.version != ARCHIVE_VERSION){
+        return EC_FileCorrupted;
+    }
+    //Read footer
+    s_archive_footer footer;
+    data_in.seekg(file_size - sizeof(footer));
+    if (!data_in.read((char*)&footer, sizeof(footer)) || memcmp(footer.magic, ARCHIVE_INDEX_MAGIC, 4) != 0){
+        return EC_FileCorrupted;
+    }
+    if (footer.index_offset < sizeof(header) || footer.index_offset > file_size - sizeof(footer)){
+        return EC_FileCorrupted;
+    }
+    //Read and check index
+    string index(file_size - sizeof(footer) - footer.index_offset, '\0');
+    data_in.seekg(footer.index_offset);
+    if (!data_in.read(index.data(), index.size()) || filemanager::HashData(index.data(), index.size()) != footer.index_hash){
+        return EC_FileCorrupted;
+    }
+    data_in.close();
+    //Parse entries
+    size_t pos = 0;
+    for (uint32_t i = 0; i < footer.entries; i++){
+        s_archive_entry file;
+        uint16_t path_len;
+        if (pos + sizeof(path_len) > index.size()){
+            return EC_FileCorrupted;
+        }
+        memcpy(&path_len, index.data() + pos, sizeof(path_len));
+        pos += sizeof(path_len);
+        if (pos + path_len + 4 * sizeof(uint64_t) > index.size()){
+            return EC_FileCorrupted;
+        }
+        file.path = index.substr(pos, path_len);
+        pos += path_len;
+        memcpy(&file.offset, index.data() + pos, sizeof(uint64_t));
+        memcpy(&file.size, index.data() + pos + 8, sizeof(uint64_t));
+        memcpy(&file.stored, index.data() + pos + 16, sizeof(uint64_t));
+        memcpy(&file.hash, index.data() + pos + 24, sizeof(uint64_t));
+        pos += 4 * sizeof(uint64_t);
+        //Entry must stay inside the data area and the user folder.
+        if (!IsSafeEntryPath(file.path) || file.offset < sizeof(header) || file.stored > footer.index_offset - file.offset){
+            return EC_FileCorrupted;
+        }
+        entries.push_back(file);
+    }
+    if (pos != index.size()){
+        return EC_FileCorrupted;
+    }
+    return EC_None;
+}
+/**
+ * @brief Extract a single file from an archive, decompressing it block by block (random access through the index entry). The file is written to a hidden sibling and renamed into place only if its hash matches.
+ * @param archive_p Path to archive file.
+ * @param entry Index entry of the file (see ReadArchiveIndex()).
+ * @param to Path of the extracted file. Parent folders are created if needed. An existing file is replaced.
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_DirCreateNoPerm; EC_FileWriteNoPerm; EC_FileCorrupted; EC_None;
+**/
+ErrorCode backup::ExtractArchiveEntry(const fs::path& archive_p, const s_archive_entry& entry, const fs::path& to){
+    error_code f_ec;
+    //Create parent folders and open sibling file
+    if (to.has_parent_path() && !fs::exists(to.parent_path()) && !fs::create_directories(to.parent_path(), f_ec)){
+        return EC_DirCreateNoPerm;
+    }
+    fs::path new_p = to;
+    new_p.replace_filename(".new_" + to.filename().string());
+    ofstream data_out;
+    data_out.open(new_p, ios_base::binary | ios_base::trunc);
+    if (!data_out.is_open()){
+        return EC_FileWriteNoPerm;
+    }
+    //Decompress file
+    ErrorCode ec = DecompressArchiveEntry(archive_p, entry, [&](const char* data, size_t size){
+        return !data_out.write(data, size).fail();
+    });
+    data_out.close();
+    if (ec == EC_None && data_out.fail()){
+        ec = EC_FileWriteNoPerm;
+    }
+    if (ec != EC_None){
+        fs::remove(new_p, f_ec);
+        return ec;
+    }
+    //Move file into place
+    fs::rename(new_p, to, f_ec);
+    if (f_ec){
+        fs::remove(new_p, f_ec);
+        return EC_FileWriteNoPerm;
+    }
+    return EC_None;
+}
+/**
+ * @brief Extract every file of an archive into a folder.
+ * @param archive_p Path to archive file.
+ * @param to Folder to extract to (usually the user folder). Existing files are replaced.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: ReadArchiveIndex(); ExtractArchiveEntry();
+**/
+ErrorCode backup::ExtractArchive(const fs::path& archive_p, const fs::path& to){
+    vector<s_archive_entry> entries;
+    ErrorCode ec = ReadArchiveIndex(archive_p, entries);
+    if (ec != EC_None){
+        return ec;
+    }
+    for (s_archive_entry& entry : entries){
+        ec = ExtractArchiveEntry(archive_p, entry, fs::path(to) / entry.path);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    return EC_None;
+}
+#pragma endregion
+#pragma region Restore
+/**
+ * @brief First restore step: read every file of a backup folder (a snapshot or a plain copy of the user folder) once and validate it in memory with the ValidateFile() rules, across worker threads. Nothing is written, so problems can be reported before restoring.
+ * @param from Backup folder (holds the user files, not the user folder).
+ * @param usr User to restore.
+ * @param entries Vector that will contain one entry per backup file (see s_restore_entry). It will be cleared.
+ * @param progress Progress callback, or NULL.
+ * @returns Possible ErrorCodes: EC_DirNotFound; EC_DirEmpty; EC_None;
+**/
+ErrorCode backup::ReadRestoreFiles(const fs::path& from, const string& usr, vector<s_restore_entry>& entries, progress_callback progress){
+    entries.clear();
+    if (!fs::is_directory(from)){
+        return EC_DirNotFound;
+    }
+    //List files
+    vector<fs::path> files;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(from)){
+        if (entry.is_regular_file()){
+            files.push_back(entry.path());
+            entries.push_back({fs::relative(entry.path(), from).generic_string(), EC_None, 0, ""});
+        }
+    }
+    if (files.empty()){
+        return EC_DirEmpty;
+    }
+    //Read and validate files
+    RunParallel(files.size(), [&](size_t i){ ReadRestoreEntry(files[i], usr, entries[i]); }, progress);
+    return EC_None;
+}
+/**
+ * @brief First restore step for archives: decompress archived files into memory and validate them like ReadRestoreFiles() does, across worker threads. Nothing is written.
+ * @param archive_p Path to archive file.
+ * @param files Index entries of the files to restore (see ReadArchiveIndex()).
+ * @param usr User to restore.
+ * @param entries Vector that will contain one entry per archived file (see s_restore_entry). It will be cleared.
+ * @param progress Progress callback, or NULL.
+ * @returns Possible ErrorCodes: EC_FileNotFound; EC_DirEmpty; EC_None;
+**/
+ErrorCode backup::ReadRestoreArchive(const fs::path& archive_p, const vector<s_archive_entry>& files, const string& usr, vector<s_restore_entry>& entries, progress_callback progress){
+    entries.clear();
+    if (!fs::is_regular_file(archive_p)){
+        return EC_FileNotFound;
+    }
+    if (files.empty()){
+        return EC_DirEmpty;
+    }
+    //Entries must stay inside the user folder.
+    for (const s_archive_entry& file : files){
+        entries.push_back({file.path, IsSafeEntryPath(file.path) ? EC_None : EC_WrongFile, 0, ""});
+    }
+    //Decompress and validate files
+    RunParallel(files.size(), [&](size_t i){
+        if (entries[i].status == EC_None){
+            ReadRestoreEntry(archive_p, usr, entries[i], &files[i]);
+        }
+    }, progress);
+    return EC_None;
+}
+/**
+ * @brief Second restore step: write every valid entry into the user folder, across worker threads. Every file is committed atomically (see filemanager::CommitFile()), so an interrupted restore never leaves half written files.
+ * @param usr User to restore.
+ * @param entries Entries read by ReadRestoreFiles() or ReadRestoreArchive(). Entries with a non EC_None status are skipped. The status of written entries is set to the write result.
+ * @param progress Progress callback, or NULL.
+ * @returns Possible ErrorCodes: EC_DirCreateNoPerm; EC_None;
+ * @returns [OR] First ErrorCode thrown by filemanager::CommitFile();
+ * @returns [OR] ErrorCodes thrown by filemanager::SafeDeleteFile(); (a restored food catalog replaces the catalog of the other format).
+ * @returns [OR] ErrorCodes thrown by any of this functions: filemanager::RebuildYearMap(); events::CheckEvents(); (year presence maps and event indexes of restored years are rebuilt once files are written).
+**/
+ErrorCode backup::CommitRestoreFiles(const string& usr, vector<s_restore_entry>& entries, progress_callback progress){
+    fs::path to = user_folder(usr);
+    //Create folders first, so workers do not race on them.
+    vector<size_t> valid;
+    set<fs::path> folders;
+    for (size_t i = 0; i < entries.size(); i++){
+        if (entries[i].status == EC_None){
+            valid.push_back(i);
+            folders.insert((to / entries[i].path).parent_path());
+        }
+    }
+    error_code f_ec;
+    for (const fs::path& folder : folders){
+        if (!fs::exists(folder) && !fs::create_directories(folder, f_ec)){
+            return EC_DirCreateNoPerm;
+        }
+    }
+    //Write files
+    RunParallel(valid.size(), [&](size_t i){
+        s_restore_entry& entry = entries[valid[i]];
+        entry.status = filemanager::CommitFile(to / entry.path, entry.data);
+        entry.data = string();
+    }, progress);
+    //Return first error, if any.
+    set<int> years, event_years;
+    bool dat_restored = 0, bin_restored = 0;
+    for (size_t i : valid){
+        if (entries[i].status != EC_None){
+            return entries[i].status;
+        }
+        //Save restored catalog formats
+        if (entries[i].path == usr + "_foods.dat"){
+            dat_restored = 1;
+        }
+        else if (entries[i].path == usr + "_foods.bin"){
+            bin_restored = 1;
+        }
+        //Save restored years (from year files or day file folders)
+        int year;
+        string first = fs::path(entries[i].path).begin()->string();
+        if (filemanager::IsYearFileName(first, "_year.bin", &year) || filemanager::IsYearFileName(first, "_days.map", &year)){
+            years.insert(year);
+        }
+        else if (filemanager::IsYearFileName(first, "_events.log", &year) || filemanager::IsYearFileName(first, "_events.idx", &year)){
+            event_years.insert(year);
+        }
+        else if (first != entries[i].path && first.length() < 10 && strings::IsNumericStr(first, Mode_Int)){
+            years.insert(stoi(first));
+        }
+    }
+    //Only the restored food catalog may stay. A binary catalog wins over a text one (as in ValidateUserFolder()), so the other format is removed.
+    if (dat_restored || bin_restored){
+        fs::path stale_p = bin_restored ? fs::path(foods_dat(usr)) : fs::path(foods_bin(usr));
+        if (fs::exists(stale_p)){
+            ErrorCode ec = filemanager::SafeDeleteFile(stale_p);
+            if (ec != EC_None){
+                return ec;
+            }
+        }
+    }
+    //Rebuild presence maps of restored years
+    for (int year : years){
+        ErrorCode ec = filemanager::RebuildYearMap(usr, year);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Check restored event logs against their day index (rebuilt if needed).
+    for (int year : event_years){
+        ErrorCode ec = events::CheckEvents(usr, year);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    return EC_None;
+}
+#pragma endregion
+#pragma region Full Backup
+/**
+ * @brief Back up the whole data folder (users.dat, nutrients.dat and every registered user folder) into <root>/data_<timestamp>. Users are copied in parallel, and a manifest with per-user file count, size and hash is written (a user without a folder is recorded with 0 files). The backup is built in a hidden folder and renamed into place once complete.
+ * @param root Backup root folder. It must exist.
+ * @param jobs Maximum users copied at once (I/O concurrency limit). If 0, hardware threads are used, up to RESTORE_MAX_JOBS.
+ * @param backup_p Path that will contain the created backup folder.
+ * @param users Vector that will contain one result per registered user. It will be cleared.
+ * @param progress Progress callback (users done), or NULL.
+ * @returns Possible ErrorCodes: EC_DirNotFound; EC_DirCreateNoPerm; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: filemanager::ReadFileData(); filemanager::CommitFile(); CopyAndHash(); CopyUserFolder();
+ * @warning Run it while no user is writing data (e.g. before the interactive session starts). Each file is copied whole, as files are always replaced atomically.
+**/
+ErrorCode backup::BackupAll(const fs::path& root, const size_t jobs, fs::path& backup_p, vector<s_user_backup>& users, progress_callback progress){
+    users.clear();
+    if (!fs::is_directory(root)){
+        return EC_DirNotFound;
+    }
+    //Read registered users
+    string users_data;
+    ErrorCode ec = filemanager::ReadFileData(users_dat_p, users_data);
+    if (ec != EC_None){
+        return ec;
+    }
+    size_t start = 0, end;
+    while ((end = users_data.find('|', start)) != string::npos){
+        string data = users_data.substr(start, end - start);
+        start = end + 1;
+        strings::RemoveBrackets(data);
+        users.push_back({data, EC_None, 0, 0, FNV_OFFSET});
+    }
+    //Choose a free backup name and create work folder
+    backup_p = fs::path(root) / ("data_" + NewSnapshotName());
+    for (int i = 2; fs::exists(backup_p); i++){
+        backup_p = fs::path(root) / ("data_" + NewSnapshotName() + '_' + to_string(i));
+    }
+    fs::path work = fs::path(root) / (".new_" + backup_p.filename().string());
+    error_code f_ec;
+    if (!fs::create_directories(fs::path(work) / "usr", f_ec)){
+        return EC_DirCreateNoPerm;
+    }
+    //Copy users.dat
+    uint64_t users_size, users_hash;
+    ec = CopyAndHash(users_dat_p, work / "users.dat", users_size, users_hash);
+    if (ec != EC_None){
+        fs::remove_all(work, f_ec);
+        return ec;
+    }
+    //Copy nutrient schema (data files hold one value per schema nutrient, so they can not be read back without it).
+    uint64_t schema_size = 0, schema_hash = 0;
+    bool schema = fs::exists(nutrients_dat_p);
+    if (schema){
+        ec = CopyAndHash(nutrients_dat_p, work / "nutrients.dat", schema_size, schema_hash);
+        if (ec != EC_None){
+            fs::remove_all(work, f_ec);
+            return ec;
+        }
+    }
+    //Copy users in parallel. A registered user without a folder (nothing logged yet) is backed up as an empty user.
+    RunParallel(users.size(), [&](size_t i){
+        users[i].status = CopyUserFolder(user_folder(users[i].name), work / "usr" / users[i].name, users[i]);
+        if (users[i].status == EC_DirNotFound){
+            users[i].status = EC_None;
+        }
+    }, progress, jobs);
+    //Build manifest, stopping at the first failed user.
+    string manifest = "{users.dat/1/" + to_string(users_size) + '/' + to_string(users_hash) + "}|";
+    if (schema){
+        manifest += "{nutrients.dat/1/" + to_string(schema_size) + '/' + to_string(schema_hash) + "}|";
+    }
+    for (s_user_backup& user : users){
+        if (user.status != EC_None){
+            fs::remove_all(work, f_ec);
+            return user.status;
+        }
+        manifest += '{' + user.name + '/' + to_string(user.files) + '/' + to_string(user.bytes) + '/' + to_string(user.hash) + "}|";
+    }
+    ec = filemanager::CommitFile(work / full_backup_manifest, manifest);
+    if (ec != EC_None){
+        fs::remove_all(work, f_ec);
+        return ec;
+    }
+    //Move backup into place
+    fs::rename(work, backup_p, f_ec);
+    if (f_ec){
+        fs::remove_all(work, f_ec);
+        return EC_DirCreateNoPerm;
+    }
+    return EC_None;
+}
+#pragma endregion
@@ -0,0 +1,141 @@
+#include "../errors/errors.h"
+#include "../filemanager/filemanager.h"
+#include <filesystem>
+#include <vector>
+
+#ifndef _BACKUP_
+#define _BACKUP_
+
+#pragma region Paths
+#define backup_folder(root, username) filesystem::path(root) / username
+#define snapshots_dat(root, username) filesystem::path(root) / username / "snapshots.dat"
+#define snapshot_manifest(root, username, snapshot) filesystem::path(root) / username / (snapshot + ".manifest")
+#pragma endregion
+namespace backup {
+#pragma region Archive Data
+//Archive file extension, magic and version.
+#define ARCHIVE_EXT ".fbk"
+#define ARCHIVE_MAGIC "FBKA"
+#define ARCHIVE_INDEX_MAGIC "FBKI"
+#define ARCHIVE_VERSION 1
+//Raw bytes per compressed block. Blocks are compressed and checked independently, so files can be streamed.
+#define ARCHIVE_BLOCK 65536
+/**
+ * @brief Archive file header.
+ * @param magic (char[4]) Always ARCHIVE_MAGIC.
+ * @param version (uint32_t) Archive format version.
+**/
+typedef struct {
+    char magic[4];
+    uint32_t version;
+} s_archive_header;
+/**
+ * @brief Archive file footer, at the very end of the file, right after the index.
+ * @param index_offset (uint64_t) Byte offset of the index.
+ * @param index_hash (uint64_t) FNV-1a hash of the index bytes.
+ * @param entries (uint32_t) Files in the index.
+ * @param magic (char[4]) Always ARCHIVE_INDEX_MAGIC.
+**/
+typedef struct {
+    uint64_t index_offset;
+    uint64_t index_hash;
+    uint32_t entries;
+    char magic[4];
+} s_archive_footer;
+/**
+ * @brief Archive index entry, one per file. File data is a run of blocks (raw size, stored size, bytes) starting at offset.
+ * @param path (string) File path relative to the user folder (generic format).
+ * @param offset (uint64_t) Byte offset of the first block.
+ * @param size (uint64_t) Uncompressed file size.
+ * @param stored (uint64_t) Bytes taken inside the archive, block headers included.
+ * @param hash (uint64_t) FNV-1a hash of the uncompressed file.
+**/
+typedef struct {
+    string path;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t stored;
+    uint64_t hash;
+} s_archive_entry;
+#pragma endregion
+#pragma region Data
+/**
+ * @brief Backup snapshot summary, as listed in snapshots.dat.
+ * @param name (string) Snapshot name (creation timestamp, YYYY-MM-DD_hh-mm-ss). Also the snapshot folder name.
+ * @param files (uint64_t) Files inside the snapshot.
+ * @param bytes (uint64_t) Total size of those files.
+ * @param copied (uint64_t) Files copied when the snapshot was created (the rest were hard-linked from the previous snapshot).
+**/
+typedef struct {
+    string name;
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t copied;
+} s_snapshot;
+/**
+ * @brief Snapshot manifest entry, one per file.
+ * @param path (string) File path relative to the user folder (generic format).
+ * @param size (uint64_t) File size in bytes.
+ * @param mtime (uint64_t) Last write time of the source file when the snapshot was taken (raw clock ticks, only compared for equality).
+ * @param hash (uint64_t) FNV-1a hash of the file content.
+**/
+typedef struct {
+    string path;
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t hash;
+} s_manifest_entry;
+#pragma endregion
+#pragma region Restore Data
+//Maximum worker threads used to read, validate and write restored files.
+#define RESTORE_MAX_JOBS 8
+/**
+ * @brief Restore entry, one per backup file.
+ * @param path (string) File path relative to the user folder (generic format).
+ * @param status (ErrorCode) EC_None if the file can be restored, EC_FileCorrupted if it holds no valid data, EC_WrongFile if it is not a user data file, or the read error. After CommitRestoreFiles(), the write result.
+ * @param repaired (bool) Set if invalid entries had to be discarded (or missing ones added) to make the file valid.
+ * @param data (string) Validated file content. Released once written.
+**/
+typedef struct {
+    string path;
+    ErrorCode status;
+    bool repaired;
+    string data;
+} s_restore_entry;
+//Progress report callback. It is called from the calling thread while workers run, and once more when they are done.
+typedef void (*progress_callback)(const uint64_t done, const uint64_t total);
+#pragma endregion
+#pragma region Full Backup Data
+#define full_backup_manifest "manifest.dat"
+/**
+ * @brief Per-user result of a full backup, as listed in the full backup manifest.
+ * @param name (string) In-file user name.
+ * @param status (ErrorCode) Copy result.
+ * @param files (uint64_t) Files copied.
+ * @param bytes (uint64_t) Total size of those files.
+ * @param hash (uint64_t) FNV-1a hash over every file path and content hash of the user, in path order.
+**/
+typedef struct {
+    string name;
+    ErrorCode status;
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t hash;
+} s_user_backup;
+#pragma endregion
+#pragma region Public Function Headers
+ErrorCode CreateSnapshot(const filesystem::path& root, const string& usr, s_snapshot& snapshot);
+ErrorCode ListSnapshots(const filesystem::path& root, const string& usr, vector<s_snapshot>& snapshots);
+ErrorCode ReadManifest(const filesystem::path& root, const string& usr, const string& snapshot, vector<s_manifest_entry>& entries);
+filesystem::path GetSnapshotPath(const filesystem::path& root, const string& usr, const string& snapshot);
+ErrorCode CreateArchive(const filesystem::path& folder, const string& usr, filesystem::path& archive_p, vector<s_archive_entry>& entries);
+ErrorCode ReadArchiveIndex(const filesystem::path& archive_p, vector<s_archive_entry>& entries);
+ErrorCode ExtractArchiveEntry(const filesystem::path& archive_p, const s_archive_entry& entry, const filesystem::path& to);
+ErrorCode ExtractArchive(const filesystem::path& archive_p, const filesystem::path& to);
+ErrorCode ReadRestoreFiles(const filesystem::path& from, const string& usr, vector<s_restore_entry>& entries, progress_callback progress = NULL);
+ErrorCode ReadRestoreArchive(const filesystem::path& archive_p, const vector<s_archive_entry>& files, const string& usr, vector<s_restore_entry>& entries, progress_callback progress = NULL);
+ErrorCode CommitRestoreFiles(const string& usr, vector<s_restore_entry>& entries, progress_callback progress = NULL);
+ErrorCode BackupAll(const filesystem::path& root, const size_t jobs, filesystem::path& backup_p, vector<s_user_backup>& users, progress_callback progress = NULL);
+#pragma endregion
+}
+#endif
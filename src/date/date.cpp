@@ -2,6 +2,7 @@
 using namespace std::chrono;
 #include "date.h"
 using namespace date;
+#include "../io/io_fb.h"
 
 #pragma region Free Functions
 /**
@@ -88,6 +89,40 @@ uint8_t date::GetMonthLength(const month_name month, const int& year){
         }
     }
 }
+/**
+ * @brief Get position of a day inside its year, accounting for leap years.
+ * @param year Year the day belongs to.
+ * @param month Month the day belongs to.
+ * @param month_day Day of the month.
+ * @returns Day of the year, from 0 (January 1) up to 365.
+**/
+uint16_t date::GetYearDay(const int& year, const month_name month, const uint8_t month_day){
+    uint16_t year_day = month_day - 1;
+    //Add length of every previous month
+    for (uint8_t m = January; m < month; m++){
+        year_day += GetMonthLength(static_cast<month_name>(m), year);
+    }
+    return year_day;
+}
+/**
+ * @brief Get the date of a day of the year (inverse of GetYearDay()).
+ * @param year Year the day belongs to.
+ * @param year_day Day of the year, from 0 (January 1) up to 365.
+ * @param date_struct Struct that will contain the date, week day included.
+**/
+void date::YearDayToDate(const int& year, uint16_t year_day, s_date& date_struct){
+    //Skip whole months
+    uint8_t m = January;
+    while (m < December && year_day >= GetMonthLength(static_cast<month_name>(m), year)){
+        year_day -= GetMonthLength(static_cast<month_name>(m), year);
+        m++;
+    }
+    date_struct.year = year;
+    date_struct.month = static_cast<month_name>(m);
+    date_struct.month_day = year_day + 1;
+    date_struct.week_day = CalcDayOfWeek(year, m, year_day + 1);
+    return;
+}
 /**
  * @brief Transforms a wday_name enum to a string.
  * @param wday Week day enum to transform.
@@ -197,15 +232,21 @@ void calendar::operator --(int){
 void calendar::RefreshDate(){
     //Get current date from chrono.
     time_t epoch_time = chrono::system_clock::to_time_t(chrono::system_clock::now());
-    tm* time_local = localtime(&epoch_time);
+    //Convert to local time. Calendars may be refreshed from several threads at once (files check), so use the reentrant version on Linux (Windows localtime() already uses a per-thread buffer).
+    tm time_local;
+    #if LINUX
+    localtime_r(&epoch_time, &time_local);
+    #else
+    time_local = *localtime(&epoch_time);
+    #endif
     //Correct year difference and set it.
-    year = time_local->tm_year + 1900;
+    year = time_local.tm_year + 1900;
     //Correct month difference and set it.
-    month = static_cast<month_name>(time_local->tm_mon + 1);
+    month = static_cast<month_name>(time_local.tm_mon + 1);
     //Set month day
-    month_day = time_local->tm_mday;
+    month_day = time_local.tm_mday;
     //Correct week day difference and set it.
-    week_day = time_local->tm_wday == 0 ? wday_name::Sunday : static_cast<wday_name>(time_local->tm_wday);
+    week_day = time_local.tm_wday == 0 ? wday_name::Sunday : static_cast<wday_name>(time_local.tm_wday);
     return;
 }
 /**
@@ -240,15 +281,6 @@ uint8_t calendar::GetMonthDay(){
 wday_name calendar::GetWeekDay(){
     return week_day;
 }
-/**
- * @brief Print currently set date.
- * @warning Do not confuse this date for the real date.
-**/
-void calendar::PrintDate(){
-    cout << WeekDayToStr(week_day) << ' ' + to_string(month_day) + " of ";
-    cout << MonthToStr(month) + " of " << year << '\n';
-    return;
-}
 /**
  * @brief Advances saved date one day into the future.
 **/
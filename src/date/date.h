@@ -50,6 +50,8 @@ typedef struct {
 bool IsLeapYear(const int& year);
 wday_name CalcDayOfWeek(int yr, uint8_t mth, uint8_t mth_day);
 uint8_t GetMonthLength(const month_name month, const int& year);
+uint16_t GetYearDay(const int& year, const month_name month, const uint8_t month_day);
+void YearDayToDate(const int& year, uint16_t year_day, s_date& date_struct);
 string MonthToStr(const month_name month);
 string WeekDayToStr(const wday_name wday);
 #pragma endregion
@@ -72,7 +74,6 @@ class calendar {
     month_name GetMonth();
     uint8_t GetMonthDay();
     wday_name GetWeekDay();
-    void PrintDate();
 
     //Private vars
     private:  
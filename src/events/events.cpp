@@ -0,0 +1,698 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <filesystem>
+namespace fs = filesystem;
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <unordered_map>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "events.h"
+using namespace events;
+#include "../io/io_fb.h"
+using namespace io_fb;
+#include "../latency/latency.h"
+#include "../profiler/profiler.h"
+#include "../nutrients/nutrients.h"
+namespace fm = filemanager;
+
+#pragma region Internal Use Functions
+/**
+ * @brief Consumption event as written by events format version 1 (exactly NUM_OF_MACROS macros). Only used to migrate old logs.
+**/
+typedef struct {
+    int64_t timestamp;
+    char food[MAX_FOOD_NAME];
+    uint8_t portions;
+    uint16_t year_day;
+    uint64_t amount;
+    double macros[NUM_OF_MACROS];
+} s_event_v1;
+/**
+ * @brief Build an events file header.
+ * @param magic EVENTS_LOG_MAGIC or EVENTS_INDEX_MAGIC.
+ * @param year Year the file holds.
+ * @param record_size Size of every record in file.
+ * @returns Header ready to write.
+**/
+s_events_header MakeHeader(const char* magic, const int year, const uint32_t record_size){
+    s_events_header header = {{0}, EVENTS_VERSION, year, record_size};
+    memcpy(header.magic, magic, 4);
+    return header;
+}
+/**
+ * @brief Checks an events file header.
+ * @param header Header to check.
+ * @param magic Expected magic.
+ * @param year Expected year.
+ * @param record_size Expected record size.
+ * @returns 1(true) if header is valid, 0(false) if not.
+**/
+bool IsValidHeader(const s_events_header& header, const char* magic, const int year, const uint32_t record_size){
+    return memcmp(header.magic, magic, 4) == 0 && header.version == EVENTS_VERSION && header.year == year && header.record_size == record_size;
+}
+/**
+ * @brief Checks if an event holds sane data.
+ * @param event Event to check.
+ * @param year Year the event belongs to.
+ * @returns 1(true) if event is valid, 0(false) if not.
+**/
+bool IsValidEvent(const s_event& event, const int year){
+    //Check day, counting mode and amount
+    if (event.year_day >= (date::IsLeapYear(year) ? 366 : 365) || event.portions > 1 || event.amount == 0){
+        return 0;
+    }
+    //Check food name
+    size_t len = strnlen(event.food, MAX_FOOD_NAME);
+    if (len == MAX_FOOD_NAME || !name::IsValidName(string(event.food, len), 1)){
+        return 0;
+    }
+    //Check nutrients
+    for (uint8_t i = 0; i < MAX_NUTRIENTS; i++){
+        if (!isfinite(event.macros[i]) || event.macros[i] < 0){
+            return 0;
+        }
+    }
+    return 1;
+}
+/**
+ * @brief Read part of a file.
+ * @param file_p Path to file.
+ * @param offset Byte offset to start reading at.
+ * @param size Amount of bytes to read.
+ * @param data Pointer to a buffer of at least size bytes.
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_FileCorrupted; EC_None;
+**/
+ErrorCode ReadFileRange(const fs::path& file_p, const uint64_t offset, const size_t size, void* data){
+    ifstream data_in;
+    data_in.open(file_p, ios_base::binary);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    data_in.seekg(offset);
+    data_in.read((char*)data, size);
+    profiler::CountRead(data_in.gcount());
+    //A short read means the file is not as big as its index says.
+    if ((size_t)data_in.gcount() != size){
+        return EC_FileCorrupted;
+    }
+    data_in.close();
+    return EC_None;
+}
+/**
+ * @brief Get byte offset of a day slot inside the day index.
+ * @param year_day Day of the year.
+ * @returns Slot offset.
+**/
+uint64_t SlotOffset(const uint16_t year_day){
+    return sizeof(s_events_header) + (uint64_t)year_day * sizeof(s_events_slot);
+}
+/**
+ * @brief Date partition of an analytics query: a day range inside a single year.
+ * @param year (int) Partition year.
+ * @param first_day (uint16_t) First day of the year (0 based).
+ * @param last_day (uint16_t) Last day of the year (included).
+**/
+typedef struct {
+    int year;
+    uint16_t first_day;
+    uint16_t last_day;
+} s_partition;
+/**
+ * @brief Read the day index of a year, rebuilding it if it is missing or does not match its log.
+ * @param username User to read.
+ * @param year Target year. Its log must exist.
+ * @param slots Vector that will contain the YEAR_BIN_DAYS day slots.
+ * @returns ErrorCodes thrown by any of this functions: fm::ReadFileData(); CheckEvents(); EventsIndexDataCheck();
+**/
+ErrorCode ReadDayIndex(const string& username, const int year, vector<s_events_slot>& slots){
+    ErrorCode ec = CheckEvents(username, year);
+    if (ec != EC_None){
+        return ec;
+    }
+    string idx_data;
+    ec = fm::ReadFileData(GetEventsIndexPath(username, year), idx_data);
+    if (ec != EC_None){
+        return ec;
+    }
+    return EventsIndexDataCheck(idx_data, year, fs::file_size(GetEventsLogPath(username, year)), &slots);
+}
+/**
+ * @brief Stream the events of a date partition and aggregate them by food. Only the log byte range covering the partition days is read, in blocks of EVENTS_READ_BLOCK events.
+ * @param username User to read.
+ * @param part Partition to aggregate.
+ * @param slots Day index of the partition year.
+ * @param values Nutrients to add up (nutrients::Count()).
+ * @param stats Map (by food name) that will contain the partition aggregates.
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_FileCorrupted; EC_None;
+**/
+ErrorCode AggregatePartition(const string& username, const s_partition& part, const vector<s_events_slot>& slots, const uint8_t values, unordered_map<string, s_food_stats>& stats){
+    //Get byte range of the partition days
+    uint64_t first = UINT64_MAX, last = 0;
+    for (uint16_t d = part.first_day; d <= part.last_day; d++){
+        if (slots[d].count != 0){
+            first = min(first, slots[d].first);
+            last = max(last, slots[d].last);
+        }
+    }
+    //No events in partition
+    if (first == UINT64_MAX){
+        return EC_None;
+    }
+    //Open log
+    ifstream data_in;
+    data_in.open(GetEventsLogPath(username, part.year), ios_base::binary);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    data_in.seekg(first);
+    //Stream events
+    vector<s_event> block(EVENTS_READ_BLOCK);
+    uint64_t left = (last - first) / sizeof(s_event) + 1;
+    while (left > 0){
+        size_t count = min<uint64_t>(left, EVENTS_READ_BLOCK);
+        data_in.read((char*)block.data(), count * sizeof(s_event));
+        if ((size_t)data_in.gcount() != count * sizeof(s_event)){
+            return EC_FileCorrupted;
+        }
+        for (size_t i = 0; i < count; i++){
+            const s_event& event = block[i];
+            if (event.year_day < part.first_day || event.year_day > part.last_day){
+                continue;
+            }
+            //Add event to its food
+            string food(event.food, strnlen(event.food, MAX_FOOD_NAME));
+            auto it = stats.find(food);
+            if (it == stats.end()){
+                s_food_stats empty = {food, 0, {0}};
+                it = stats.emplace(food, empty).first;
+            }
+            it->second.times++;
+            for (uint8_t m = 0; m < values; m++){
+                it->second.macros[m] += event.macros[m];
+            }
+        }
+        left -= count;
+    }
+    data_in.close();
+    return EC_None;
+}
+#pragma endregion
+#pragma region Events
+/**
+ * @brief Get event log path for the given year and user.
+ * @param username Name of the user to search.
+ * @param year Target year.
+ * @returns filesystem::path to <year>_events.log inside the user folder.
+ * @warning The function does NOT check if the file exists.
+**/
+filesystem::path events::GetEventsLogPath(const string& username, const int year){
+    fs::path path = user_folder(username);
+    path.append(to_string(year) + "_events.log");
+    return path;
+}
+/**
+ * @brief Get event day index path for the given year and user.
+ * @param username Name of the user to search.
+ * @param year Target year.
+ * @returns filesystem::path to <year>_events.idx inside the user folder.
+ * @warning The function does NOT check if the file exists.
+**/
+filesystem::path events::GetEventsIndexPath(const string& username, const int year){
+    fs::path path = user_folder(username);
+    path.append(to_string(year) + "_events.idx");
+    return path;
+}
+/**
+ * @brief Migrate event log data written in an older format to the current one. Version 1 events held exactly NUM_OF_MACROS macros; they keep their index and the other nutrients are 0. A partially appended event at the end is dropped.
+ * @param file_data Whole <year>_events.log content. Replaced if migrated; left untouched if it is current or not a recognized log.
+ * @returns 1(true) if data was migrated, 0(false) if not.
+**/
+bool events::MigrateEventsLogData(string& file_data){
+    //Check header
+    s_events_header header;
+    if (file_data.size() < sizeof(header)){
+        return 0;
+    }
+    memcpy(&header, file_data.data(), sizeof(header));
+    if (memcmp(header.magic, EVENTS_LOG_MAGIC, 4) != 0 || header.version != 1 || header.record_size != sizeof(s_event_v1)){
+        return 0;
+    }
+    //Convert events
+    size_t count = (file_data.size() - sizeof(header)) / sizeof(s_event_v1);
+    string data;
+    data.reserve(sizeof(header) + count * sizeof(s_event));
+    s_event_v1 old_event;
+    s_event event;
+    for (size_t i = 0; i < count; i++){
+        memcpy(&old_event, file_data.data() + sizeof(header) + i * sizeof(old_event), sizeof(old_event));
+        memset(&event, 0, sizeof(event));
+        event.timestamp = old_event.timestamp;
+        memcpy(event.food, old_event.food, MAX_FOOD_NAME);
+        event.portions = old_event.portions;
+        event.year_day = old_event.year_day;
+        event.amount = old_event.amount;
+        for (uint8_t m = 0; m < NUM_OF_MACROS; m++){
+            event.macros[m] = old_event.macros[m];
+        }
+        data.append((const char*)&event, sizeof(event));
+    }
+    //Write current header
+    header.version = EVENTS_VERSION;
+    header.record_size = sizeof(s_event);
+    data.insert(0, (const char*)&header, sizeof(header));
+    file_data = move(data);
+    return 1;
+}
+/**
+ * @brief Migrate day index data written in an older format to the current one: slot offsets are moved to where MigrateEventsLogData() puts their events.
+ * @param file_data Whole <year>_events.idx content. Replaced if migrated; left untouched if it is current or not a recognized index.
+ * @returns 1(true) if data was migrated, 0(false) if not.
+**/
+bool events::MigrateEventsIndexData(string& file_data){
+    //Check header
+    s_events_header header;
+    if (file_data.size() != sizeof(header) + YEAR_BIN_DAYS * sizeof(s_events_slot)){
+        return 0;
+    }
+    memcpy(&header, file_data.data(), sizeof(header));
+    if (memcmp(header.magic, EVENTS_INDEX_MAGIC, 4) != 0 || header.version != 1 || header.record_size != sizeof(s_events_slot)){
+        return 0;
+    }
+    //Move slot offsets
+    s_events_slot slot;
+    for (size_t offset = sizeof(header); offset < file_data.size(); offset += sizeof(slot)){
+        memcpy(&slot, file_data.data() + offset, sizeof(slot));
+        if (slot.count != 0 && slot.first >= sizeof(header) && slot.last >= sizeof(header)){
+            slot.first = sizeof(header) + (slot.first - sizeof(header)) / sizeof(s_event_v1) * sizeof(s_event);
+            slot.last = sizeof(header) + (slot.last - sizeof(header)) / sizeof(s_event_v1) * sizeof(s_event);
+        }
+        memcpy(file_data.data() + offset, &slot, sizeof(slot));
+    }
+    //Write current header
+    header.version = EVENTS_VERSION;
+    memcpy(file_data.data(), &header, sizeof(header));
+    return 1;
+}
+/**
+ * @brief Check a whole event log (header and every event) without touching any file.
+ * @param file_data Whole <year>_events.log content.
+ * @param year Year the log must hold.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+**/
+ErrorCode events::EventsLogDataCheck(const string& file_data, const int year){
+    s_events_header header;
+    if (file_data.size() < sizeof(header) || (file_data.size() - sizeof(header)) % sizeof(s_event) != 0){
+        return EC_FileCorrupted;
+    }
+    memcpy(&header, file_data.data(), sizeof(header));
+    if (!IsValidHeader(header, EVENTS_LOG_MAGIC, year, sizeof(s_event))){
+        return EC_FileCorrupted;
+    }
+    //Check every event
+    s_event event;
+    for (size_t offset = sizeof(header); offset < file_data.size(); offset += sizeof(event)){
+        memcpy(&event, file_data.data() + offset, sizeof(event));
+        if (!IsValidEvent(event, year)){
+            return EC_FileCorrupted;
+        }
+    }
+    return EC_None;
+}
+/**
+ * @brief Check a day index without touching any file.
+ * @param file_data Whole <year>_events.idx content.
+ * @param year Year the index must hold.
+ * @param log_size Size of the event log the index points into. Every slot must point inside it.
+ * @param slots Optional pointer to a vector that will contain the YEAR_BIN_DAYS day slots.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+**/
+ErrorCode events::EventsIndexDataCheck(const string& file_data, const int year, const uint64_t log_size, vector<s_events_slot>* slots){
+    s_events_header header;
+    if (file_data.size() != sizeof(header) + YEAR_BIN_DAYS * sizeof(s_events_slot)){
+        return EC_FileCorrupted;
+    }
+    memcpy(&header, file_data.data(), sizeof(header));
+    if (!IsValidHeader(header, EVENTS_INDEX_MAGIC, year, sizeof(s_events_slot))){
+        return EC_FileCorrupted;
+    }
+    //Check every slot points to whole events inside the log
+    vector<s_events_slot> t_slots(YEAR_BIN_DAYS);
+    memcpy(t_slots.data(), file_data.data() + sizeof(header), YEAR_BIN_DAYS * sizeof(s_events_slot));
+    for (const s_events_slot& slot : t_slots){
+        if (slot.count == 0){
+            continue;
+        }
+        if (slot.first > slot.last || slot.first < sizeof(s_events_header) || (slot.first - sizeof(s_events_header)) % sizeof(s_event) != 0 || (slot.last - sizeof(s_events_header)) % sizeof(s_event) != 0){
+            return EC_FileCorrupted;
+        }
+        if (slot.last + sizeof(s_event) > log_size || slot.count > (slot.last - slot.first) / sizeof(s_event) + 1){
+            return EC_FileCorrupted;
+        }
+    }
+    if (slots != NULL){
+        *slots = move(t_slots);
+    }
+    return EC_None;
+}
+/**
+ * @brief Append an event to the user event log of the given date, and point the day index to it. Files are created if missing.
+ * @param username User to write.
+ * @param date_data Date the event belongs to.
+ * @param event Event to append. Its year_day is set by this function. Zero it before filling it, so padding bytes are stable.
+ * @returns ErrorCodes thrown by AppendEvents();
+**/
+ErrorCode events::AppendEvent(const string& username, const date::s_date& date_data, s_event& event){
+    return AppendEvents(username, date_data, &event, 1);
+}
+/**
+ * @brief Append several events of the same day to the user event log with a single write, and point the day index to them. Files are created if missing.
+ * @param username User to write.
+ * @param date_data Date the events belong to.
+ * @param events Events to append, in order. Their year_day is set by this function. Zero them before filling them, so padding bytes are stable.
+ * @param count Amount of events.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: fm::CommitFile(); fm::WriteFileAt(); RebuildEventsIndex(); ReadFileRange();
+ * @warning The events are written first and the index after. If interrupted in between, the events are left out of the index until it gets rebuilt.
+**/
+ErrorCode events::AppendEvents(const string& username, const date::s_date& date_data, s_event* events, const size_t count){
+    if (count == 0){
+        return EC_None;
+    }
+    fs::path log_p = GetEventsLogPath(username, date_data.year);
+    fs::path idx_p = GetEventsIndexPath(username, date_data.year);
+    ErrorCode ec;
+    //Create log if missing
+    if (!fs::exists(log_p)){
+        s_events_header header = MakeHeader(EVENTS_LOG_MAGIC, date_data.year, sizeof(s_event));
+        ec = fm::CommitFile(log_p, string((const char*)&header, sizeof(header)));
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Create index if missing (the log may already hold events).
+    if (!fs::exists(idx_p)){
+        ec = RebuildEventsIndex(username, date_data.year);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Get log end. It must be a whole number of events.
+    uint64_t offset = fs::file_size(log_p);
+    if (offset < sizeof(s_events_header) || (offset - sizeof(s_events_header)) % sizeof(s_event) != 0){
+        return EC_FileCorrupted;
+    }
+    //Read day slot
+    uint16_t year_day = date::GetYearDay(date_data.year, date_data.month, date_data.month_day);
+    s_events_slot slot;
+    ec = ReadFileRange(idx_p, SlotOffset(year_day), sizeof(slot), &slot);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Append events
+    for (size_t i = 0; i < count; i++){
+        events[i].year_day = year_day;
+    }
+    ec = fm::WriteFileAt(log_p, offset, events, count * sizeof(s_event));
+    if (ec != EC_None){
+        return ec;
+    }
+    //Update day slot
+    if (slot.count == 0){
+        slot.first = offset;
+    }
+    slot.last = offset + (count - 1) * sizeof(s_event);
+    slot.count += count;
+    return fm::WriteFileAt(idx_p, SlotOffset(year_day), &slot, sizeof(slot));
+}
+/**
+ * @brief Read every event of a day, in the order they were logged. The day slot is read with a single seek, then the day event range is read at once.
+ * @param username User to read.
+ * @param date_data Target day.
+ * @param events Vector that will contain the events. It will be cleared.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: RebuildEventsIndex(); ReadFileRange();
+**/
+ErrorCode events::ReadDayEvents(const string& username, const date::s_date& date_data, vector<s_event>& events){
+    latency::phase_scope phase(latency::PH_Parse);
+    events.clear();
+    fs::path log_p = GetEventsLogPath(username, date_data.year);
+    fs::path idx_p = GetEventsIndexPath(username, date_data.year);
+    ErrorCode ec;
+    //No log, no events
+    if (!fs::exists(log_p)){
+        return EC_None;
+    }
+    //Rebuild index if missing
+    if (!fs::exists(idx_p)){
+        ec = RebuildEventsIndex(username, date_data.year);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Read day slot
+    uint16_t year_day = date::GetYearDay(date_data.year, date_data.month, date_data.month_day);
+    s_events_slot slot;
+    ec = ReadFileRange(idx_p, SlotOffset(year_day), sizeof(slot), &slot);
+    if (ec != EC_None || slot.count == 0){
+        return ec;
+    }
+    //Read day range. Events of a day are normally contiguous; anything else in between is skipped.
+    vector<s_event> range((slot.last - slot.first) / sizeof(s_event) + 1);
+    ec = ReadFileRange(log_p, slot.first, range.size() * sizeof(s_event), range.data());
+    if (ec != EC_None){
+        return ec;
+    }
+    for (const s_event& event : range){
+        if (event.year_day == year_day){
+            events.push_back(event);
+        }
+    }
+    return EC_None;
+}
+/**
+ * @brief Rebuild the day index of an event log by scanning the whole log.
+ * @param username User to rebuild.
+ * @param year Target year.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: fm::ReadFileData(); fm::CommitFile();
+**/
+ErrorCode events::RebuildEventsIndex(const string& username, const int year){
+    //Read log
+    string log_data;
+    ErrorCode ec = fm::ReadFileData(GetEventsLogPath(username, year), log_data);
+    if (ec != EC_None){
+        return ec;
+    }
+    s_events_header header;
+    if (log_data.size() < sizeof(header)){
+        return EC_FileCorrupted;
+    }
+    memcpy(&header, log_data.data(), sizeof(header));
+    if (!IsValidHeader(header, EVENTS_LOG_MAGIC, year, sizeof(s_event))){
+        return EC_FileCorrupted;
+    }
+    //Point every day slot to its events
+    vector<s_events_slot> slots(YEAR_BIN_DAYS, {0, 0, 0, 0});
+    s_event event;
+    for (uint64_t offset = sizeof(header); offset + sizeof(event) <= log_data.size(); offset += sizeof(event)){
+        memcpy(&event, log_data.data() + offset, sizeof(event));
+        if (event.year_day >= YEAR_BIN_DAYS){
+            continue;
+        }
+        s_events_slot& slot = slots[event.year_day];
+        if (slot.count == 0){
+            slot.first = offset;
+        }
+        slot.last = offset;
+        slot.count++;
+    }
+    //Write index
+    header = MakeHeader(EVENTS_INDEX_MAGIC, year, sizeof(s_events_slot));
+    string idx_data((const char*)&header, sizeof(header));
+    idx_data.append((const char*)slots.data(), slots.size() * sizeof(s_events_slot));
+    return fm::CommitFile(GetEventsIndexPath(username, year), idx_data);
+}
+/**
+ * @brief Check the event files of a year at boot: migrate a log written in an older format, drop a partially appended event, and rebuild the day index if it is missing or does not match the log. Only the log header and the index are read, not the whole log (unless it has to be migrated).
+ * @param username User to check.
+ * @param year Target year.
+ * @returns Possible ErrorCodes: EC_FileCorrupted (log header is not valid, remove both files); EC_FileWriteNoPerm; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: ReadFileRange(); fm::ReadFileData(); fm::CommitFile(); fm::SafeDeleteFile(); RebuildEventsIndex();
+**/
+ErrorCode events::CheckEvents(const string& username, const int year){
+    fs::path log_p = GetEventsLogPath(username, year);
+    fs::path idx_p = GetEventsIndexPath(username, year);
+    ErrorCode ec;
+    //If there is no log, an index is useless.
+    if (!fs::exists(log_p)){
+        return fs::exists(idx_p) ? fm::SafeDeleteFile(idx_p) : EC_None;
+    }
+    //Check log header
+    s_events_header header;
+    uint64_t log_size = fs::file_size(log_p);
+    if (log_size < sizeof(header)){
+        return EC_FileCorrupted;
+    }
+    ec = ReadFileRange(log_p, 0, sizeof(header), &header);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Migrate a log written in an older format (its index gets rebuilt, as its version no longer matches).
+    if (memcmp(header.magic, EVENTS_LOG_MAGIC, 4) == 0 && header.version < EVENTS_VERSION){
+        string log_data;
+        ec = fm::ReadFileData(log_p, log_data);
+        if (ec != EC_None){
+            return ec;
+        }
+        if (!MigrateEventsLogData(log_data)){
+            return EC_FileCorrupted;
+        }
+        ec = fm::CommitFile(log_p, log_data);
+        if (ec != EC_None){
+            return ec;
+        }
+        memcpy(&header, log_data.data(), sizeof(header));
+        log_size = log_data.size();
+    }
+    if (!IsValidHeader(header, EVENTS_LOG_MAGIC, year, sizeof(s_event))){
+        return EC_FileCorrupted;
+    }
+    //Drop a partially appended event
+    uint64_t extra = (log_size - sizeof(header)) % sizeof(s_event);
+    if (extra != 0){
+        error_code f_ec;
+        log_size -= extra;
+        fs::resize_file(log_p, log_size, f_ec);
+        if (f_ec){
+            return EC_FileWriteNoPerm;
+        }
+    }
+    //Check index against the log
+    if (fs::exists(idx_p)){
+        string idx_data;
+        ec = fm::ReadFileData(idx_p, idx_data);
+        if (ec != EC_None){
+            return ec;
+        }
+        if (EventsIndexDataCheck(idx_data, year, log_size) == EC_None){
+            return EC_None;
+        }
+    }
+    return RebuildEventsIndex(username, year);
+}
+#pragma endregion
+#pragma region Analytics
+/**
+ * @brief Get the best K foods of a date range, ranked by times eaten or by a nutrient. Months of the range are aggregated in parallel (one hash map per month partition), partial results are merged and the best K are kept with a bounded heap.
+ * @param username User to read.
+ * @param from First day of the range.
+ * @param to Last day of the range (included).
+ * @param rank_by Nutrient index to rank by (lower than nutrients::Count()), or RANK_BY_TIMES to rank by times eaten.
+ * @param k Maximum amount of foods.
+ * @param top Vector that will contain the foods, best first (ties ordered by name). Foods that add nothing to the ranked value are left out. It will be cleared.
+ * @param jobs Maximum worker threads. If 0, hardware threads are used.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: ReadDayIndex(); AggregatePartition();
+ * @warning Only eats logged since the event log exists are counted.
+**/
+ErrorCode events::TopFoods(const string& username, const date::s_date& from, const date::s_date& to, const uint8_t rank_by, const size_t k, vector<s_food_stats>& top, const size_t jobs){
+    latency::phase_scope phase(latency::PH_Parse);
+    top.clear();
+    if (k == 0 || (rank_by >= nutrients::Count() && rank_by != RANK_BY_TIMES)){
+        return EC_None;
+    }
+    ErrorCode ec;
+    //Build month partitions for every year with a log
+    vector<s_partition> parts;
+    unordered_map<int, vector<s_events_slot>> year_slots;
+    for (int year = from.year; year <= to.year; year++){
+        if (!fs::exists(GetEventsLogPath(username, year))){
+            continue;
+        }
+        ec = ReadDayIndex(username, year, year_slots[year]);
+        if (ec != EC_None){
+            return ec;
+        }
+        uint16_t first_day = year == from.year ? date::GetYearDay(from.year, from.month, from.month_day) : 0;
+        uint16_t last_day = year == to.year ? date::GetYearDay(to.year, to.month, to.month_day) : YEAR_BIN_DAYS - 1;
+        for (uint8_t m = date::January; m <= date::December; m++){
+            uint16_t m_first = date::GetYearDay(year, static_cast<date::month_name>(m), 1);
+            uint16_t m_last = m_first + date::GetMonthLength(static_cast<date::month_name>(m), year) - 1;
+            if (m_last >= first_day && m_first <= last_day){
+                parts.push_back({year, max(m_first, first_day), min(m_last, last_day)});
+            }
+        }
+    }
+    //Aggregate partitions across workers
+    uint8_t values = nutrients::Count();
+    vector<unordered_map<string, s_food_stats>> partial(parts.size());
+    vector<ErrorCode> results(parts.size(), EC_None);
+    atomic<size_t> next(0);
+    size_t workers = jobs != 0 ? jobs : max<size_t>(1, thread::hardware_concurrency());
+    workers = min(workers, parts.size());
+    vector<thread> threads;
+    for (size_t w = 0; w < workers; w++){
+        threads.emplace_back([&](){
+            for (size_t i = next++; i < parts.size(); i = next++){
+                results[i] = AggregatePartition(username, parts[i], year_slots.at(parts[i].year), values, partial[i]);
+            }
+        });
+    }
+    for (thread& t : threads){
+        t.join();
+    }
+    for (ErrorCode r : results){
+        if (r != EC_None){
+            return r;
+        }
+    }
+    //Merge partial results
+    unordered_map<string, s_food_stats> stats;
+    for (unordered_map<string, s_food_stats>& p : partial){
+        for (auto& [food, p_stats] : p){
+            auto it = stats.find(food);
+            if (it == stats.end()){
+                stats.emplace(food, move(p_stats));
+                continue;
+            }
+            it->second.times += p_stats.times;
+            for (uint8_t m = 0; m < values; m++){
+                it->second.macros[m] += p_stats.macros[m];
+            }
+        }
+    }
+    //Keep the best K with a bounded heap (worst kept food on top).
+    auto value = [rank_by](const s_food_stats& s){
+        return rank_by == RANK_BY_TIMES ? (double)s.times : s.macros[rank_by];
+    };
+    auto better = [&value](const s_food_stats& a, const s_food_stats& b){
+        return value(a) != value(b) ? value(a) > value(b) : a.food < b.food;
+    };
+    priority_queue<s_food_stats, vector<s_food_stats>, decltype(better)> heap(better);
+    for (auto& [food, f_stats] : stats){
+        if (value(f_stats) <= 0){
+            continue;
+        }
+        if (heap.size() < k){
+            heap.push(f_stats);
+        }
+        else if (better(f_stats, heap.top())){
+            heap.pop();
+            heap.push(f_stats);
+        }
+    }
+    //Best first
+    while (!heap.empty()){
+        top.push_back(heap.top());
+        heap.pop();
+    }
+    reverse(top.begin(), top.end());
+    return EC_None;
+}
+#pragma endregion
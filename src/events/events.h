@@ -0,0 +1,91 @@
+#include "../errors/errors.h"
+#include "../filemanager/filemanager.h"
+#include <filesystem>
+#include <vector>
+
+#ifndef _EVENTS_
+#define _EVENTS_
+
+namespace events {
+#pragma region Data
+//Event log and index magic and version. Version 1 events held NUM_OF_MACROS macros (see MigrateEventsLogData()).
+#define EVENTS_LOG_MAGIC "FBEV"
+#define EVENTS_INDEX_MAGIC "FBEI"
+#define EVENTS_VERSION 2
+/**
+ * @brief Header shared by the event log (<year>_events.log) and its day index (<year>_events.idx).
+ * @param magic (char[4]) EVENTS_LOG_MAGIC or EVENTS_INDEX_MAGIC.
+ * @param version (uint32_t) Events format version.
+ * @param year (int32_t) Year the file holds.
+ * @param record_size (uint32_t) Size of every record that follows (s_event or s_events_slot).
+**/
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int32_t year;
+    uint32_t record_size;
+} s_events_header;
+/**
+ * @brief Consumption event, one per eaten food. The event log is an append-only run of these records.
+ * @param timestamp (int64_t) Seconds since epoch when the food was eaten.
+ * @param food (char[MAX_FOOD_NAME]) In-file food name, padded with '\0'.
+ * @param portions (uint8_t) 1 if amount is a portion count, 0 if grams.
+ * @param year_day (uint16_t) Day of the year the event belongs to (see date::GetYearDay()).
+ * @param amount (uint64_t) Eaten portions or grams.
+ * @param macros (double[MAX_NUTRIENTS]) Nutrients added to the day by this event, by schema index. Unused slots are 0.
+**/
+typedef struct {
+    int64_t timestamp;
+    char food[MAX_FOOD_NAME];
+    uint8_t portions;
+    uint16_t year_day;
+    uint64_t amount;
+    double macros[MAX_NUTRIENTS];
+} s_event;
+/**
+ * @brief Day index slot. The index holds YEAR_BIN_DAYS slots after its header, so a day is found with a single seek.
+ * @param first (uint64_t) Byte offset of the first event of the day.
+ * @param last (uint64_t) Byte offset of the last event of the day.
+ * @param count (uint32_t) Events of the day. 0 if none (offsets are meaningless then).
+ * @param reserved (uint32_t) Padding, always 0.
+**/
+typedef struct {
+    uint64_t first;
+    uint64_t last;
+    uint32_t count;
+    uint32_t reserved;
+} s_events_slot;
+#pragma endregion
+#pragma region Analytics Data
+//Events read at once while streaming a log.
+#define EVENTS_READ_BLOCK 1024
+//Rank key for TopFoods() that counts times eaten. Any lower value ranks by that nutrient index.
+#define RANK_BY_TIMES MAX_NUTRIENTS
+/**
+ * @brief Aggregated consumption of a single food over a date range.
+ * @param food (string) In-file food name.
+ * @param times (uint64_t) Times the food was eaten.
+ * @param macros (double[MAX_NUTRIENTS]) Nutrients added by the food over the range, by schema index.
+**/
+typedef struct {
+    string food;
+    uint64_t times;
+    double macros[MAX_NUTRIENTS];
+} s_food_stats;
+#pragma endregion
+#pragma region Public Function Headers
+filesystem::path GetEventsLogPath(const string& username, const int year);
+filesystem::path GetEventsIndexPath(const string& username, const int year);
+bool MigrateEventsLogData(string& file_data);
+bool MigrateEventsIndexData(string& file_data);
+ErrorCode EventsLogDataCheck(const string& file_data, const int year);
+ErrorCode EventsIndexDataCheck(const string& file_data, const int year, const uint64_t log_size, vector<s_events_slot>* slots = NULL);
+ErrorCode AppendEvent(const string& username, const date::s_date& date_data, s_event& event);
+ErrorCode AppendEvents(const string& username, const date::s_date& date_data, s_event* events, const size_t count);
+ErrorCode ReadDayEvents(const string& username, const date::s_date& date_data, vector<s_event>& events);
+ErrorCode RebuildEventsIndex(const string& username, const int year);
+ErrorCode CheckEvents(const string& username, const int year);
+ErrorCode TopFoods(const string& username, const date::s_date& from, const date::s_date& to, const uint8_t rank_by, const size_t k, vector<s_food_stats>& top, const size_t jobs = 0);
+#pragma endregion
+}
+#endif
@@ -4,15 +4,110 @@ using namespace std;
 #include <filesystem>
 namespace fs = filesystem;
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <unordered_set>
+#include <set>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <map>
 #include "filemanager.h"
+#include "../events/events.h"
 using namespace filemanager;
 #include "../io/io_fb.h"
 using namespace io_fb;
 #include "../date/date.h"
+#include "../latency/latency.h"
+#include "../profiler/profiler.h"
+#if LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #pragma region Internal Use Functions
+//Files check result of this thread (NULL unless CheckFiles() is checking a folder on it). Every change to the data files is recorded in it.
+static thread_local s_check_result* c_check = NULL;
+//If 1, the changes recorded by CheckFiles() are skipped (check only run).
+static bool c_check_only = 0;
+//If 1, changes made on this thread are upkeep (derived files rebuilt, default schema written), not repairs (see s_check_issue).
+static thread_local bool c_upkeep = 0;
+/**
+ * @brief Marks the changes made on this thread while in scope as upkeep.
+**/
+class upkeep_scope {
+    public:
+    upkeep_scope(){
+        outer = c_upkeep;
+        c_upkeep = 1;
+    }
+    ~upkeep_scope(){
+        c_upkeep = outer;
+    }
+    private:
+    bool outer;
+};
+//Group commit of this thread (see BeginGroupCommit()): files and folders to flush when it ends, in the order they were written, and the files written.
+static thread_local bool c_grouping = 0;
+static thread_local vector<fs::path> c_group_sync;
+static thread_local vector<fs::path> c_group_files;
+/**
+ * @brief Compacted year file verified by this process. Year files are immutable, so while size and write time match it is not checked again.
+ * @param size (uintmax_t) File size when verified.
+ * @param write_time (filesystem::file_time_type) Last write time when verified.
+ * @param columns (vector<double>) Nutrient columns, if still cached (see YEAR_CACHE_COLUMNS).
+ * @param used (uint64_t) Last time the columns were read (c_year_clock).
+**/
+typedef struct {
+    uintmax_t size;
+    fs::file_time_type write_time;
+    vector<double> columns;
+    uint64_t used;
+} s_year_cache;
+//Year files that keep their columns in memory.
+#define YEAR_CACHE_COLUMNS 32
+//Verified year files by path, and files quarantined by the running files check (guarded by c_year_mutex).
+static mutex c_year_mutex;
+static map<string, s_year_cache> c_year_cache;
+static uint64_t c_year_clock = 0;
+static vector<fs::path> c_quarantined;
+/**
+ * @brief Queue a file or folder to flush when the group commit of this thread ends. Paths already queued are not queued twice.
+ * @param p Path to flush.
+**/
+void GroupSync(const fs::path& p){
+    if (find(c_group_sync.begin(), c_group_sync.end(), p) == c_group_sync.end()){
+        c_group_sync.push_back(p);
+    }
+}
+/**
+ * @brief Keep a file written by the group commit of this thread, if any. Files already kept are not kept twice.
+ * @param p Path to the written file.
+**/
+void GroupWrote(const fs::path& p){
+    if (c_grouping && find(c_group_files.begin(), c_group_files.end(), p) == c_group_files.end()){
+        c_group_files.push_back(p);
+    }
+}
+/**
+ * @brief Record a change about to be made to the data files, if a files check is running on this thread. Changes that are not upkeep are counted as repairs by the startup profiler.
+ * @param action Change type ("write" or "remove").
+ * @param p Path to the file or folder to change.
+ * @returns 1(true) if the change must be made, 0(false) if it must be skipped (check only run).
+**/
+bool AllowChange(const char* action, const fs::path& p){
+    if (!c_upkeep){
+        profiler::CountRepair();
+    }
+    if (c_check == NULL){
+        return 1;
+    }
+    c_check->issues.push_back({action, p, c_upkeep});
+    return !c_check_only;
+}
 /**
  * @brief Purge a vector of paths, removing them differently if they are files or folders.
  * @param entries Vector of entries to purge.
@@ -42,6 +137,49 @@ ErrorCode PurgeEntries(vector<fs::path>& entries){
     //All done, return.
     return EC_None;
 }
+/**
+ * @brief Move a corrupted file that cannot be rebuilt from other data aside, renaming it to a ".corrupt_" sibling, so it is kept for a manual recovery instead of removed. Quarantined files are kept by the folder validation.
+ * @param file_p Path to the file.
+ * @returns Possible ErrorCodes: EC_FileWriteNoPerm; EC_None;
+**/
+ErrorCode QuarantineFile(const fs::path& file_p){
+    //Find a free sibling name
+    string file_name = file_p.filename().string();
+    fs::path to = file_p;
+    to.replace_filename(".corrupt_" + file_name);
+    for (int i = 1; fs::exists(to); i++){
+        to.replace_filename(".corrupt_" + to_string(i) + '_' + file_name);
+    }
+    //Skip rename on check only runs
+    if (!AllowChange("quarantine", file_p)){
+        return EC_None;
+    }
+    error_code err;
+    fs::rename(file_p, to, err);
+    if (err){
+        return EC_FileWriteNoPerm;
+    }
+    lock_guard<mutex> lock(c_year_mutex);
+    c_year_cache.erase(file_p.lexically_normal().string());
+    c_quarantined.push_back(to);
+    return EC_None;
+}
+/**
+ * @brief Get the size and last write time of a file.
+ * @param file_p Path to the file.
+ * @param size Variable that will contain the size.
+ * @param write_time Variable that will contain the last write time.
+ * @returns 1(true) if the file could be checked, 0(false) if not.
+**/
+bool GetFileStamp(const fs::path& file_p, uintmax_t& size, fs::file_time_type& write_time){
+    error_code err;
+    size = fs::file_size(file_p, err);
+    if (err){
+        return 0;
+    }
+    write_time = fs::last_write_time(file_p, err);
+    return !err;
+}
 /**
  * @brief Checks if a given string is valid for the chosen data type.
  * @param data Data string to process.
@@ -75,12 +213,12 @@ bool IsValidData(const string& data, const files data_from){
                     return 0;
                 }
             }
-            //If not enough or excesive separators, invalid
-            if (separators != NUM_OF_MACROS + 1){
+            //If not enough or excesive separators, invalid. Foods written under an older nutrient schema have fewer nutrients.
+            if (separators < NUM_OF_MACROS + 1 || separators > nutrients::Count() + 1){
                 return 0;
             }
             //Get data between separators
-            for (uint8_t m = 0; m < NUM_OF_MACROS + 2; m++){
+            for (uint8_t m = 0; m < separators + 1; m++){
                 //If first macro, validate food name
                 if (m == 0){
                     //Get food name
@@ -93,7 +231,7 @@ bool IsValidData(const string& data, const files data_from){
                     t_data = t_data.substr(t_data.find_first_of('/') + 1);
                 }
                 //Else if last macro, validate portion.
-                else if (m + 1 == NUM_OF_MACROS + 2){
+                else if (m == separators){
                     //If portion is not numeric unsigned integer, fail.
                     if (!strings::IsNumericStr(t_data, Mode_UIntLong)){
                         return 0;
@@ -134,92 +272,137 @@ bool IsValidData(const string& data, const files data_from){
     return 1;
 }
 /**
- * @brief Detects any user folders that do not have their users registered, and asks the user what to do with them. If restored, it simply adds the user to the user database.
- * @param orphan_p Path to orphan folder. Must be a valid folder path.
- * @returns Possible ErrorCodes: EC_DirNotFound; EC_FileWriteNoPerm; FileRemoveNoPerm; EC_DirRemoveNoPerm; EC_None;
- * @returns [OR] CreateTempFile();
+ * @brief Checks if a binary food record is valid (terminated valid name, finite non negative macros and whole portion size).
+ * @param record Record to check.
+ * @returns 1(true) if record is valid, 0(false) if it isn't.
 **/
-ErrorCode JudgeOrphanFolder(const fs::path& orphan_p){
-    //If not a folder, return error.
-    if (!fs::is_directory(orphan_p)){
-        return EC_DirNotFound;
+bool IsValidFoodRecord(const s_food_record& record){
+    //Name must be terminated inside its field and be a valid in-file name.
+    if (memchr(record.name, '\0', MAX_FOOD_NAME) == NULL){
+        return 0;
     }
-    string fname = orphan_p.filename().string();
-    //Selection loop
-    uint8_t num_input;
-    do {
-        ClearConsole;
-        //Print input
-        cout << "An unregistered user folder has been found.\n";
-        cout << "User: " << name::InFileNameToName(fname,2) << '\n';
-        cout << "Do you want to restore the user?\n";
-        cout << "1.Yes\n2.No, delete it.\n\n";
-        //Get input
-        if (!input::GetNumericInput(&num_input, Mode_UInt8)){
-            exit(0);
-        }
-        //If restore
-        if (num_input == 1){
-            bool temp_file = 0;
-            //Validate users dat
-            fs::path usrdat = users_dat_p;
-            fs::path* usrdat_tmp;
-            ErrorCode ec = UsersDataCheck();
-            //If users.dat is valid and not empty
-            if (ec == EC_None){
-                //Create temp file.
-                usrdat_tmp = new fs::path;
-                ec = CreateTempFile(usrdat, *usrdat_tmp);
-                if (ec != EC_None){
-                    delete usrdat_tmp;
-                    return ec;
-                }
-                temp_file = 1;              
-            }
-            //Else if there was an error
-            else if (ec != EC_FileEmpty){
-                return ec;
-            }
-            //Open users.dat in append mode.
-            ofstream users;
-            users.open(usrdat, ios_base::app);
-            //If open file failed, delete temp file and return error.
-            if (!users.is_open()){
-                if (temp_file){
-                    ec = SafeDeleteFile(*usrdat_tmp);
-                    delete usrdat_tmp;
-                    if (ec != EC_None){
-                        return ec;
-                    }
-                }
-                //Return error
-                return EC_FileWriteNoPerm;
-            }
-            //Add user name and close file.
-            users << '{' + orphan_p.filename().string() + "}|";
-            users.close();
-            //Remove temp file
-            if (temp_file){
-                ec = SafeDeleteFile(*usrdat_tmp);
-                delete usrdat_tmp;
-                if (ec != EC_None){
-                    return ec;
-                }                
-            }
-            break;
+    if (!name::IsValidName(record.name, 1)){
+        return 0;
+    }
+    //Macros must be finite and non negative, portion must be a whole number.
+    for (uint8_t i = 0; i < FOODS_BIN_VALUES; i++){
+        if (!isfinite(record.macros[i]) || record.macros[i] < 0){
+            return 0;
         }
-        //If remove
-        else if (num_input == 2){
-            ErrorCode ec = SafeDeleteFolder(orphan_p);
-            if (ec != EC_None){
-                return ec;
-            }
-            break;
+    }
+    if (record.macros[PORTION_INDEX] != floor(record.macros[PORTION_INDEX])){
+        return 0;
+    }
+    return 1;
+}
+/**
+ * @brief Add the nutrients missing from a valid food data string written under an older nutrient schema, as 0 before the portion size.
+ * @param data Valid food data string ("{name/nutrients.../portion}").
+ * @returns 1(true) if nutrients were added, 0(false) if the string already had every nutrient.
+**/
+bool PadFoodData(string& data){
+    size_t values = count(data.begin(), data.end(), '/') - 1;
+    if (values >= nutrients::Count()){
+        return 0;
+    }
+    size_t portion = data.find_last_of('/');
+    for (; values < nutrients::Count(); values++){
+        data.insert(portion, "/0.000000");
+    }
+    return 1;
+}
+/**
+ * @brief Validate user_foods.bin. Invalid records and tombstones are dropped, and records are sorted and deduplicated. If anything changed (or the header counts are off), the catalog is rewritten (this is also where tombstones get compacted on every boot).
+ * @param filep Path to user_foods.bin.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: ReadFoodsBin(); WriteFoodsBin();
+**/
+ErrorCode ValidateFoodsBin(const fs::path& filep){
+    //Read catalog
+    vector<s_food_record> records;
+    s_foods_bin_header header;
+    ErrorCode ec = ReadFoodsBin(filep, records, &header);
+    if (ec != EC_None){
+        return ec;
+    }
+    //If records were migrated from an older format, or the header counts do not match the records (interrupted in place update), the catalog must be rewritten.
+    bool fix = header.version != FOODS_BIN_VERSION || header.records != records.size() || header.tombstones != 0;
+    //Keep valid alive records
+    vector<s_food_record> valid_records;
+    for (s_food_record& r : records){
+        if (r.alive && IsValidFoodRecord(r)){
+            valid_records.push_back(r);
         }
-    } while(true);
-    //Return success.
+        else {
+            fix = 1;
+        }
+    }
+    //Sort and remove duplicated names (first one wins).
+    auto by_name = [](const s_food_record& a, const s_food_record& b){ return strcmp(a.name, b.name) < 0; };
+    if (!is_sorted(valid_records.begin(), valid_records.end(), by_name)){
+        stable_sort(valid_records.begin(), valid_records.end(), by_name);
+        fix = 1;
+    }
+    auto same_name = [](const s_food_record& a, const s_food_record& b){ return strcmp(a.name, b.name) == 0; };
+    auto last = unique(valid_records.begin(), valid_records.end(), same_name);
+    if (last != valid_records.end()){
+        valid_records.erase(last, valid_records.end());
+        fix = 1;
+    }
+    //If we need to fix the file, rewrite it.
+    if (fix){
+        return WriteFoodsBin(filep, valid_records);
+    }
     return EC_None;
 }
+/**
+ * @brief Register the user of an orphan folder again, adding it to users.dat.
+ * @param orphan_p Path to orphan folder.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: UsersDataCheck(); ReadFileData(); CommitFile();
+**/
+ErrorCode RegisterOrphanFolder(const fs::path& orphan_p){
+    //Validate users dat
+    fs::path usrdat = users_dat_p;
+    ErrorCode ec = UsersDataCheck();
+    //If there was an error
+    if (ec != EC_None && ec != EC_FileEmpty){
+        return ec;
+    }
+    //Read current users (if any).
+    string users;
+    if (ec == EC_None){
+        ec = ReadFileData(usrdat, users);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Add user name and commit file.
+    users += '{' + orphan_p.filename().string() + "}|";
+    return CommitFile(usrdat, users);
+}
+/**
+ * @brief Apply an orphan policy to the folder of an unregistered user.
+ * @param orphan_p Path to orphan folder.
+ * @param policy Policy to apply. OP_Keep leaves the folder as it is.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: RegisterOrphanFolder(); SafeDeleteFolder();
+**/
+ErrorCode ApplyOrphanPolicy(const fs::path& orphan_p, const orphan_policy policy){
+    switch (policy){
+        //Register user again
+        case OP_Restore: {
+            return RegisterOrphanFolder(orphan_p);
+        }
+        //Remove user folder
+        case OP_Delete: {
+            return SafeDeleteFolder(orphan_p);
+        }
+        //Keep it
+        default:
+            return EC_None;
+    }
+}
 /**
  * @brief Validate file following file data rules. Specify a file type and a matching file path. Corrupted files will be fixed unless there is no valid data inside them OR they are temp files (.tmp_).
  * @param file_type File type to be validated. Read files enum if unsure. Make sure to use the correct type, or else expect bugs :).
@@ -228,133 +411,58 @@ ErrorCode JudgeOrphanFolder(const fs::path& orphan_p){
  * @return ErrorCode enum. The EC reaction is implementation defined.
 **/
 ErrorCode ValidateFile(const files file_type, const fs::path &filep, const bool temp_file){
-    //See if file path is valid
-    if (!fs::exists(filep)){
-        return EC_FileNotFound;
+    latency::phase_scope phase(latency::PH_Validation);
+    profiler::span recovery(profiler::SP_TempRecovery, "", temp_file);
+    //Read file (fails if file path is not valid)
+    string data;
+    ErrorCode ec = ReadFileData(filep, data);
+    if (ec != EC_None){
+        return ec;
     }
     //See if file is empty
-    if (fs::is_empty(filep)){
+    if (data.empty()){
         return EC_FileEmpty;
     }
-    //Try to open file (read)
-    ifstream file_in;
-    file_in.open(filep);
-    if (!file_in.is_open()){
-        EC_FileReadNoPerm;
+    //Validate data
+    string valid_data;
+    bool fix;
+    ec = ValidateData(file_type, data, valid_data, fix, temp_file);
+    if (ec != EC_None || temp_file){
+        return ec;
     }
-    //Prepare variables we need
-    bool fix = 0, found_tmp_end = 0;
-    vector<string> valid_data;
-    string data;
-    //Get all valid data.
-    while (getline(file_in, data, '|')){
-        //If temp file and end "flag" found
-        if (temp_file && data == "_END_"){
-            //Force a new getline to trigger eof
-            getline(file_in, data, '|');
-            //If eof is set, temp file is good
-            if (file_in.eof()){
-                //Set end flag found
-                found_tmp_end = 1;
-            }
-            //Else, discard file
-            else {
-                fix = 1;
-            }
-            break;
-        }
-        //Else, if data is valid
-        else if (IsValidData(data, file_type)){
-            //If file type is users_dat or usr_foods_dat
-            if (file_type == users_dat || file_type == usr_foods_dat){
-                //If valid data is empty                
-                if (valid_data.empty()){
-                    valid_data.push_back(data);
-                }
-                //Else
-                else {
-                    //Try to find if name is duplicated
-                    bool save = 1;
-                    for (string& name : valid_data){
-                        //Process name condition
-                        switch (file_type){
-                            case users_dat: {
-                                save = name != data;
-                            }
-                            case usr_foods_dat: {
-                                save = name.substr(1,name.find_first_of('/')) != data.substr(1,data.find_first_of('/'));
-                            }
-                        }
-                        //If duplicated, break
-                        if (!save){
-                            break;
-                        }
-                    }
-                    //If not, save it
-                    if (save){
-                        valid_data.push_back(data);
-                    }
-                    //If discarded, set fix to true
-                    else {
-                        fix = 1;
-                    }
-                }
-            }
-            //Else, for x_day_dat
-            else {
-                //Save string
-                valid_data.push_back(data);
-                //If line requirement is exceeded, remove last entry and break loop.
-                if (valid_data.size() > NUM_OF_MACROS) {
-                    valid_data.erase(valid_data.end()--);
-                    fix = 1;
-                    break;
-                }
-            }
-        }
-        //Else, discard data and set fix to true.
-        else {
-            fix = 1;
-        }
+    //If we need to fix the file, replace data for valid data.
+    if (fix){
+        return CommitFile(filep, valid_data);
     }
-    file_in.close();
-    //If temp file
-    if (temp_file){
-        //If no end, something invalid or no valid entries were found, file is corrupted.
-        if (!found_tmp_end || fix || valid_data.empty()){
-            return EC_FileCorrupted;
-        }
-        //Else, return success.
-        else {
-            return EC_None;
-        }
+    return EC_None;
+}
+/**
+ * @brief Checks if a day file holds no data (every macro is 0).
+ * @param day_p Path to a validated day file.
+ * @param zero Set to 1(true) if every macro is 0, else 0(false).
+ * @returns ErrorCodes thrown by ReadFileData();
+**/
+ErrorCode IsDayDataZero(const fs::path& day_p, bool& zero){
+    string file_data;
+    zero = 0;
+    ErrorCode ec = ReadFileData(day_p, file_data);
+    if (ec != EC_None){
+        return ec;
     }
-    //If normal file
-    else {
-        //If no valid data, return corrupted
-        if (valid_data.empty()){
-            return EC_FileCorrupted;
-        }
-        //If x_day_dat and not enough macros detected, add missing ones.
-        else if (file_type == x_day_dat && valid_data.size() < NUM_OF_MACROS){
-            for (uint8_t i = valid_data.size(); i < NUM_OF_MACROS; i++){
-                valid_data.push_back("{0.0}");
-            }
-            fix = 1;
+    //Check every nutrient
+    istringstream data_in(file_data);
+    string data;
+    for (uint8_t i = 0; i < nutrients::Count(); i++){
+        if (!getline(data_in, data, '|') || data.length() < 2){
+            return EC_None;
         }
-        //If we need to fix the file, replace data for valid data.
-        if (fix) {
-            ofstream file_out;
-            file_out.open(filep);
-            if (!file_out.is_open()){
-                return EC_FileWriteNoPerm;
-            }
-            for (string& data : valid_data){
-                file_out << data + '|';
-            }
+        strings::RemoveBrackets(data);
+        if (!strings::IsNumericStr(data, Mode_Double) || stod(data) != 0){
+            return EC_None;
         }
-        return EC_None;
     }
+    zero = 1;
+    return EC_None;
 }
 /** 
  * @brief Check user folder integrity. This will check every file and folder recursively. Any "illegal" folders and files will be removed, and invalid data will be fixed. To check if an user folder belongs to a registered user, use IsUserFolderRegistered().
@@ -429,6 +537,34 @@ ErrorCode ValidateUserFolder(const fs::path &pth, const uint8_t mode = 0){
                     return ec;
                 }
             }
+            //Validate binary food catalog, if present.
+            cpth = pth;
+            cpth.append(username + "_foods.bin");
+            if (fs::exists(cpth)){
+                ec = ValidateFoodsBin(cpth);
+                //If catalog is corrupted, remove it and fall back to the text catalog.
+                if (ec == EC_FileCorrupted){
+                    ec = SafeDeleteFile(cpth);
+                    if (ec != EC_None){
+                        return ec;
+                    }
+                }
+                //If catalog is valid, any text catalog left by an interrupted conversion is stale.
+                else if (ec == EC_None){
+                    fs::path dat_p = pth;
+                    dat_p.append(username + "_foods.dat");
+                    if (fs::exists(dat_p)){
+                        ec = SafeDeleteFile(dat_p);
+                        if (ec != EC_None){
+                            return ec;
+                        }
+                    }
+                }
+                //Else, return error
+                else {
+                    return ec;
+                }
+            }
             break;
         }
         //Day food data
@@ -488,6 +624,22 @@ ErrorCode ValidateUserFolder(const fs::path &pth, const uint8_t mode = 0){
                     return ec;
                 }
             }
+            //Missing days read as zero, so an all-zero day file is dead weight. Remove it.
+            cpth = pth;
+            cpth.append(to_string(week_day) + "_day.dat");
+            if (fs::exists(cpth)){
+                bool zero;
+                ec = IsDayDataZero(cpth, zero);
+                if (ec != EC_None){
+                    return ec;
+                }
+                if (zero){
+                    ec = SafeDeleteFile(cpth);
+                    if (ec != EC_None){
+                        return ec;
+                    }
+                }
+            }
             break;
         }
         //Anything else, break;
@@ -496,6 +648,10 @@ ErrorCode ValidateUserFolder(const fs::path &pth, const uint8_t mode = 0){
     }
     //Purge folder
     vector<fs::path> to_purge;
+    vector<fs::path> to_quarantine;
+    set<int> to_map;
+    set<int> to_events;
+    int year;
     for (const auto& entry : fs::directory_iterator(pth)){
         switch (mode){
             //Main user folder
@@ -520,11 +676,42 @@ ErrorCode ValidateUserFolder(const fs::path &pth, const uint8_t mode = 0){
                         else if (ec != EC_None){
                             return ec;
                         }
-                        //Else, this folder is completely valid
+                        //Else, this folder is completely valid. Its presence map is rebuilt later.
+                        else if (c_path.length() < 10){
+                            to_map.insert(stoi(c_path));
+                        }
+                    }
+                }
+                //If it is a compacted year file, check it (one read instead of a whole year tree walk, skipped once verified).
+                else if (IsYearFileName(c_path, "_year.bin", &year)){
+                    vector<double> columns;
+                    ErrorCode ec = ReadYearBin(entry.path(), year, columns);
+                    //If year file is corrupted, quarantine it. Its day files are gone, so it is never removed.
+                    if (ec == EC_FileCorrupted){
+                        to_quarantine.push_back(entry.path());
+                    }
+                    //If an error ocurred, return
+                    else if (ec != EC_None){
+                        return ec;
+                    }
+                    else {
+                        to_map.insert(year);
                     }
                 }
-                //If it is a file and not user_foods.dat, purge it
-                else if (c_path != username + "_foods.dat"){
+                //If it is a year presence map, rebuild it later (it is removed if the year has no data).
+                else if (IsYearFileName(c_path, "_days.map", &year)){
+                    to_map.insert(year);
+                }
+                //If it is an event log or its day index, check them later.
+                else if (IsYearFileName(c_path, "_events.log", &year) || IsYearFileName(c_path, "_events.idx", &year)){
+                    to_events.insert(year);
+                }
+                //If it is a quarantined file, keep it for a manual recovery.
+                else if (c_path.starts_with(".corrupt_")){
+                    continue;
+                }
+                //If it is a file and not user_foods.dat or user_foods.bin, purge it
+                else if (c_path != username + "_foods.dat" && c_path != username + "_foods.bin"){
                     to_purge.push_back(entry.path());
                 }
                 break;
@@ -549,9 +736,9 @@ ErrorCode ValidateUserFolder(const fs::path &pth, const uint8_t mode = 0){
                             //If inside month, folder must be a valid month day number
                             case 2: {
                                 //Get folder month
-                                date::month_name month = static_cast<date::month_name>(stoi(c_path));
+                                date::month_name month = static_cast<date::month_name>(stoi(pth.filename().string()));
                                 //Get folder year
-                                string year_str = entry.path().parent_path().filename().string();
+                                string year_str = pth.parent_path().filename().string();
                                 int year = stoi(year_str);
                                 validate = (stoi(c_path) <= date::GetMonthLength(month, year) && stoi(c_path) > 0);
                                 break;
@@ -608,21 +795,54 @@ ErrorCode ValidateUserFolder(const fs::path &pth, const uint8_t mode = 0){
     if (ec != EC_None){
         return ec;
     }
-    //If original path is now empty, return it
-    if (fs::is_empty(pth)){
-        return EC_DirEmpty;
-    }
+    //Quarantine corrupted year files
+    for (fs::path& p : to_quarantine){
+        ec = QuarantineFile(p);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Rebuild year presence maps from the validated data
+    for (int c_year : to_map){
+        upkeep_scope upkeep;
+        ec = RebuildYearMap(pth.filename().string(), c_year);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Check event logs (rebuilding their indexes is upkeep). If a log is not valid, remove it with its index.
+    for (int c_year : to_events){
+        {
+            upkeep_scope upkeep;
+            ec = events::CheckEvents(pth.filename().string(), c_year);
+        }
+        if (ec == EC_FileCorrupted){
+            ec = SafeDeleteFile(events::GetEventsLogPath(pth.filename().string(), c_year));
+            if (ec == EC_None && fs::exists(events::GetEventsIndexPath(pth.filename().string(), c_year))){
+                ec = SafeDeleteFile(events::GetEventsIndexPath(pth.filename().string(), c_year));
+            }
+        }
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //If original path is now empty, return it
+    if (fs::is_empty(pth)){
+        return EC_DirEmpty;
+    }
     else {
         return EC_None;
     }
 }
 /**
- * @brief Check if usr folder contains any "illegal" or empty files/folders, and deletes them. Validates every user folder recursively with ValidateUserFolder().
+ * @brief Check if usr folder contains any "illegal" or empty files/folders, and deletes them. Validates every user folder recursively with ValidateUserFolder(), several users at once if asked.
  * @param orphan_folders If set pointer is valid, it detects any user folders that do not have their users registered and returns them.
- * @returns Possible ErrorCodes: EC_DirNotFound; EC_DirRemoveNoPerm; EC_None;
- * @returns [OR] ErrorCodes thrown by any of this functions: ValidateUserFolder();
+ * @param results If set pointer is valid, it will contain one files check result per user folder (changes are recorded into them), and errors of a single user are stored in its result instead of stopping the validation.
+ * @param jobs Maximum user folders validated at once. If 0, hardware threads are used.
+ * @returns Possible ErrorCodes: EC_DirNotFound; EC_DirRemoveNoPerm; EC_FileReadNoPerm; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: ValidateUserFolder(); PurgeEntries();
 **/
-ErrorCode ValidateUsrFolder(vector<fs::path>* orphan_folders = NULL){
+ErrorCode ValidateUsrFolder(vector<fs::path>* orphan_folders = NULL, vector<s_check_result>* results = NULL, const size_t jobs = 1){
     //If folder does not exist
     if (!fs::exists(usr_f)) {
         return EC_DirNotFound;
@@ -633,50 +853,72 @@ ErrorCode ValidateUsrFolder(vector<fs::path>* orphan_folders = NULL){
     }
     //Purge data folder
     vector<fs::path> to_purge;
-    //Gather "illegal" entries in usr folder.
+    //Gather user folders and "illegal" entries in usr folder.
+    vector<fs::path> users;
     for (const auto &p : fs::directory_iterator(usr_f)){
         string cpath_name = p.path().filename().string();
-        //If a directory with a valid name and not empty, validate it
+        //If a directory with a valid name and not empty, validate it later
         if (fs::is_directory(p) && name::IsValidName(cpath_name,1) && !fs::is_empty(p)){
-            ErrorCode ec = ValidateUserFolder(p,0);
-            //If user folder is now empty, purge it
-            if (ec == EC_DirEmpty){
-                to_purge.push_back(p.path());
-            }
-            //If there was a problem, exit
-            else if (ec != EC_None){
-                return ec;
-            }
-            //If set pointer is valid, see if user folder is orphaned.
-            else if (orphan_folders != NULL){
-                //Open users dat
-                ifstream users;
-                users.open(users_dat_p);
-                if (!users.is_open()){
-                    return EC_FileReadNoPerm;
-                }
-                //Try to find user in database
-                bool orphaned = 1;
-                string usrname;
-                while (getline(users, usrname, '|')){
-                    strings::RemoveBrackets(usrname);
-                    if (usrname == cpath_name){
-                        orphaned = 0;
-                        break;
-                    }
-                }
-                //If user is not found, insert it
-                if (orphaned){
-                    orphan_folders->push_back(p.path());
-                }
-                users.close();
-            }
+            users.push_back(p.path());
         }
         //Else, purge it
         else {
             to_purge.push_back(p.path());
         }
     }
+    //Validate user folders across worker threads. Each user folder is only touched by its own worker.
+    vector<ErrorCode> status(users.size(), EC_None);
+    if (results != NULL){
+        results->clear();
+        for (fs::path& p : users){
+            results->push_back({p.filename().string(), EC_None, {}});
+        }
+    }
+    atomic<size_t> next(0);
+    size_t workers_n = min<size_t>(jobs != 0 ? jobs : max(thread::hardware_concurrency(), 1U), users.size());
+    auto work = [&](){
+        s_check_result* outer = c_check;
+        for (size_t i = next++; i < users.size(); i = next++){
+            profiler::span user_span(profiler::SP_UserFolder, users[i].filename().string());
+            c_check = results != NULL ? &(*results)[i] : NULL;
+            status[i] = ValidateUserFolder(users[i], 0);
+        }
+        c_check = outer;
+    };
+    //This thread is one of the workers (a single job needs no extra thread).
+    vector<thread> workers;
+    for (size_t w = 1; w < workers_n; w++){
+        workers.emplace_back(work);
+    }
+    work();
+    for (thread& worker : workers){
+        worker.join();
+    }
+    //Read registered users once, if orphans are wanted.
+    string users_data;
+    if (orphan_folders != NULL){
+        ErrorCode ec = ReadFileData(users_dat_p, users_data);
+        if (ec != EC_None && ec != EC_FileNotFound){
+            return ec;
+        }
+    }
+    for (size_t i = 0; i < users.size(); i++){
+        //If user folder is now empty, purge it
+        if (status[i] == EC_DirEmpty){
+            to_purge.push_back(users[i]);
+        }
+        //If there was a problem, store it or exit
+        else if (status[i] != EC_None){
+            if (results == NULL){
+                return status[i];
+            }
+            (*results)[i].status = status[i];
+        }
+        //If user is not found in database, it is orphaned.
+        else if (orphan_folders != NULL && users_data.find('{' + users[i].filename().string() + "}|") == string::npos){
+            orphan_folders->push_back(users[i]);
+        }
+    }
     //Remove "illegal" entries.
     ErrorCode ec = PurgeEntries(to_purge);
     if (ec != EC_None){
@@ -703,7 +945,7 @@ ErrorCode ValidateDataFolder(){
         return EC_None;
     }
     //If data/usr does not exist, create it.
-    if (!fs::exists(usr_f)) {
+    if (!fs::exists(usr_f) && AllowChange("write", usr_f)) {
         if (!fs::create_directories(usr_f)){
             return EC_DirCreateNoPerm;
         }
@@ -714,7 +956,7 @@ ErrorCode ValidateDataFolder(){
         ErrorCode t_ec = ValidateFile(users_dat, p, 1);
         //If temp data is corrupted or empty, remove it and validate users.dat
         if (t_ec == EC_FileCorrupted || t_ec == EC_FileEmpty){
-            if (!fs::remove(p)){
+            if (AllowChange("remove", p) && !fs::remove(p)){
                 return EC_FileRemoveNoPerm;
             }
             goto validate_users_dat;
@@ -736,10 +978,12 @@ ErrorCode ValidateDataFolder(){
         validate_users_dat:
         //If users.dat does not exist, create it
         if (!fs::exists(users_dat_p)){
-            ofstream dat;
-            dat.open(users_dat_p);
-            if (!dat.is_open()){
-                return EC_FileWriteNoPerm;
+            if (AllowChange("write", users_dat_p)){
+                ofstream dat;
+                dat.open(users_dat_p);
+                if (!dat.is_open()){
+                    return EC_FileWriteNoPerm;
+                }
             }
         }
         //If users.dat exists, validate content.
@@ -747,7 +991,7 @@ ErrorCode ValidateDataFolder(){
             fs::path p = users_dat_p;
             ErrorCode t_ec = ValidateFile(users_dat, p, 0);
             //If file is corrupted (could not be fixed), empty it.
-            if (t_ec == EC_FileCorrupted){
+            if (t_ec == EC_FileCorrupted && AllowChange("write", p)){
                 ofstream reset_users;
                 reset_users.open(p);
                 if (!reset_users.is_open()){
@@ -765,7 +1009,7 @@ ErrorCode ValidateDataFolder(){
     vector<fs::path> to_purge;
     //Gather "illegal" entries in data folder.
     for (const auto &p : fs::directory_iterator(data_f)){
-        if (p.path().filename() != "usr" && p.path().filename() != "users.dat"){
+        if (p.path().filename() != "usr" && p.path().filename() != "users.dat" && p.path() != fs::path(nutrients_dat_p)){
             to_purge.push_back(p.path().string());
         }
     }
@@ -779,74 +1023,596 @@ ErrorCode ValidateDataFolder(){
 #pragma endregion
 #pragma region Public Functions
 /**
- * @brief Performs an initial check of the program data. It is meant to fix any inconsistencies, errors or alterations inside the data files and folders.
+ * @brief Performs an initial check of the program data. It is meant to fix any inconsistencies, errors or alterations inside the data files and folders. Its phases are recorded by the startup profiler, if enabled (see profiler::Enable()).
+ * @param judge Callback that decides what to do with each user folder of an unregistered user. If NULL, those folders are kept.
+ * @param quarantined Optional pointer to a vector that will contain the corrupted files moved aside by the check (".corrupt_" files, see QuarantineFile()), to report them.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: ValidateDataFolder(); nutrients::LoadSchema(); ValidateUsrFolder(); ApplyOrphanPolicy();
 **/
-ErrorCode filemanager::InitialFilesCheck(){
-    ErrorCode ec = ValidateDataFolder();
+ErrorCode filemanager::InitialFilesCheck(orphan_callback judge, vector<filesystem::path>* quarantined){
+    latency::phase_scope phase(latency::PH_Validation);
+    profiler::span startup(profiler::SP_Startup);
+    {
+        lock_guard<mutex> lock(c_year_mutex);
+        c_quarantined.clear();
+    }
+    ErrorCode ec;
+    {
+        profiler::span data_span(profiler::SP_DataFolder);
+        ec = ValidateDataFolder();
+    }
+    if (ec != EC_None){
+        return ec;
+    }
+    //Load nutrient schema before any data file is validated.
+    {
+        profiler::span schema_span(profiler::SP_Schema);
+        upkeep_scope upkeep;
+        ec = nutrients::LoadSchema();
+    }
     if (ec != EC_None){
         return ec;
     }
     vector<fs::path> orphan_folders;
-    ec = ValidateUsrFolder(&orphan_folders);
+    {
+        profiler::span usr_span(profiler::SP_UsrFolder);
+        ec = ValidateUsrFolder(&orphan_folders);
+    }
+    if (quarantined != NULL){
+        lock_guard<mutex> lock(c_year_mutex);
+        *quarantined = c_quarantined;
+    }
     if (ec != EC_None){
         return ec;
     }
-    if (!orphan_folders.empty()){
-        for (fs::path& p : orphan_folders){
-            ec = JudgeOrphanFolder(p);
-            if (ec != EC_None){
-                return ec;
+    //Let the caller judge orphan folders. Only applying the policy is profiled (judging may wait for the user).
+    for (fs::path& p : orphan_folders){
+        if (judge == NULL){
+            break;
+        }
+        orphan_policy policy = judge(p);
+        profiler::span orphan_span(profiler::SP_Orphans, p.filename().string());
+        ec = ApplyOrphanPolicy(p, policy);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    return EC_None;
+}
+/**
+ * @brief Non-interactive files check (foodbook-fsck). It applies the initial files check rules to the data folder and to every user folder, several users at once, and handles orphan folders by policy instead of asking. Every change is recorded; check only runs record them without touching any file.
+ * @param options Check options.
+ * @param results Vector that will contain the data folder result first (users.dat, schema, usr folder and orphans), then one result per user folder. It will be cleared.
+ * @returns Possible ErrorCodes: EC_DirNotFound (no data folder, nothing is created); EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: ValidateDataFolder(); nutrients::LoadSchema(); ValidateUsrFolder(); ApplyOrphanPolicy();
+ * @warning Do not run it while the program is running, as both could fix the same files. Errors of a single user folder are returned in its result and do not stop the check.
+**/
+ErrorCode filemanager::CheckFiles(const s_check_options& options, vector<s_check_result>& results){
+    results.clear();
+    //The check never creates a data tree.
+    if (!fs::is_directory(data_f)){
+        return EC_DirNotFound;
+    }
+    //Record data folder changes
+    results.push_back({"", EC_None, {}});
+    c_check_only = options.check_only;
+    c_check = &results[0];
+    //Check data folder, then load schema before any data file is validated.
+    ErrorCode ec = ValidateDataFolder();
+    if (ec == EC_None){
+        upkeep_scope upkeep;
+        ec = nutrients::LoadSchema();
+    }
+    //Check user folders
+    vector<fs::path> orphan_folders;
+    vector<s_check_result> users;
+    if (ec == EC_None){
+        ec = ValidateUsrFolder(&orphan_folders, &users, options.jobs);
+        //On check only runs a missing usr folder is not created, so there are no users.
+        if (ec == EC_DirNotFound && options.check_only){
+            ec = EC_None;
+        }
+    }
+    //Apply orphan policy
+    for (size_t i = 0; i < orphan_folders.size() && ec == EC_None; i++){
+        //Kept folders are reported, as they are not fixed.
+        if (options.orphans == OP_Keep){
+            results[0].issues.push_back({"orphan", orphan_folders[i], 0});
+        }
+        ec = ApplyOrphanPolicy(orphan_folders[i], options.orphans);
+    }
+    //Stop recording
+    c_check = NULL;
+    c_check_only = 0;
+    results[0].status = ec;
+    if (ec != EC_None){
+        return ec;
+    }
+    results.insert(results.end(), make_move_iterator(users.begin()), make_move_iterator(users.end()));
+    return EC_None;
+}
+/**
+ * @brief Re-validate a single data file after it changed outside the program, with the same rules (and the same fixes) the initial files check applies to it.
+ * @param file_type Type of the file.
+ * @param file_p Path to the file. For usr_foods_dat it can be either the text (.dat) or the binary (.bin) catalog.
+ * @returns Possible ErrorCodes: EC_FileWriteNoPerm; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: ValidateFile(); ValidateFoodsBin(); IsDayDataZero(); SafeDeleteFile();
+ * @warning Invalid catalogs are emptied (not removed) and invalid or all-zero day files are removed. Removed files do not return an error.
+**/
+ErrorCode filemanager::RevalidateFile(const files file_type, const fs::path& file_p){
+    latency::phase_scope phase(latency::PH_Validation);
+    //Binary catalog
+    if (file_type == usr_foods_dat && file_p.extension() == ".bin"){
+        if (!fs::exists(file_p)){
+            return EC_None;
+        }
+        ErrorCode ec = ValidateFoodsBin(file_p);
+        //If catalog is corrupted, remove it (text catalog takes over).
+        if (ec == EC_FileCorrupted){
+            return SafeDeleteFile(file_p);
+        }
+        return ec;
+    }
+    //Text files
+    ErrorCode ec = ValidateFile(file_type, file_p, 0);
+    switch (file_type){
+        //If users.dat or the text catalog are missing or corrupted, leave them empty. A missing text catalog is fine if a binary one replaced it.
+        case users_dat:
+        case usr_foods_dat: {
+            if (ec == EC_FileNotFound && file_type == usr_foods_dat && fs::exists(fs::path(file_p).replace_extension(".bin"))){
+                return EC_None;
+            }
+            if (ec == EC_FileNotFound || ec == EC_FileCorrupted){
+                return CommitFile(file_p, "");
+            }
+            break;
+        }
+        //If day file is corrupted, empty or holds no data, remove it.
+        case x_day_dat: {
+            if (ec == EC_FileCorrupted || ec == EC_FileEmpty){
+                return SafeDeleteFile(file_p);
+            }
+            if (ec == EC_None){
+                bool zero;
+                ec = IsDayDataZero(file_p, zero);
+                if (ec == EC_None && zero){
+                    return SafeDeleteFile(file_p);
+                }
             }
+            break;
+        }
+    }
+    //A missing or empty file is fine at this point.
+    if (ec == EC_FileNotFound || ec == EC_FileEmpty){
+        return EC_None;
+    }
+    return ec;
+}
+/**
+ * @brief Atomically replace the content of a file. Data is written to a sibling ".new_" file, flushed to disk and renamed over the original, so the file always holds either its old or its new content. The parent folder is flushed afterwards to make the rename durable (once per group commit, see BeginGroupCommit()). Leftover ".new_" files from an interrupted commit are purged by the folder validation.
+ * @param file_p Path to the file to replace. It does not need to exist, but its parent folder does.
+ * @param data Complete new content of the file.
+ * @returns Possible ErrorCodes: EC_FileWriteNoPerm; EC_None;
+ * @warning On non Linux builds data is flushed by the stream only (no fsync).
+**/
+ErrorCode filemanager::CommitFile(const fs::path& file_p, const string& data){
+    latency::phase_scope phase(latency::PH_Write);
+    //Skip write on check only runs
+    if (!AllowChange("write", file_p)){
+        return EC_None;
+    }
+    //Construct sibling path
+    fs::path new_p = file_p;
+    new_p.replace_filename(".new_" + file_p.filename().string());
+    #if LINUX
+    //Create sibling file
+    int fd = open(new_p.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0){
+        return EC_FileWriteNoPerm;
+    }
+    //Write all data, retrying on partial writes.
+    size_t written = 0;
+    while (written < data.size()){
+        ssize_t w = write(fd, data.data() + written, data.size() - written);
+        if (w < 0){
+            close(fd);
+            unlink(new_p.c_str());
+            return EC_FileWriteNoPerm;
+        }
+        written += w;
+    }
+    //Flush data to disk before it becomes visible.
+    if (fsync(fd) != 0){
+        close(fd);
+        unlink(new_p.c_str());
+        return EC_FileWriteNoPerm;
+    }
+    close(fd);
+    //Replace original file.
+    if (rename(new_p.c_str(), file_p.c_str()) != 0){
+        unlink(new_p.c_str());
+        return EC_FileWriteNoPerm;
+    }
+    //Flush parent folder so the rename survives a crash. Group commits flush it when they end.
+    fs::path dir_p = file_p.parent_path().empty() ? fs::path(".") : file_p.parent_path();
+    if (c_grouping){
+        GroupSync(dir_p);
+    }
+    else {
+        int dir_fd = open(dir_p.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dir_fd >= 0){
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    }
+    #else
+    //Create sibling file and write all data.
+    ofstream data_out;
+    data_out.open(new_p, ios_base::binary | ios_base::trunc);
+    if (!data_out.is_open()){
+        return EC_FileWriteNoPerm;
+    }
+    data_out << data;
+    data_out.close();
+    if (data_out.fail()){
+        fs::remove(new_p);
+        return EC_FileWriteNoPerm;
+    }
+    //Replace original file.
+    error_code r_ec;
+    fs::rename(new_p, file_p, r_ec);
+    if (r_ec){
+        fs::remove(new_p);
+        return EC_FileWriteNoPerm;
+    }
+    #endif
+    //Return with success
+    GroupWrote(file_p);
+    return EC_None;
+}
+/**
+ * @brief Start a group commit on this thread. Until EndGroupCommit(), in-place writes (WriteFileAt()) and the folders of replaced files (CommitFile()) are not flushed to disk one by one; each of them is flushed once when the group ends. Replaced files are still flushed before their rename, so they hold either their old or their new content.
+**/
+void filemanager::BeginGroupCommit(){
+    c_grouping = 1;
+    c_group_sync.clear();
+    c_group_files.clear();
+    return;
+}
+/**
+ * @brief End the group commit of this thread, flushing every file and folder written in it, in write order.
+ * @param synced Optional pointer to return the amount of files and folders flushed.
+ * @param written Optional pointer to a vector that will contain every file written in the group (replaced or written in place), in write order.
+ * @returns Possible ErrorCodes: EC_FileWriteNoPerm; EC_None;
+ * @warning On non Linux builds nothing is flushed (see CommitFile()).
+**/
+ErrorCode filemanager::EndGroupCommit(size_t* synced, vector<fs::path>* written){
+    c_grouping = 0;
+    vector<fs::path> paths;
+    paths.swap(c_group_sync);
+    if (synced != NULL){
+        *synced = paths.size();
+    }
+    if (written != NULL){
+        written->swap(c_group_files);
+    }
+    c_group_files.clear();
+    #if LINUX
+    //Flush everything and report the first file that could not be flushed. Folder flush failures are ignored, as in CommitFile().
+    ErrorCode ec = EC_None;
+    for (const fs::path& p : paths){
+        int fd = open(p.c_str(), O_RDONLY);
+        bool flushed = fd >= 0 && fsync(fd) == 0;
+        if (fd >= 0){
+            close(fd);
+        }
+        if (!flushed && ec == EC_None && !fs::is_directory(p)){
+            ec = EC_FileWriteNoPerm;
         }
     }
+    return ec;
+    #else
     return EC_None;
+    #endif
 }
 /**
- * @brief Create temp file from an original file. It copies the original file and then adds an _END_ file termination. This does NOT check if the original file is corrupted.
- * @param origin_p Path to original file. The temp file will be created at the same location. Folder paths and empty files are not allowed.
- * @param temp_p Path object to return temp file path. Whatever is inside it, will be overwritten.
- * @return Possible ErrorCodes: EC_FileNotFound; EC_FileEmpty; EC_FileCopy; EC_FileWriteNoPerm; EC_None;
+ * @brief Read the whole content of a file into a string.
+ * @param file_p Path to file.
+ * @param data String that will contain the file content. Whatever is inside it, will be overwritten.
+ * @returns Possible ErrorCodes: EC_FileNotFound; EC_FileReadNoPerm; EC_None;
 **/
-ErrorCode filemanager::CreateTempFile(const fs::path& origin_p, fs::path& temp_p){
+ErrorCode filemanager::ReadFileData(const fs::path& file_p, string& data){
     //If path is invalid or is directory, return error.
-    if (!fs::exists(origin_p) || fs::is_directory(origin_p)){
+    if (!fs::exists(file_p) || fs::is_directory(file_p)){
         return EC_FileNotFound;
     }
-    //Else if file is empty, return error.
-    else if (fs::is_empty(origin_p)){
+    //Open file
+    ifstream data_in;
+    data_in.open(file_p, ios_base::binary);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    //Read everything at once
+    data.assign(istreambuf_iterator<char>(data_in), istreambuf_iterator<char>());
+    data_in.close();
+    profiler::CountRead(data.size());
+    return EC_None;
+}
+/**
+ * @brief Overwrite part of an existing file in place and flush it to disk (once per group commit, see BeginGroupCommit()).
+ * @param file_p Path to file. It must exist.
+ * @param offset Byte offset where data will be written.
+ * @param data Pointer to the bytes to write.
+ * @param size Amount of bytes to write.
+ * @returns Possible ErrorCodes: EC_FileNotFound; EC_FileWriteNoPerm; EC_None;
+**/
+ErrorCode filemanager::WriteFileAt(const fs::path& file_p, const uint64_t offset, const void* data, const size_t size){
+    latency::phase_scope phase(latency::PH_Write);
+    //If path is invalid or is directory, return error.
+    if (!fs::exists(file_p) || fs::is_directory(file_p)){
+        return EC_FileNotFound;
+    }
+    //Skip write on check only runs
+    if (!AllowChange("write", file_p)){
+        return EC_None;
+    }
+    #if LINUX
+    //Open file and write at offset
+    int fd = open(file_p.c_str(), O_WRONLY);
+    if (fd < 0){
+        return EC_FileWriteNoPerm;
+    }
+    ssize_t w = pwrite(fd, data, size, offset);
+    if (w < 0 || (size_t)w != size || (!c_grouping && fsync(fd) != 0)){
+        close(fd);
+        return EC_FileWriteNoPerm;
+    }
+    close(fd);
+    if (c_grouping){
+        GroupSync(file_p);
+    }
+    GroupWrote(file_p);
+    #else
+    //Open file without truncating it and write at offset
+    fstream data_out;
+    data_out.open(file_p, ios_base::in | ios_base::out | ios_base::binary);
+    if (!data_out.is_open()){
+        return EC_FileWriteNoPerm;
+    }
+    data_out.seekp(offset);
+    data_out.write((const char*)data, size);
+    data_out.close();
+    if (data_out.fail()){
+        return EC_FileWriteNoPerm;
+    }
+    GroupWrote(file_p);
+    #endif
+    return EC_None;
+}
+/**
+ * @brief Validate file data following file data rules, without touching any file (same rules ValidateFile() applies to files on disk).
+ * @param file_type File type the data comes from. Read files enum if unsure.
+ * @param file_data Whole file content.
+ * @param fixed_data String that will contain the valid data (fixed if needed). It is left empty for temp files.
+ * @param fix Set to 1 if data had to be fixed (invalid entries discarded or missing ones added), else 0.
+ * @param temp_file If validating a temp file, set this to 1, else 0.
+ * @returns Possible ErrorCodes: EC_FileEmpty; EC_FileCorrupted; EC_None;
+**/
+ErrorCode filemanager::ValidateData(const files file_type, const string& file_data, string& fixed_data, bool& fix, const bool temp_file){
+    //See if data is empty
+    if (file_data.empty()){
+        fix = 0;
+        fixed_data.clear();
         return EC_FileEmpty;
     }
-    //Construct target path (path to temp file)
-    temp_p = origin_p;
-    string tmp_filename = ".tmp_" + temp_p.filename().string();
-    temp_p.replace_filename(tmp_filename);
-    //Copy file, return error if action failed.
-    if (!fs::copy_file(origin_p, temp_p, fs::copy_options::overwrite_existing)){
-        return EC_FileCopy;
-    }
-    //Now that we copied the file, we add the _END_ termination into a new line.
-    ofstream temp_file;
-    temp_file.open(temp_p, ios_base::app);
-    //If file could not be opened, delete temp file and return error.
-    if (!temp_file.is_open()){
-        ErrorCode ec = SafeDeleteFile(temp_p);
-        if (ec != EC_None){
-            return ec;
+    //Prepare variables we need
+    bool found_tmp_end = 0;
+    fix = 0;
+    fixed_data.clear();
+    vector<string> valid_data;
+    string data;
+    //Get all valid data.
+    istringstream file_in(file_data);
+    while (getline(file_in, data, '|')){
+        //If temp file and end "flag" found
+        if (temp_file && data == "_END_"){
+            //Force a new getline to trigger eof
+            getline(file_in, data, '|');
+            //If eof is set, temp file is good
+            if (file_in.eof()){
+                //Set end flag found
+                found_tmp_end = 1;
+            }
+            //Else, discard file
+            else {
+                fix = 1;
+            }
+            break;
+        }
+        //Else, if data is valid
+        else if (IsValidData(data, file_type)){
+            //If file type is users_dat or usr_foods_dat
+            if (file_type == users_dat || file_type == usr_foods_dat){
+                //If valid data is empty                
+                if (valid_data.empty()){
+                    valid_data.push_back(data);
+                }
+                //Else
+                else {
+                    //Try to find if name is duplicated
+                    bool save = 1;
+                    for (string& name : valid_data){
+                        //Process name condition
+                        switch (file_type){
+                            case users_dat: {
+                                save = name != data;
+                            }
+                            case usr_foods_dat: {
+                                save = name.substr(1,name.find_first_of('/')) != data.substr(1,data.find_first_of('/'));
+                            }
+                        }
+                        //If duplicated, break
+                        if (!save){
+                            break;
+                        }
+                    }
+                    //If not, save it
+                    if (save){
+                        valid_data.push_back(data);
+                    }
+                    //If discarded, set fix to true
+                    else {
+                        fix = 1;
+                    }
+                }
+            }
+            //Else, for x_day_dat
+            else {
+                //Save string
+                valid_data.push_back(data);
+                //If line requirement is exceeded, remove last entry and break loop.
+                if (valid_data.size() > nutrients::Count()) {
+                    valid_data.pop_back();
+                    fix = 1;
+                    break;
+                }
+            }
+        }
+        //Else, discard data and set fix to true.
+        else {
+            fix = 1;
         }
-        return EC_FileWriteNoPerm;
     }
-    //Append "_END_"
-    temp_file << "_END_|";
-    //Close file
-    temp_file.close();
-    //Return with success
+    //If temp file
+    if (temp_file){
+        //If no end, something invalid or no valid entries were found, file is corrupted.
+        if (!found_tmp_end || fix || valid_data.empty()){
+            return EC_FileCorrupted;
+        }
+        //Else, return success.
+        else {
+            return EC_None;
+        }
+    }
+    //If normal file
+    else {
+        //If no valid data, return corrupted
+        if (valid_data.empty()){
+            return EC_FileCorrupted;
+        }
+        //If x_day_dat and not enough nutrients detected (missing or written under an older schema), add missing ones.
+        else if (file_type == x_day_dat && valid_data.size() < nutrients::Count()){
+            for (uint8_t i = valid_data.size(); i < nutrients::Count(); i++){
+                valid_data.push_back("{0.0}");
+            }
+            fix = 1;
+        }
+        //If usr_foods_dat, add the nutrients missing from foods written under an older schema.
+        else if (file_type == usr_foods_dat){
+            for (string& data : valid_data){
+                fix |= PadFoodData(data);
+            }
+        }
+        //Build valid data string.
+        for (string& data : valid_data){
+            fixed_data += data + '|';
+        }
+        return EC_None;
+    }
+}
+/**
+ * @brief Check binary food catalog data without touching any file (same rules UserFoodsBinCheck() applies to the file on disk).
+ * @param file_data Whole user_foods.bin content.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_FileEmpty; EC_None;
+**/
+ErrorCode filemanager::FoodsBinDataCheck(const string& file_data){
+    //Check header
+    s_foods_bin_header header;
+    if (file_data.size() < sizeof(header)){
+        return EC_FileCorrupted;
+    }
+    memcpy(&header, file_data.data(), sizeof(header));
+    if (memcmp(header.magic, FOODS_BIN_MAGIC, 4) != 0 || header.version != FOODS_BIN_VERSION || header.values != FOODS_BIN_VALUES){
+        return EC_FileCorrupted;
+    }
+    //Data size must match record count
+    if (file_data.size() != sizeof(s_foods_bin_header) + (uintmax_t)header.records * sizeof(s_food_record)){
+        return EC_FileCorrupted;
+    }
+    //Check every record and their order.
+    uint32_t tombstones = 0;
+    s_food_record record, previous;
+    for (uint32_t i = 0; i < header.records; i++){
+        memcpy(&record, file_data.data() + sizeof(header) + (size_t)i * sizeof(record), sizeof(record));
+        //If record is not valid or not strictly after the previous one, return error.
+        if (!IsValidFoodRecord(record) || (i > 0 && strcmp(previous.name, record.name) >= 0)){
+            return EC_FileCorrupted;
+        }
+        //Count tombstones
+        if (!record.alive){
+            tombstones++;
+        }
+        previous = record;
+    }
+    //If tombstone count does not match, return error.
+    if (tombstones != header.tombstones){
+        return EC_FileCorrupted;
+    }
+    //If no alive records, catalog is empty.
+    if (tombstones == header.records){
+        return EC_FileEmpty;
+    }
+    return EC_None;
+}
+/**
+ * @brief Hash a whole file (FNV-1a, 64 bit), reading it in chunks.
+ * @param file_p Path to file.
+ * @param hash Variable that will contain the file hash.
+ * @returns Possible ErrorCodes: EC_FileNotFound; EC_FileReadNoPerm; EC_None;
+**/
+ErrorCode filemanager::HashFile(const fs::path& file_p, uint64_t& hash){
+    //If path is invalid or is directory, return error.
+    if (!fs::exists(file_p) || fs::is_directory(file_p)){
+        return EC_FileNotFound;
+    }
+    //Open file
+    ifstream data_in;
+    data_in.open(file_p, ios_base::binary);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    //Hash every chunk
+    hash = FNV_OFFSET;
+    vector<char> buffer(1 << 16);
+    uint64_t bytes = 0;
+    while (data_in.read(buffer.data(), buffer.size()) || data_in.gcount() > 0){
+        hash = HashData(buffer.data(), data_in.gcount(), hash);
+        bytes += data_in.gcount();
+    }
+    data_in.close();
+    profiler::CountRead(bytes);
     return EC_None;
 }
 /**
- * @brief Restore original file from a temp file. It copies the temp file and then removes the _END_ file termination. This does NOT check if the temp file data is corrupted, only if the temp file is empty (excluding _END_ termination) or if _END_ termination is misplaced. The temp file will be deleted after the operation only if it is successful.
+ * @brief Hash a block of bytes (FNV-1a, 64 bit). Blocks can be chained by passing the previous hash.
+ * @param data Pointer to the bytes to hash.
+ * @param size Amount of bytes.
+ * @param hash Hash to continue from. Defaulted to FNV_OFFSET (new hash).
+ * @returns Resulting hash.
+**/
+uint64_t filemanager::HashData(const char* data, const size_t size, uint64_t hash){
+    for (size_t i = 0; i < size; i++){
+        hash ^= (uint8_t)data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+/**
+ * @brief Restore original file from a legacy temp file (left behind by older versions that rewrote files in place). It copies the temp file and then removes the _END_ file termination. This does NOT check if the temp file data is corrupted, only if the temp file is empty (excluding _END_ termination) or if _END_ termination is misplaced. The temp file will be deleted after the operation only if it is successful.
  * @param file_p Path to temp file. The original file will be created at the same location. Folder paths and empty files are not allowed.
 **/
 ErrorCode filemanager::RestoreTempFile(const fs::path& file_p){
+    profiler::span recovery(profiler::SP_TempRecovery);
     //If path is invalid or is directory, return error.
     if (!fs::exists(file_p) || fs::is_directory(file_p)){
         return EC_FileNotFound;
@@ -871,23 +1637,16 @@ ErrorCode filemanager::RestoreTempFile(const fs::path& file_p){
     if (!tmp_file.is_open()){
         return EC_FileReadNoPerm;
     }
-    //Create new file
-    ofstream or_file;
-    or_file.open(to);
-    if (!or_file.is_open()){
-        return EC_FileWriteNoPerm;
-    }
     //Copy data until _END_ termination is found. If not found, return error.
-    string data;
+    string data, or_data;
     bool first_line = 1, found_end = 0;
     while (getline(tmp_file, data, '|')){
         //If we are at the first line
         if (first_line){
-            //If first line is equal to _END_, delete new file and return error.
+            //If first line is equal to _END_, delete temp file and return error.
             if (data == "_END_"){
-                or_file.close();
                 tmp_file.close();
-                if(!fs::remove(file_p)){
+                if(AllowChange("remove", file_p) && !fs::remove(file_p)){
                     return EC_FileRemoveNoPerm;
                 }
                 return EC_FileCorrupted;
@@ -902,11 +1661,10 @@ ErrorCode filemanager::RestoreTempFile(const fs::path& file_p){
             //If _END_ reached, perform EOF check.
             if (data == "_END_"){
                 getline(tmp_file, data, '|');
-                //If there is more data after _END_, delete new file and return error.
+                //If there is more data after _END_, delete temp file and return error.
                 if (!tmp_file.eof()){
-                    or_file.close();
                     tmp_file.close();
-                    if(!fs::remove(file_p)){
+                    if(AllowChange("remove", file_p) && !fs::remove(file_p)){
                         return EC_FileRemoveNoPerm;
                     }
                     return EC_FileCorrupted;
@@ -917,20 +1675,25 @@ ErrorCode filemanager::RestoreTempFile(const fs::path& file_p){
             }
         }
         //Input data
-        or_file << data << '|';
+        or_data += data + '|';
     }
-    //Close files
-    or_file.close();
+    //Close file
     tmp_file.close();
-    //If _END_ not found, delete new file and return error.
+    profiler::CountRead(or_data.size());
+    //If _END_ not found, delete temp file and return error.
     if (!found_end){
-        if(!fs::remove(file_p)){
+        if(AllowChange("remove", file_p) && !fs::remove(file_p)){
             return EC_FileRemoveNoPerm;
         }
         return EC_FileCorrupted;
     }
-    //Else, delete temp file
-    else if (!fs::remove(file_p)){
+    //Replace original file
+    ErrorCode ec = CommitFile(to, or_data);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Delete temp file
+    if (AllowChange("remove", file_p) && !fs::remove(file_p)){
         return EC_FileRemoveNoPerm;
     }
     //Return with success
@@ -941,6 +1704,7 @@ ErrorCode filemanager::RestoreTempFile(const fs::path& file_p){
  * @returns Possible returns: EC_FileNotFound; EC_FileEmpty; EC_FileReadNoPerm; EC_FileCorrupted; EC_None;
 **/
 ErrorCode filemanager::UsersDataCheck(){
+    latency::phase_scope phase(latency::PH_Validation);
     fs::path usersdat = users_dat_p;
     //See if file path is valid
     if (!fs::exists(usersdat)){
@@ -992,6 +1756,7 @@ ErrorCode filemanager::UsersDataCheck(){
  * @returns Possible returns: EC_FileNotFound; EC_FileReadNoPerm; EC_FileCorrupted; EC_None;
 **/
 ErrorCode filemanager::DayDataCheck(const fs::path& day_p){
+    latency::phase_scope phase(latency::PH_Validation);
     //See if file path is valid
     if (!fs::exists(day_p)){
         return EC_FileNotFound;
@@ -1015,7 +1780,7 @@ ErrorCode filemanager::DayDataCheck(const fs::path& day_p){
             //Sum one line
             lines++;
             //If line requirement is exceeded, return error.
-            if (lines > NUM_OF_MACROS){
+            if (lines > nutrients::Count()){
                 file_in.close();
                 return EC_FileCorrupted;
             }
@@ -1026,8 +1791,8 @@ ErrorCode filemanager::DayDataCheck(const fs::path& day_p){
             return EC_FileCorrupted;
         }
     }
-    //If line requirement is not met, return error.
-    if (lines != NUM_OF_MACROS){
+    //If line requirement is not met, return error. Files written under an older schema (fewer nutrients) are accepted, readers take missing nutrients as 0.
+    if (lines < NUM_OF_MACROS){
         file_in.close();
         return EC_FileCorrupted;
     }
@@ -1041,6 +1806,7 @@ ErrorCode filemanager::DayDataCheck(const fs::path& day_p){
  * @returns Possible returns: EC_FileNotFound; EC_FileReadNoPerm; EC_FileCorrupted; EC_None;
 **/
 ErrorCode filemanager::UserFoodsDatCheck(const fs::path& usrfd_p){
+    latency::phase_scope phase(latency::PH_Validation);
     //See if file path is valid
     if (!fs::exists(usrfd_p) || fs::is_directory(usrfd_p)){
         return EC_FileNotFound;
@@ -1086,18 +1852,191 @@ ErrorCode filemanager::UserFoodsDatCheck(const fs::path& usrfd_p){
     file_in.close();
     return EC_None;
 }
+/**
+ * @brief Validate user_foods.bin following catalog rules (valid header, valid records sorted by name and matching tombstone count). If file is corrupted, returns EC_FileCorrupted. If it has no alive records, it returns EC_FileEmpty.
+ * @param usrfb_p Path to file. Make sure path is valid (not a folder and not a different file).
+ * @returns Possible returns: EC_FileEmpty; EC_FileCorrupted; EC_None;
+ * @returns [OR] ErrorCodes thrown by ReadFoodsBin();
+**/
+ErrorCode filemanager::UserFoodsBinCheck(const fs::path& usrfb_p){
+    latency::phase_scope phase(latency::PH_Validation);
+    //Read catalog
+    s_foods_bin_header header;
+    vector<s_food_record> records;
+    ErrorCode ec = ReadFoodsBin(usrfb_p, records, &header);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Check every record and their order.
+    uint32_t tombstones = 0;
+    for (size_t i = 0; i < records.size(); i++){
+        //If record is not valid, return error.
+        if (!IsValidFoodRecord(records[i])){
+            return EC_FileCorrupted;
+        }
+        //If record is not strictly after the previous one, return error.
+        if (i > 0 && strcmp(records[i - 1].name, records[i].name) >= 0){
+            return EC_FileCorrupted;
+        }
+        //Count tombstones
+        if (!records[i].alive){
+            tombstones++;
+        }
+    }
+    //If tombstone count does not match, return error.
+    if (tombstones != header.tombstones){
+        return EC_FileCorrupted;
+    }
+    //If no alive records, catalog is empty.
+    if (tombstones == records.size()){
+        return EC_FileEmpty;
+    }
+    return EC_None;
+}
+/**
+ * @brief Validate the food catalog of an user, whatever its format is. The binary catalog (user_foods.bin) takes precedence over the text one (user_foods.dat).
+ * @param username In-file name of the user.
+ * @returns ErrorCodes thrown by UserFoodsBinCheck() or UserFoodsDatCheck();
+**/
+ErrorCode filemanager::UserFoodsCheck(const string& username){
+    latency::phase_scope phase(latency::PH_Validation);
+    fs::path foodsbin = foods_bin(username);
+    if (fs::exists(foodsbin)){
+        return UserFoodsBinCheck(foodsbin);
+    }
+    return UserFoodsDatCheck(foods_dat(username));
+}
+/**
+ * @brief Read every record (tombstones included) of a binary food catalog. Only the header and file size are checked here; use UserFoodsBinCheck() to validate records. Catalogs written in an older format are migrated in memory (see MigrateFoodsBinData()).
+ * @param usrfb_p Path to user_foods.bin.
+ * @param records Vector that will contain the records. It will be cleared.
+ * @param header Optional pointer to return the catalog header, as stored in file (an older version means records were migrated).
+ * @returns Possible returns: EC_FileNotFound; EC_FileCorrupted; EC_None;
+ * @returns [OR] ErrorCodes thrown by ReadFileData();
+**/
+ErrorCode filemanager::ReadFoodsBin(const fs::path& usrfb_p, vector<s_food_record>& records, s_foods_bin_header* header){
+    records.clear();
+    //See if file path is valid
+    if (!fs::exists(usrfb_p) || fs::is_directory(usrfb_p)){
+        return EC_FileNotFound;
+    }
+    //Read file
+    string file_data;
+    ErrorCode ec = ReadFileData(usrfb_p, file_data);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Keep stored header and migrate older formats
+    s_foods_bin_header t_header;
+    if (file_data.size() < sizeof(t_header)){
+        return EC_FileCorrupted;
+    }
+    memcpy(&t_header, file_data.data(), sizeof(t_header));
+    MigrateFoodsBinData(file_data);
+    //Check header
+    s_foods_bin_header c_header;
+    memcpy(&c_header, file_data.data(), sizeof(c_header));
+    if (memcmp(c_header.magic, FOODS_BIN_MAGIC, 4) != 0 || c_header.version != FOODS_BIN_VERSION || c_header.values != FOODS_BIN_VALUES){
+        return EC_FileCorrupted;
+    }
+    //File size must match record count
+    if (file_data.size() != sizeof(s_foods_bin_header) + (uintmax_t)c_header.records * sizeof(s_food_record)){
+        return EC_FileCorrupted;
+    }
+    //Copy records
+    records.resize(c_header.records);
+    if (!records.empty()){
+        memcpy(records.data(), file_data.data() + sizeof(c_header), records.size() * sizeof(s_food_record));
+    }
+    //Return header if asked
+    if (header != NULL){
+        *header = t_header;
+    }
+    return EC_None;
+}
+/**
+ * @brief Migrate binary food catalog data written in an older format to the current one. Version 1 records held exactly NUM_OF_MACROS macros followed by the portion size; their nutrients keep their index and the portion moves to PORTION_INDEX.
+ * @param file_data Whole user_foods.bin content. Replaced if migrated; left untouched if it is current or not a recognized catalog.
+ * @returns 1(true) if data was migrated, 0(false) if not.
+**/
+bool filemanager::MigrateFoodsBinData(string& file_data){
+    //Version 1 record layout
+    typedef struct {
+        char name[MAX_FOOD_NAME];
+        uint8_t alive;
+        double macros[NUM_OF_MACROS + 1];
+    } s_food_record_v1;
+    //Check header
+    s_foods_bin_header header;
+    if (file_data.size() < sizeof(header)){
+        return 0;
+    }
+    memcpy(&header, file_data.data(), sizeof(header));
+    if (memcmp(header.magic, FOODS_BIN_MAGIC, 4) != 0 || header.version != 1 || header.values != NUM_OF_MACROS + 1 || file_data.size() != sizeof(header) + (uintmax_t)header.records * sizeof(s_food_record_v1)){
+        return 0;
+    }
+    //Convert records
+    string data;
+    data.reserve(sizeof(header) + (size_t)header.records * sizeof(s_food_record));
+    s_food_record_v1 old_record;
+    s_food_record record;
+    for (uint32_t i = 0; i < header.records; i++){
+        memcpy(&old_record, file_data.data() + sizeof(header) + (size_t)i * sizeof(old_record), sizeof(old_record));
+        memset(&record, 0, sizeof(record));
+        memcpy(record.name, old_record.name, MAX_FOOD_NAME);
+        record.alive = old_record.alive;
+        for (uint8_t m = 0; m < NUM_OF_MACROS; m++){
+            record.macros[m] = old_record.macros[m];
+        }
+        record.macros[PORTION_INDEX] = old_record.macros[NUM_OF_MACROS];
+        data.append((const char*)&record, sizeof(record));
+    }
+    //Write current header
+    header.version = FOODS_BIN_VERSION;
+    header.values = FOODS_BIN_VALUES;
+    data.insert(0, (const char*)&header, sizeof(header));
+    file_data = move(data);
+    return 1;
+}
+/**
+ * @brief Write a new binary food catalog with the given records, dropping tombstones (compaction). Records must be sorted by name. The file is replaced with CommitFile().
+ * @param usrfb_p Path to user_foods.bin.
+ * @param records Records to write.
+ * @returns ErrorCodes thrown by CommitFile();
+**/
+ErrorCode filemanager::WriteFoodsBin(const fs::path& usrfb_p, const vector<s_food_record>& records){
+    //Prepare header
+    s_foods_bin_header header;
+    memcpy(header.magic, FOODS_BIN_MAGIC, 4);
+    header.version = FOODS_BIN_VERSION;
+    header.values = FOODS_BIN_VALUES;
+    header.records = 0;
+    header.tombstones = 0;
+    //Serialize alive records
+    string data;
+    for (const s_food_record& r : records){
+        if (r.alive){
+            data.append((const char*)&r, sizeof(s_food_record));
+            header.records++;
+        }
+    }
+    data.insert(0, (const char*)&header, sizeof(header));
+    //Commit catalog
+    return CommitFile(usrfb_p, data);
+}
 /**
  * @brief Delete a file with ErrorCode integration.
  * @param file_p Path to file. It must exists and be a path to file, not a directory.
  * @returns Possible returns: EC_FileNotFound; EC_FileRemoveNoPerm; EC_None;
 **/
 ErrorCode filemanager::SafeDeleteFile(const fs::path& file_p){
+    latency::phase_scope phase(latency::PH_Write);
     //If file does not exist or it is not a file, return error.
     if (!fs::exists(file_p) || fs::is_directory(file_p)){
         return EC_FileNotFound;
     }
-    //Delete file
-    if (!fs::remove(file_p)){
+    //Delete file (skipped on check only runs)
+    if (AllowChange("remove", file_p) && !fs::remove(file_p)){
         //If we could not remove it, return error.
         return EC_FileRemoveNoPerm;
     }
@@ -1110,12 +2049,13 @@ ErrorCode filemanager::SafeDeleteFile(const fs::path& file_p){
  * @returns Possible returns: EC_DirNotFound; EC_DirRemoveNoPerm; EC_None;
 **/
 ErrorCode filemanager::SafeDeleteFolder(const fs::path& folder){
+    latency::phase_scope phase(latency::PH_Write);
     //If folder does not exist or it is not a folder, return error.
     if (!fs::exists(folder) || !fs::is_directory(folder)){
         return EC_DirNotFound;
     }
-    //Delete folder
-    if (fs::remove_all(folder) <= 0){
+    //Delete folder (skipped on check only runs)
+    if (AllowChange("remove", folder) && fs::remove_all(folder) <= 0){
         //If we could not remove it, return error.
         return EC_DirRemoveNoPerm;
     }
@@ -1137,4 +2077,408 @@ filesystem::path filemanager::GetDateDataPath(const string& username, const date
     path.append(to_string(date_data.week_day) + "_day.dat");
     return path;
 }   
-#pragma endregion
\ No newline at end of file
+/**
+ * @brief Get compacted year file path for the given year and user.
+ * @param username Name of the user to search.
+ * @param year Target year.
+ * @returns filesystem::path to <year>_year.bin inside the user folder.
+ * @warning The function does NOT check if the file exists.
+**/
+filesystem::path filemanager::GetYearDataPath(const string& username, const int year){
+    filesystem::path path = user_folder(username);
+    path.append(to_string(year) + "_year.bin");
+    return path;
+}
+/**
+ * @brief Check compacted year file data (header, size, checksum and values) without touching any file.
+ * @param file_data Whole <year>_year.bin content.
+ * @param year Year the file must hold.
+ * @param columns Optional pointer to a vector that will contain the nutrient columns (nutrients::Count() * YEAR_BIN_DAYS values, column-major). Columns of nutrients the file was not written with are 0.
+ * @param verified If 1(true), the data was verified before and only the header and size are checked (checksum and values are skipped).
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+**/
+ErrorCode filemanager::YearBinDataCheck(const string& file_data, const int year, vector<double>* columns, const bool verified){
+    //Check header and size
+    s_year_bin_header header;
+    if (file_data.size() < sizeof(header)){
+        return EC_FileCorrupted;
+    }
+    memcpy(&header, file_data.data(), sizeof(header));
+    if (memcmp(header.magic, YEAR_BIN_MAGIC, 4) != 0 || header.version != YEAR_BIN_VERSION || header.year != year || header.values < NUM_OF_MACROS || header.values > MAX_NUTRIENTS || header.days != YEAR_BIN_DAYS){
+        return EC_FileCorrupted;
+    }
+    const size_t values = (size_t)header.values * YEAR_BIN_DAYS;
+    if (file_data.size() != sizeof(header) + values * sizeof(double)){
+        return EC_FileCorrupted;
+    }
+    //Check checksum
+    if (!verified && HashData(file_data.data() + sizeof(header), values * sizeof(double)) != header.checksum){
+        return EC_FileCorrupted;
+    }
+    //Check values
+    vector<double> t_columns(values);
+    memcpy(t_columns.data(), file_data.data() + sizeof(header), values * sizeof(double));
+    for (size_t i = 0; !verified && i < values; i++){
+        if (!isfinite(t_columns[i]) || t_columns[i] < 0){
+            return EC_FileCorrupted;
+        }
+    }
+    //Return columns if asked, one per schema nutrient (missing ones are 0).
+    if (columns != NULL){
+        t_columns.resize((size_t)nutrients::Count() * YEAR_BIN_DAYS, 0);
+        *columns = move(t_columns);
+    }
+    return EC_None;
+}
+/**
+ * @brief Read a compacted year file, checking it. A file is fully checked (checksum and values) once per process: while its size and write time do not change, it is not verified again, and the columns of the last YEAR_CACHE_COLUMNS files read are served from memory.
+ * @param year_p Path to <year>_year.bin.
+ * @param year Year the file must hold.
+ * @param columns Vector that will contain the nutrient columns (nutrients::Count() * YEAR_BIN_DAYS values, column-major).
+ * @returns ErrorCodes thrown by any of this functions: ReadFileData(); YearBinDataCheck();
+**/
+ErrorCode filemanager::ReadYearBin(const fs::path& year_p, const int year, vector<double>& columns){
+    //Look for the file in the verified files
+    string key = year_p.lexically_normal().string();
+    uintmax_t size;
+    fs::file_time_type write_time;
+    bool stamped = GetFileStamp(year_p, size, write_time);
+    bool verified = 0;
+    if (stamped){
+        lock_guard<mutex> lock(c_year_mutex);
+        auto it = c_year_cache.find(key);
+        if (it != c_year_cache.end() && it->second.size == size && it->second.write_time == write_time){
+            verified = 1;
+            //Columns still in memory
+            if (!it->second.columns.empty()){
+                it->second.used = ++c_year_clock;
+                columns = it->second.columns;
+                columns.resize((size_t)nutrients::Count() * YEAR_BIN_DAYS, 0);
+                return EC_None;
+            }
+        }
+    }
+    //Read and check file
+    string file_data;
+    ErrorCode ec = ReadFileData(year_p, file_data);
+    if (ec == EC_None){
+        ec = YearBinDataCheck(file_data, year, &columns, verified);
+    }
+    //Remember it as verified, or forget it
+    lock_guard<mutex> lock(c_year_mutex);
+    if (ec != EC_None || !stamped){
+        c_year_cache.erase(key);
+        return ec;
+    }
+    c_year_cache[key] = {size, write_time, columns, ++c_year_clock};
+    //Drop the columns of the least recently read file if too many are kept
+    size_t kept = 0;
+    auto oldest = c_year_cache.end();
+    for (auto it = c_year_cache.begin(); it != c_year_cache.end(); it++){
+        if (it->second.columns.empty()){
+            continue;
+        }
+        kept++;
+        if (oldest == c_year_cache.end() || it->second.used < oldest->second.used){
+            oldest = it;
+        }
+    }
+    if (kept > YEAR_CACHE_COLUMNS){
+        oldest->second.columns = vector<double>();
+    }
+    return EC_None;
+}
+/**
+ * @brief Fold a year folder (<year>/<month>/<day>/<week day>_day.dat tree) into a single compacted year file, then remove the folder. If a year file already exists, day files found in the folder replace its values for those days.
+ * @param username User to compact.
+ * @param year Year to compact. It should be a past year, as compacted years are read-only.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: ReadYearBin(); ReadFileData(); CommitFile(); SafeDeleteFolder();
+ * @warning Day files are expected to be validated already (ValidateUserFolder() runs before compaction); days that do not pass ValidateData() are skipped.
+**/
+ErrorCode filemanager::CompactYear(const string& username, const int year){
+    fs::path year_f = user_folder(username);
+    year_f.append(to_string(year));
+    fs::path year_p = GetYearDataPath(username, year);
+    //Start from existing year file, if any.
+    vector<double> columns((size_t)nutrients::Count() * YEAR_BIN_DAYS, 0);
+    ErrorCode ec;
+    if (fs::exists(year_p)){
+        ec = ReadYearBin(year_p, year, columns);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Add every day file
+    if (fs::is_directory(year_f)){
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(year_f)){
+            string fname = entry.path().filename().string();
+            if (!entry.is_regular_file() || !fname.ends_with("_day.dat") || fname.starts_with(".")){
+                continue;
+            }
+            //Get day of year from folders
+            date::month_name month = static_cast<date::month_name>(stoul(entry.path().parent_path().parent_path().filename().string()));
+            uint8_t month_day = stoul(entry.path().parent_path().filename().string());
+            uint16_t year_day = date::GetYearDay(year, month, month_day);
+            //Read and check day data
+            string file_data, valid_data;
+            bool fix;
+            ec = ReadFileData(entry.path(), file_data);
+            if (ec != EC_None){
+                return ec;
+            }
+            if (ValidateData(x_day_dat, file_data, valid_data, fix) != EC_None){
+                continue;
+            }
+            //Store every nutrient in its column
+            size_t start = 0, end;
+            for (uint8_t m = 0; m < nutrients::Count() && (end = valid_data.find('|', start)) != string::npos; m++){
+                string data = valid_data.substr(start, end - start);
+                start = end + 1;
+                strings::RemoveBrackets(data);
+                columns[(size_t)m * YEAR_BIN_DAYS + year_day] = stod(data);
+            }
+        }
+    }
+    //Build year file
+    s_year_bin_header header = {{0}, YEAR_BIN_VERSION, year, nutrients::Count(), YEAR_BIN_DAYS, 0, 0};
+    memcpy(header.magic, YEAR_BIN_MAGIC, 4);
+    header.checksum = HashData((const char*)columns.data(), columns.size() * sizeof(double));
+    string file_data((const char*)&header, sizeof(header));
+    file_data.append((const char*)columns.data(), columns.size() * sizeof(double));
+    //Commit year file and remove year folder
+    ec = CommitFile(year_p, file_data);
+    {
+        lock_guard<mutex> lock(c_year_mutex);
+        c_year_cache.erase(year_p.lexically_normal().string());
+    }
+    if (ec != EC_None){
+        return ec;
+    }
+    if (fs::is_directory(year_f)){
+        return SafeDeleteFolder(year_f);
+    }
+    return EC_None;
+}
+/**
+ * @brief Compaction job. Folds every past year folder of a user into its compacted year file (see CompactYear()) and rebuilds their year presence maps. It is not part of the files check; run it on a validated user folder.
+ * @param username User to compact.
+ * @param compacted Optional pointer that will contain the amount of compacted years.
+ * @returns Possible ErrorCodes: EC_DirNotFound; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: CompactYear(); RebuildYearMap();
+**/
+ErrorCode filemanager::CompactPastYears(const string& username, size_t* compacted){
+    if (compacted != NULL){
+        *compacted = 0;
+    }
+    fs::path usr_p = user_folder(username);
+    if (!fs::is_directory(usr_p)){
+        return EC_DirNotFound;
+    }
+    //Gather past year folders
+    vector<int> years;
+    for (const fs::directory_entry& entry : fs::directory_iterator(usr_p)){
+        string name = entry.path().filename().string();
+        if (entry.is_directory() && name.length() < 10 && strings::IsNumericStr(name, Mode_Int) && stoi(name) < date::calendar().GetYear()){
+            years.push_back(stoi(name));
+        }
+    }
+    //Compact them
+    for (int year : years){
+        ErrorCode ec = CompactYear(username, year);
+        if (ec == EC_None){
+            ec = RebuildYearMap(username, year);
+        }
+        if (ec != EC_None){
+            return ec;
+        }
+        if (compacted != NULL){
+            (*compacted)++;
+        }
+    }
+    return EC_None;
+}
+/**
+ * @brief Checks if a file name is a per-year file name (<year><suffix>, like 2024_year.bin).
+ * @param file_name File name to check.
+ * @param suffix Expected suffix.
+ * @param year Optional pointer that will contain the year.
+ * @returns 1(true) if it is a per-year file name, 0(false) if not.
+**/
+bool filemanager::IsYearFileName(const string& file_name, const string& suffix, int* year){
+    //Year must be a short numeric string
+    if (file_name.length() <= suffix.length() || file_name.length() > suffix.length() + 9 || !file_name.ends_with(suffix)){
+        return 0;
+    }
+    string year_str = file_name.substr(0, file_name.length() - suffix.length());
+    if (!strings::IsNumericStr(year_str, Mode_Int)){
+        return 0;
+    }
+    if (year != NULL){
+        *year = stoi(year_str);
+    }
+    return 1;
+}
+/**
+ * @brief Get year presence map path for the given year and user.
+ * @param username Name of the user to search.
+ * @param year Target year.
+ * @returns filesystem::path to <year>_days.map inside the user folder.
+ * @warning The function does NOT check if the file exists.
+**/
+filesystem::path filemanager::GetYearMapPath(const string& username, const int year){
+    filesystem::path path = user_folder(username);
+    path.append(to_string(year) + "_days.map");
+    return path;
+}
+/**
+ * @brief Check year presence map data without touching any file.
+ * @param file_data Whole <year>_days.map content.
+ * @param year Year the map belongs to (days past the year length must be clear).
+ * @param days Optional pointer that will contain the map.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+**/
+ErrorCode filemanager::YearMapDataCheck(const string& file_data, const int year, year_map* days){
+    if (file_data.size() != YEAR_MAP_BYTES){
+        return EC_FileCorrupted;
+    }
+    //Unpack bits
+    year_map t_days;
+    for (size_t d = 0; d < YEAR_BIN_DAYS; d++){
+        t_days[d] = (file_data[d / 8] >> (d % 8)) & 1;
+    }
+    //Check days past the year length (and padding bits).
+    for (size_t d = date::IsLeapYear(year) ? 366 : 365; d < YEAR_MAP_BYTES * 8; d++){
+        if ((file_data[d / 8] >> (d % 8)) & 1){
+            return EC_FileCorrupted;
+        }
+    }
+    if (days != NULL){
+        *days = t_days;
+    }
+    return EC_None;
+}
+/**
+ * @brief Read the year presence map of a user.
+ * @param username Name of the user to search.
+ * @param year Target year.
+ * @param days Map that will contain the days with data.
+ * @returns Possible ErrorCodes: EC_FileNotFound;
+ * @returns [OR] ErrorCodes thrown by any of this functions: ReadFileData(); YearMapDataCheck();
+**/
+ErrorCode filemanager::ReadYearMap(const string& username, const int year, year_map& days){
+    latency::phase_scope phase(latency::PH_Parse);
+    fs::path map_p = GetYearMapPath(username, year);
+    days.reset();
+    if (!fs::exists(map_p)){
+        return EC_FileNotFound;
+    }
+    string file_data;
+    ErrorCode ec = ReadFileData(map_p, file_data);
+    if (ec != EC_None){
+        return ec;
+    }
+    return YearMapDataCheck(file_data, year, &days);
+}
+/**
+ * @brief Write the year presence map of a user. If no day is set, the map file is removed. The file is only written if its content changes.
+ * @param username User to write.
+ * @param year Target year.
+ * @param days Days with data.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: ReadFileData(); CommitFile(); SafeDeleteFile();
+**/
+ErrorCode filemanager::WriteYearMap(const string& username, const int year, const year_map& days){
+    fs::path map_p = GetYearMapPath(username, year);
+    //If no days, remove map
+    if (days.none()){
+        return fs::exists(map_p) ? SafeDeleteFile(map_p) : EC_None;
+    }
+    //Pack bits
+    string file_data(YEAR_MAP_BYTES, '\0');
+    for (size_t d = 0; d < YEAR_BIN_DAYS; d++){
+        if (days[d]){
+            file_data[d / 8] |= 1 << (d % 8);
+        }
+    }
+    //Skip write if nothing changed
+    if (fs::exists(map_p)){
+        string old_data;
+        ErrorCode ec = ReadFileData(map_p, old_data);
+        if (ec != EC_None){
+            return ec;
+        }
+        if (old_data == file_data){
+            return EC_None;
+        }
+    }
+    return CommitFile(map_p, file_data);
+}
+/**
+ * @brief Set or clear a single day in the year presence map of a user.
+ * @param username User to update.
+ * @param date_data Day to update.
+ * @param present 1 if the day has data, 0 if not.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: ReadYearMap(); WriteYearMap();
+**/
+ErrorCode filemanager::SetYearMapDay(const string& username, const date::s_date& date_data, const bool present){
+    year_map days;
+    ErrorCode ec = ReadYearMap(username, date_data.year, days);
+    //A missing or corrupted map is rebuilt from scratch.
+    if (ec == EC_FileNotFound || ec == EC_FileCorrupted){
+        return RebuildYearMap(username, date_data.year);
+    }
+    else if (ec != EC_None){
+        return ec;
+    }
+    //If day is already up to date, skip write.
+    uint16_t year_day = date::GetYearDay(date_data.year, date_data.month, date_data.month_day);
+    if (days[year_day] == present){
+        return EC_None;
+    }
+    days[year_day] = present;
+    return WriteYearMap(username, date_data.year, days);
+}
+/**
+ * @brief Rebuild the year presence map of a user from its data (compacted year file and day files).
+ * @param username User to rebuild.
+ * @param year Target year.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: ReadYearBin(); WriteYearMap();
+ * @warning Year data is expected to be validated already. Any day file found counts as a day with data.
+**/
+ErrorCode filemanager::RebuildYearMap(const string& username, const int year){
+    year_map days;
+    ErrorCode ec;
+    //Compacted days
+    fs::path year_p = GetYearDataPath(username, year);
+    if (fs::exists(year_p)){
+        vector<double> columns;
+        ec = ReadYearBin(year_p, year, columns);
+        if (ec != EC_None){
+            return ec;
+        }
+        for (size_t i = 0; i < columns.size(); i++){
+            if (columns[i] != 0){
+                days.set(i % YEAR_BIN_DAYS);
+            }
+        }
+    }
+    //Day files
+    fs::path year_f = user_folder(username);
+    year_f.append(to_string(year));
+    if (fs::is_directory(year_f)){
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(year_f)){
+            string fname = entry.path().filename().string();
+            if (!entry.is_regular_file() || !fname.ends_with("_day.dat") || fname.starts_with(".")){
+                continue;
+            }
+            date::month_name month = static_cast<date::month_name>(stoul(entry.path().parent_path().parent_path().filename().string()));
+            uint8_t month_day = stoul(entry.path().parent_path().filename().string());
+            days.set(date::GetYearDay(year, month, month_day));
+        }
+    }
+    return WriteYearMap(username, year, days);
+}
+#pragma endregion
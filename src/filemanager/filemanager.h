@@ -1,6 +1,13 @@
 #include "../errors/errors.h"
 #include "../date/date.h"
+#include "../io/io_fb.h"
+#include "../nutrients/nutrients.h"
 #include <filesystem>
+#include <vector>
+#include <bitset>
+
+#ifndef _FILEMANAGER_
+#define _FILEMANAGER_
 
 #pragma region Paths
 #define data_f "data"
@@ -9,21 +16,151 @@
 #define usr_f "data/usr"
 #define user_folder(username) "data/usr/" + username
 #define foods_dat(username) "data/usr/" + username + "/" + username + "_foods.dat"
+#define foods_bin(username) "data/usr/" + username + "/" + username + "_foods.bin"
 #pragma endregion
 namespace filemanager {
 #pragma region Data
 //File types enums, starting at 0 with users_dat.
 enum files : uint8_t {users_dat, usr_foods_dat, x_day_dat};
+//Binary food catalog magic and version.
+#define FOODS_BIN_MAGIC "FBFC"
+#define FOODS_BIN_VERSION 2
+//Doubles stored per binary food record (nutrient capacity + portion).
+#define FOODS_BIN_VALUES (MAX_NUTRIENTS + 1)
+//FNV-1a 64 bit hash parameters (file content hashes).
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+/**
+ * @brief Header of the binary food catalog (user_foods.bin). It is followed by fixed-width records sorted by name.
+ * @param magic (char[4]) Always FOODS_BIN_MAGIC.
+ * @param version (uint32_t) Catalog format version.
+ * @param values (uint32_t) Doubles stored per record (FOODS_BIN_VALUES).
+ * @param records (uint32_t) Records in file, tombstones included.
+ * @param tombstones (uint32_t) Removed records waiting for compaction.
+**/
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t values;
+    uint32_t records;
+    uint32_t tombstones;
+} s_foods_bin_header;
+/**
+ * @brief Fixed-width food record of the binary food catalog.
+ * @param name (char[MAX_FOOD_NAME]) In-file food name, padded with '\0'.
+ * @param alive (uint8_t) 0 if the record is a tombstone.
+ * @param macros (double[FOODS_BIN_VALUES]) Nutrients per gram (schema order, unused ones are 0), portion size at PORTION_INDEX.
+**/
+typedef struct {
+    char name[MAX_FOOD_NAME];
+    uint8_t alive;
+    double macros[FOODS_BIN_VALUES];
+} s_food_record;
+//Compacted year file magic, version and days per year slot.
+#define YEAR_BIN_MAGIC "FBYR"
+#define YEAR_BIN_VERSION 1
+#define YEAR_BIN_DAYS 366
+/**
+ * @brief Header of a compacted year file (<year>_year.bin), which replaces a past year folder. It is followed by one column of YEAR_BIN_DAYS doubles per nutrient (column-major: every day of the first nutrient, then the next nutrient...). Days without data are 0.
+ * @param magic (char[4]) Always YEAR_BIN_MAGIC.
+ * @param version (uint32_t) Year file format version.
+ * @param year (int32_t) Year the file holds.
+ * @param values (uint32_t) Columns in file (nutrient count of the schema it was written with).
+ * @param days (uint32_t) Days per column.
+ * @param reserved (uint32_t) Padding, always 0.
+ * @param checksum (uint64_t) FNV-1a hash of the columns.
+**/
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int32_t year;
+    uint32_t values;
+    uint32_t days;
+    uint32_t reserved;
+    uint64_t checksum;
+} s_year_bin_header;
+//Year presence map (<year>_days.map): one bit per day of the year, set if the day has data. Stored as YEAR_MAP_BYTES raw bytes, day 0 in the lowest bit of the first byte.
+#define YEAR_MAP_BYTES ((YEAR_BIN_DAYS + 7) / 8)
+typedef bitset<YEAR_BIN_DAYS> year_map;
+//What a files check does with user folders of unregistered users: keep them, register them again or delete them.
+enum orphan_policy : uint8_t {OP_Keep, OP_Restore, OP_Delete};
+/**
+ * @brief Decides what to do with the folder of an unregistered user found by the initial files check (the terminal interface asks the user).
+ * @param orphan_p Path to the orphan user folder.
+ * @returns Policy to apply to the folder.
+**/
+typedef orphan_policy (*orphan_callback)(const filesystem::path& orphan_p);
+/**
+ * @brief Options of the non-interactive files check (foodbook-fsck).
+ * @param check_only (bool) If 1, nothing is written or removed; every change the check would make is only reported.
+ * @param orphans (filemanager::orphan_policy) What to do with user folders of unregistered users.
+ * @param jobs (size_t) Maximum users checked at once. If 0, hardware threads are used.
+**/
+typedef struct {
+    bool check_only;
+    orphan_policy orphans;
+    size_t jobs;
+} s_check_options;
+/**
+ * @brief Change made by a files check (or needed, on check only runs).
+ * @param action (string) "write" (file written or fixed), "remove" (file or folder removed), "quarantine" (corrupted file moved aside, see InitialFilesCheck()) or "orphan" (unregistered user folder kept).
+ * @param path (filesystem::path) Changed file or folder.
+ * @param upkeep (bool) 1 if the change is routine upkeep of a healthy tree (year presence maps and event indexes rebuilt, default schema written), not a repair of a problem.
+**/
+typedef struct {
+    string action;
+    filesystem::path path;
+    bool upkeep;
+} s_check_issue;
+/**
+ * @brief Files check result of a single user folder, or of the data folder itself (empty user name).
+ * @param user (string) In-file name of the user.
+ * @param status (ErrorCode) EC_None, or the error that stopped the check of this folder.
+ * @param issues (vector<s_check_issue>) Changes made or needed, in order.
+**/
+typedef struct {
+    string user;
+    ErrorCode status;
+    vector<s_check_issue> issues;
+} s_check_result;
 #pragma endregion
 #pragma region Public Function Headers
-ErrorCode InitialFilesCheck();
-ErrorCode CreateTempFile(const filesystem::path& origin_p, filesystem::path& temp_p);
+ErrorCode InitialFilesCheck(orphan_callback judge = NULL, vector<filesystem::path>* quarantined = NULL);
+ErrorCode CheckFiles(const s_check_options& options, vector<s_check_result>& results);
+ErrorCode RevalidateFile(const files file_type, const filesystem::path& file_p);
+ErrorCode CommitFile(const filesystem::path& file_p, const string& data);
+void BeginGroupCommit();
+ErrorCode EndGroupCommit(size_t* synced = NULL, vector<filesystem::path>* written = NULL);
+ErrorCode ReadFileData(const filesystem::path& file_p, string& data);
+ErrorCode WriteFileAt(const filesystem::path& file_p, const uint64_t offset, const void* data, const size_t size);
+ErrorCode ValidateData(const files file_type, const string& file_data, string& fixed_data, bool& fix, const bool temp_file = 0);
+ErrorCode FoodsBinDataCheck(const string& file_data);
+bool MigrateFoodsBinData(string& file_data);
+ErrorCode HashFile(const filesystem::path& file_p, uint64_t& hash);
+uint64_t HashData(const char* data, const size_t size, const uint64_t hash = FNV_OFFSET);
 ErrorCode RestoreTempFile(const filesystem::path& file_p);
 ErrorCode UsersDataCheck();
 ErrorCode DayDataCheck(const filesystem::path& day_p);
 ErrorCode UserFoodsDatCheck(const filesystem::path& usrfd_p);
+ErrorCode UserFoodsBinCheck(const filesystem::path& usrfb_p);
+ErrorCode UserFoodsCheck(const string& username);
+ErrorCode ReadFoodsBin(const filesystem::path& usrfb_p, vector<s_food_record>& records, s_foods_bin_header* header = NULL);
+ErrorCode WriteFoodsBin(const filesystem::path& usrfb_p, const vector<s_food_record>& records);
 ErrorCode SafeDeleteFile(const filesystem::path& file_p);
 ErrorCode SafeDeleteFolder(const filesystem::path& file_p);
 filesystem::path GetDateDataPath(const string& username, const date::s_date& date_data);
+filesystem::path GetYearDataPath(const string& username, const int year);
+ErrorCode YearBinDataCheck(const string& file_data, const int year, vector<double>* columns = NULL, const bool verified = 0);
+ErrorCode ReadYearBin(const filesystem::path& year_p, const int year, vector<double>& columns);
+ErrorCode CompactYear(const string& username, const int year);
+ErrorCode CompactPastYears(const string& username, size_t* compacted = NULL);
+bool IsYearFileName(const string& file_name, const string& suffix, int* year = NULL);
+filesystem::path GetYearMapPath(const string& username, const int year);
+ErrorCode YearMapDataCheck(const string& file_data, const int year, year_map* days = NULL);
+ErrorCode ReadYearMap(const string& username, const int year, year_map& days);
+ErrorCode WriteYearMap(const string& username, const int year, const year_map& days);
+ErrorCode SetYearMapDay(const string& username, const date::s_date& date_data, const bool present);
+ErrorCode RebuildYearMap(const string& username, const int year);
 #pragma endregion
 }
+#endif
\ No newline at end of file
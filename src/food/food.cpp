@@ -1,34 +1,349 @@
 #include <filesystem>
 namespace fs = std::filesystem;
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
 #include "food.h"
 #include "../io/io_fb.h"
 using namespace io_fb;
 #include "../filemanager/filemanager.h"
+#include "../events/events.h"
+#include "../nutrients/nutrients.h"
+#include "../latency/latency.h"
 namespace fm = filemanager;
 
 static date::calendar c_calendar;
 
+#pragma region Internal Use Functions
+/**
+ * @brief Parse a food data string ("{name/nutrients.../portion}|") into a binary food record. Foods written under an older nutrient schema (fewer nutrients) get the missing ones as 0.
+ * @param food_data Food data string. Brackets and '|' separator are optional.
+ * @param record Record to fill. It is zeroed first, and set alive.
+ * @returns 1(true) if data could be parsed, 0(false) if it couldn't.
+**/
+bool FoodDataToRecord(const string& food_data, fm::s_food_record& record){
+    //Remove separator and brackets
+    string data = food_data;
+    if (data.ends_with('|')){
+        data.pop_back();
+    }
+    if (data.starts_with('{')){
+        strings::RemoveBrackets(data);
+    }
+    //Get food name
+    memset(&record, 0, sizeof(record));
+    string f_name = data.substr(0, data.find_first_of('/'));
+    if (f_name.empty() || f_name.size() >= MAX_FOOD_NAME || data.find_first_of('/') == string::npos){
+        return 0;
+    }
+    memcpy(record.name, f_name.data(), f_name.size());
+    record.alive = 1;
+    data.erase(0, data.find_first_of('/') + 1);
+    //Get nutrients and portion (last value)
+    size_t values = count(data.begin(), data.end(), '/') + 1;
+    if (values < NUM_OF_MACROS + 1 || values > FOODS_BIN_VALUES){
+        return 0;
+    }
+    for (size_t i = 0; i < values; i++){
+        string value = data.substr(0, data.find_first_of('/'));
+        if (!strings::IsNumericStr(value, Mode_Double)){
+            return 0;
+        }
+        record.macros[i + 1 == values ? PORTION_INDEX : i] = stod(value);
+        data.erase(0, value.size() + 1);
+    }
+    return 1;
+}
+/**
+ * @brief Transform a binary food record into a food data string ready to dump into user_foods.dat.
+ * @param record Record to transform.
+ * @returns Formatted food data string.
+**/
+string RecordToFoodData(const fm::s_food_record& record){
+    string data = record.name;
+    for (uint8_t i = 0; i < nutrients::Count(); i++){
+        data += '/' + to_string(record.macros[i]);
+    }
+    data += '/' + to_string((unsigned long)record.macros[PORTION_INDEX]);
+    return strings::DataToFile(data);
+}
+/**
+ * @brief Binary search a food inside user_foods.bin. Only the header and log2(n) records are read.
+ * @param foodsbin Path to user_foods.bin.
+ * @param food In-file food name to search.
+ * @param header Returns the catalog header.
+ * @param index Returns the record index if found, or the index where it should be inserted if not.
+ * @param record Returns the found record (which may be a tombstone).
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_FileCorrupted; EC_ItemFound; EC_ItemNotFound;
+**/
+ErrorCode BinSearchFood(const fs::path& foodsbin, const string& food, fm::s_foods_bin_header& header, uint32_t& index, fm::s_food_record& record){
+    //Open catalog
+    ifstream data_in;
+    data_in.open(foodsbin, ios_base::binary);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    //Read and check header
+    if (!data_in.read((char*)&header, sizeof(header)) || memcmp(header.magic, FOODS_BIN_MAGIC, 4) != 0 || header.values != FOODS_BIN_VALUES){
+        return EC_FileCorrupted;
+    }
+    //Binary search
+    uint32_t low = 0, high = header.records;
+    while (low < high){
+        uint32_t mid = low + (high - low) / 2;
+        data_in.seekg(sizeof(header) + (uint64_t)mid * sizeof(fm::s_food_record));
+        if (!data_in.read((char*)&record, sizeof(record))){
+            return EC_FileCorrupted;
+        }
+        record.name[MAX_FOOD_NAME - 1] = '\0';
+        int cmp = strcmp(record.name, food.c_str());
+        //Found it
+        if (cmp == 0){
+            index = mid;
+            return EC_ItemFound;
+        }
+        //Search upper half
+        else if (cmp < 0){
+            low = mid + 1;
+        }
+        //Search lower half
+        else {
+            high = mid;
+        }
+    }
+    //Not found, return insertion point
+    index = low;
+    return EC_ItemNotFound;
+}
+/**
+ * @brief Get file offset of a record inside user_foods.bin.
+ * @param index Record index.
+ * @returns Byte offset of the record.
+**/
+uint64_t RecordOffset(const uint32_t index){
+    return sizeof(fm::s_foods_bin_header) + (uint64_t)index * sizeof(fm::s_food_record);
+}
+/**
+ * @brief Sum a day range of a single nutrient column. Values are summed as doubles and rounded to fixed point once; columns hold whole thousandths (day totals), so a year of them sums to the same fixed point total as rounding each day.
+ * @param column First value of the column (day 0).
+ * @param first_day First day to sum.
+ * @param last_day Last day to sum (included).
+ * @returns Fixed point sum.
+**/
+fixed_t SumColumn(const double* column, const uint16_t first_day, const uint16_t last_day){
+    double sum = 0;
+    for (uint16_t d = first_day; d <= last_day; d++){
+        sum += column[d];
+    }
+    return fixed_point::FromDouble(sum);
+}
+/**
+ * @brief Sum macros of a day range from the nutrient columns of a compacted year file.
+ * @param columns Nutrient columns (see fm::ReadYearBin()). If empty, macros are 0.
+ * @param first_day First day of the year to sum (0 based, see date::GetYearDay()).
+ * @param last_day Last day of the year to sum (included).
+ * @param macros Set that will contain the summed macros.
+**/
+void SumCompactedColumns(const vector<double>& columns, const uint16_t first_day, const uint16_t last_day, macro_totals& macros){
+    macros.Clear();
+    if (columns.empty()){
+        return;
+    }
+    uint16_t end_day = min<uint16_t>(last_day, YEAR_BIN_DAYS - 1);
+    for (uint8_t m = 0; m < nutrients::Count(); m++){
+        macros[m] = SumColumn(columns.data() + (size_t)m * YEAR_BIN_DAYS, first_day, end_day);
+    }
+    return;
+}
+/**
+ * @brief Sum macros of a day range from a compacted year file.
+ * @param username Name of the user to search.
+ * @param year Target year.
+ * @param first_day First day of the year to sum (0 based, see date::GetYearDay()).
+ * @param last_day Last day of the year to sum (included).
+ * @param macros Set that will contain the summed macros.
+ * @returns Possible ErrorCodes: EC_FileNotFound; EC_None;
+ * @returns [OR] ErrorCodes thrown by fm::ReadYearBin();
+**/
+ErrorCode GetCompactedMacros(const string& username, const int year, const uint16_t first_day, const uint16_t last_day, macro_totals& macros){
+    //Check if year is compacted
+    fs::path year_p = fm::GetYearDataPath(username, year);
+    if (!fs::exists(year_p)){
+        return EC_FileNotFound;
+    }
+    //Read columns
+    vector<double> columns;
+    ErrorCode ec = fm::ReadYearBin(year_p, year, columns);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Sum every nutrient column over the range
+    SumCompactedColumns(columns, first_day, last_day, macros);
+    return EC_None;
+}
+/**
+ * @brief Get macros for the given date and user (see food::GetDateMacros()). Days without a day file are read from the compacted year file, or from its columns if the caller already read them.
+ * @param username Name of the user to search.
+ * @param macros Set to store found macros (fixed point, see FIXED_SCALE).
+ * @param date_data Struct of date::s_date type.
+ * @param columns Nutrient columns of the compacted year file of that date (empty if there is none), or NULL to read them if needed.
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_FileCorrupted (file changed after validation); EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: fm::DayDataCheck(); fm::ReadYearBin();
+**/
+ErrorCode ReadDateMacros(const string& username, macro_totals& macros, const date::s_date& date_data, const vector<double>* columns){
+    latency::phase_scope phase(latency::PH_Parse);
+    //Clear macros
+    macros.Clear();
+    //Get path to data
+    fs::path data_p = fm::GetDateDataPath(username, date_data);
+    //Validate file
+    ErrorCode ec = fm::DayDataCheck(data_p);
+    //If file is not found, look for it in the compacted year file. If not there either, set all macros to 0 and return.
+    if (ec == EC_FileNotFound){
+        uint16_t year_day = date::GetYearDay(date_data.year, date_data.month, date_data.month_day);
+        if (columns != NULL){
+            SumCompactedColumns(*columns, year_day, year_day, macros);
+            return EC_None;
+        }
+        ec = GetCompactedMacros(username, date_data.year, year_day, year_day, macros);
+        if (ec == EC_FileNotFound){
+            return EC_None;
+        }
+        return ec;
+    }
+    //If there was a problem, return error.
+    else if (ec != EC_None){
+        return ec;
+    }
+    //Open data file
+    ifstream data_in;
+    data_in.open(data_p);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    //Get data. Days written under an older schema lack the last nutrients, which stay 0.
+    string data;
+    for (uint8_t i = 0; i < nutrients::Count() && getline(data_in, data, '|'); i++){
+        //Remove brackets
+        strings::RemoveBrackets(data);
+        //Parse exactly and insert data
+        if (!fixed_point::FromStr(data, macros[i])){
+            macros.Clear();
+            return EC_FileCorrupted;
+        }
+    }
+    //Close and return
+    data_in.close();
+    return EC_None;
+}
+/**
+ * @brief Checks if a whole year can be read from its compacted year file (year file exists and no day files are left for that year).
+ * @param username Name of the user to search.
+ * @param year Target year.
+ * @returns 1(true) if the year is only stored compacted, 0(false) if not.
+**/
+bool IsYearCompacted(const string& username, const int year){
+    fs::path year_f = user_folder(username);
+    year_f.append(to_string(year));
+    return !fs::exists(year_f) && fs::exists(fm::GetYearDataPath(username, year));
+}
+/**
+ * @brief Sum macros of a day range inside a single year. Compacted years are summed from their columns, else only days set in the year presence map are read.
+ * @param username Name of the user to search.
+ * @param year Target year.
+ * @param first_day First day of the year to sum (0 based, see date::GetYearDay()).
+ * @param last_day Last day of the year to sum (included).
+ * @param macros Set that will contain the summed macros.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: GetCompactedMacros(); fm::ReadYearMap(); fm::RebuildYearMap(); fm::ReadYearBin(); ReadDateMacros();
+**/
+ErrorCode SumYearDays(const string& username, const int year, const uint16_t first_day, const uint16_t last_day, macro_totals& macros){
+    macros.Clear();
+    //If year is compacted, sum its columns.
+    if (IsYearCompacted(username, year)){
+        return GetCompactedMacros(username, year, first_day, last_day, macros);
+    }
+    //Get days with data
+    fm::year_map days;
+    ErrorCode ec = fm::ReadYearMap(username, year, days);
+    //If map is missing or corrupted, rebuild it from the year data and read it again.
+    if (ec == EC_FileNotFound || ec == EC_FileCorrupted){
+        ec = fm::RebuildYearMap(username, year);
+        if (ec != EC_None){
+            return ec;
+        }
+        ec = fm::ReadYearMap(username, year, days);
+        //Still no map, the year has no data.
+        if (ec == EC_FileNotFound){
+            return EC_None;
+        }
+    }
+    if (ec != EC_None){
+        return ec;
+    }
+    //Read and verify the compacted year file once, if any (days without a day file are read from its columns).
+    vector<double> columns;
+    fs::path year_p = fm::GetYearDataPath(username, year);
+    if (fs::exists(year_p)){
+        ec = fm::ReadYearBin(year_p, year, columns);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Sum every day with data
+    macro_totals t_macros;
+    date::s_date date_data;
+    for (uint16_t d = first_day; d <= last_day && d < YEAR_BIN_DAYS; d++){
+        if (!days[d]){
+            continue;
+        }
+        date::YearDayToDate(year, d, date_data);
+        ec = ReadDateMacros(username, t_macros, date_data, &columns);
+        if (ec != EC_None){
+            macros.Clear();
+            return ec;
+        }
+        macros += t_macros;
+    }
+    return EC_None;
+}
+#pragma endregion
+
 #pragma region Food
 /**
- * @brief Prints all foods inside user_foods.dat and retrives them inside a string vector.
+ * @brief Retrieves all food names inside the user food catalog, in catalog order.
  * @param usr User to read foods from.
- * @param foods Vector that will contain all found food names. Mandatory.
+ * @param foods Vector that will contain all found food names (in-file names). It will be cleared.
  * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_None;
- * @returns [OR] ErrorCodes thrown by filemanager::UserFoodsDatCheck();
- * @warning This function DOES validate user_foods.dat.
+ * @returns [OR] ErrorCodes thrown by any of these functions: filemanager::UserFoodsCheck(); filemanager::ReadFoodsBin();
+ * @warning This function DOES validate the user food catalog.
 **/
-ErrorCode food::PrintFoodList(const string& usr, vector<string>& foods){
-    //Validate user_foods.dat
-    fs::path foods_p = foods_dat(usr);
-    ErrorCode ec = fm::UserFoodsDatCheck(foods_p);
-    //If there was a problem, return error.
+ErrorCode food::GetFoodNames(const string& usr, vector<string>& foods){
+    latency::phase_scope phase(latency::PH_Parse);
+    foods.clear();
+    //Validate food catalog
+    ErrorCode ec = fm::UserFoodsCheck(usr);
     if (ec != EC_None){
         return ec;
     }
+    //If catalog is binary, get alive records.
+    if (IsCatalogBinary(usr)){
+        vector<fm::s_food_record> records;
+        ec = fm::ReadFoodsBin(foods_bin(usr), records);
+        if (ec != EC_None){
+            return ec;
+        }
+        for (fm::s_food_record& r : records){
+            if (r.alive){
+                foods.push_back(r.name);
+            }
+        }
+        return EC_None;
+    }
     //Open foods.dat
     ifstream data_in;
-    data_in.open(foods_p);
+    data_in.open(foods_dat(usr));
     if (!data_in.is_open()){
         return EC_FileReadNoPerm;
     }
@@ -39,28 +354,116 @@ ErrorCode food::PrintFoodList(const string& usr, vector<string>& foods){
         if (!data_in.eof()){
             //Remove brackets
             strings::RemoveBrackets(food);
-            //Get food name
-            food = food.substr(0,food.find_first_of('/'));
-            //Save food
-            foods.push_back(food);
-            //Print food
-            cout << '[' << to_string(foods.size()) << ']'; 
-            cout << name::InFileNameToName(food,1) << '\n';
+            //Get food name and save it
+            foods.push_back(food.substr(0,food.find_first_of('/')));
         }
     }
     data_in.close();
     return EC_None;
 }
+/**
+ * @brief Read one page of food names from the user food catalog, starting at the cursor. Only the entries of that page are read (plus the tombstones right after it, on binary catalogs).
+ * @param usr User to read foods from.
+ * @param cursor Catalog position to read from. It is moved past the read page, and its end flag is set if no foods are left.
+ * @param count Maximum amount of names to read.
+ * @param foods Vector that will contain the page food names (in-file names). It will be cleared.
+ * @returns Possible ErrorCodes: EC_FileNotFound; EC_FileReadNoPerm; EC_FileCorrupted; EC_None;
+ * @warning This function does NOT validate the catalog, which is validated at boot and always replaced atomically.
+**/
+ErrorCode food::GetFoodPage(const string& usr, s_food_cursor& cursor, const size_t count, vector<string>& foods){
+    latency::phase_scope phase(latency::PH_Parse);
+    foods.clear();
+    //If catalog is binary, read records from the cursor index.
+    if (IsCatalogBinary(usr)){
+        ifstream data_in;
+        data_in.open(foods_bin(usr), ios_base::binary);
+        if (!data_in.is_open()){
+            return EC_FileReadNoPerm;
+        }
+        //Read and check header
+        fm::s_foods_bin_header header;
+        if (!data_in.read((char*)&header, sizeof(header)) || memcmp(header.magic, FOODS_BIN_MAGIC, 4) != 0 || header.values != FOODS_BIN_VALUES){
+            return EC_FileCorrupted;
+        }
+        //Read alive records until the page is full, then skip tombstones to find out if there is a next page.
+        uint64_t i = cursor.offset;
+        data_in.seekg(RecordOffset(i));
+        fm::s_food_record record;
+        while (i < header.records){
+            if (!data_in.read((char*)&record, sizeof(record))){
+                return EC_FileCorrupted;
+            }
+            if (record.alive){
+                if (foods.size() == count){
+                    break;
+                }
+                record.name[MAX_FOOD_NAME - 1] = '\0';
+                foods.push_back(record.name);
+            }
+            i++;
+        }
+        cursor.offset = i;
+        cursor.end = i >= header.records;
+        return EC_None;
+    }
+    //Open foods.dat
+    fs::path foodsdat = foods_dat(usr);
+    if (!fs::exists(foodsdat)){
+        return EC_FileNotFound;
+    }
+    ifstream data_in;
+    data_in.open(foodsdat, ios_base::binary);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    //Read foods from cursor offset
+    data_in.seekg(cursor.offset);
+    string food;
+    while (foods.size() < count && getline(data_in, food, '|')){
+        //Remove brackets
+        strings::RemoveBrackets(food);
+        //Get food name and save it
+        foods.push_back(food.substr(0,food.find_first_of('/')));
+    }
+    //Move cursor
+    if (data_in.eof()){
+        cursor.end = 1;
+    }
+    else {
+        cursor.offset = data_in.tellg();
+        cursor.end = data_in.peek() == char_traits<char>::eof();
+    }
+    data_in.close();
+    return EC_None;
+}
 /**
  * @brief Get food macros for the given food.
  * @param usr User to target.
  * @param food Food to remove (food name).
- * @param macros Vector of doubles to store macros. It will be cleared and resized accordingly.
- * @returns Possible ErrorCodes: EC_ItemNotFound; EC_FileReadNoPerm; EC_None;
- * @returns [OR] ErrorCodes thrown by any of this functions: fm::UserFoodsDatCheck();
+ * @param macros Set to store macros per gram, plus portion size.
+ * @returns Possible ErrorCodes: EC_ItemNotFound; EC_FileReadNoPerm; EC_FileCorrupted; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: fm::UserFoodsDatCheck(); BinSearchFood();
  * @warning food string must be an in-file name.
 **/
-ErrorCode food::GetFoodData(const string& usr, const string& food, vector<double>& macros){
+ErrorCode food::GetFoodData(const string& usr, const string& food, food_macros& macros){
+    latency::phase_scope phase(latency::PH_Parse);
+    //If catalog is binary, binary search the food.
+    if (IsCatalogBinary(usr)){
+        fm::s_foods_bin_header header;
+        fm::s_food_record record;
+        uint32_t index;
+        ErrorCode ec = BinSearchFood(foods_bin(usr), food, header, index, record);
+        if (ec == EC_ItemNotFound || (ec == EC_ItemFound && !record.alive)){
+            return EC_ItemNotFound;
+        }
+        else if (ec != EC_ItemFound){
+            return ec;
+        }
+        for (uint8_t i = 0; i < FOODS_BIN_VALUES; i++){
+            macros[i] = record.macros[i];
+        }
+        return EC_None;
+    }
     //Validate user_foods.dat
     fs::path foodsdat = foods_dat(usr);
     ErrorCode ec = fm::UserFoodsDatCheck(foodsdat);
@@ -79,20 +482,14 @@ ErrorCode food::GetFoodData(const string& usr, const string& food, vector<double
         //Remove brackets
         strings::RemoveBrackets(data);
         //If string starts with food name, we found it.
-        if (data.starts_with(food)){
-            //Prepare macros vector
-            macros.clear();
-            macros.resize(NUM_OF_MACROS + 1); //Get macros + portion size
-            //Remove food name and name separator from data.
-            data.erase(0,data.find_first_of('/') + 1);
+        if (data.starts_with(food + '/')){
             //Extract food data
-            for (uint8_t i = 0; i < NUM_OF_MACROS + 1; i++){
-                //Get macro value
-                macros[i] = stod(data.substr(0, data.find_first_of('/')));
-                //Remove macro from data if not at last index
-                if (i + 1 < NUM_OF_MACROS + 1){
-                    data.erase(0, data.find_first_of('/') + 1);
-                }
+            fm::s_food_record record;
+            if (!FoodDataToRecord(data, record)){
+                return EC_FileCorrupted;
+            }
+            for (uint8_t i = 0; i < FOODS_BIN_VALUES; i++){
+                macros[i] = record.macros[i];
             }
             //Macros have been saved, close file and return.
             data_in.close();
@@ -111,6 +508,18 @@ ErrorCode food::GetFoodData(const string& usr, const string& food, vector<double
  * @warning usr_foods.dat is not validated in this function. Make sure to do it before calling it.
 **/
 ErrorCode food::IsFoodRegistered(const string& usr, const string& food){
+    latency::phase_scope phase(latency::PH_Parse);
+    //If catalog is binary, binary search the food.
+    if (IsCatalogBinary(usr)){
+        fm::s_foods_bin_header header;
+        fm::s_food_record record;
+        uint32_t index;
+        ErrorCode ec = BinSearchFood(foods_bin(usr), food, header, index, record);
+        if (ec == EC_ItemFound && !record.alive){
+            return EC_ItemNotFound;
+        }
+        return ec;
+    }
     //Open food data, exit if read is forbidden.
     fs::path foodsdat = foods_dat(usr);
     ifstream data_in;
@@ -137,114 +546,179 @@ ErrorCode food::IsFoodRegistered(const string& usr, const string& food){
     return EC_ItemNotFound;
 }
 /**
- * @brief Adds macros to the current day.
+ * @brief Build an eat: today's date, the event to log and the eaten nutrients. Nothing is written (see CommitEat()).
  * @param usr User to target.
- * @param food Food to add macros from (food to eat).
+ * @param food Food to eat (in-file name).
  * @param amount Amount of food to eat, specified in portions or grams (see boolean).
  * @param portions_or_grams Choose the counting option. 0 for portions, 1 for grams. Portions will multiply the food macros by the stored portion size times amount of portions. Grams will multiply macros by amount of grams.
- * @warning This function does NOT directly check if usr_foods.dat is valid or if food is registered. This is done by calling GetFoodData(). If you wish to modify this function, keep that in mind. Food string must be an in-file name.
- * @returns Possible ErrorCodes: EC_FileWriteNoPerm; EC_FileReadNoPerm; EC_None;
- * @returns [OR] ErrorCodes thrown by any of these functions: GetFoodData(); fm::DayDataCheck(); (fm::CreateTempFile(); fm::SafeDeleteFile();
+ * @param eat Struct that will contain the eat.
+ * @warning This function does NOT directly check if usr_foods.dat is valid or if food is registered. This is done by calling GetFoodData().
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by GetFoodData();
 **/
-ErrorCode food::InternalEatFood(const string& usr, const string& food, unsigned long& amount, bool portions_or_grams){
+ErrorCode food::PrepareEat(const string& usr, const string& food, const unsigned long amount, const bool portions_or_grams, s_eat& eat){
     //Try to get food data
-    vector<double> macros;
+    food_macros macros;
     ErrorCode ec = GetFoodData(usr,food,macros);
     if (ec != EC_None){
         return ec;
     }
-    //If portion count is chosen, multiply every macro by the amount of portions.
-    if (portions_or_grams){
-        for (double &macro : macros){
-           macro *= (macros[NUM_OF_MACROS] * (double)amount);
-        }
-    }
-    //Else mutiply every macro by the amount of grams
-    else {
-        for (double &macro : macros){
-            macro *= (double)amount;
-        }
+    //If portion count is chosen, multiply every macro by the amount of portions. Else mutiply every macro by the amount of grams.
+    macros *= portions_or_grams ? macros[PORTION_INDEX] * (double)amount : (double)amount;
+    //Build event with the eaten macros
+    memset(&eat.event, 0, sizeof(eat.event));
+    eat.event.timestamp = chrono::system_clock::to_time_t(chrono::system_clock::now());
+    strncpy(eat.event.food, food.c_str(), MAX_FOOD_NAME - 1);
+    eat.event.portions = portions_or_grams;
+    eat.event.amount = amount;
+    //Eaten nutrients are kept in fixed point, so repeated sums stay exact.
+    eat.nutrients.Clear();
+    for (uint8_t i = 0; i < nutrients::Count(); i++){
+        eat.event.macros[i] = macros[i];
+        eat.nutrients[i] = fixed_point::FromDouble(macros[i]);
     }
     //Refresh date and get today date.
     c_calendar.RefreshDate();
-    date::s_date t_date;
-    c_calendar.PassDateToStruct(t_date);
-    //Get data file for today
-    fs::path daydat = fm::GetDateDataPath(usr, t_date);
-    //If daily data does not exists, create it.
-    ofstream data_out;
-    if (!fs::exists(daydat)){
-        //Create file.
-        data_out.open(daydat);
-        if (!data_out.is_open()){
-            return EC_FileWriteNoPerm;
-        }
-        for (uint8_t m = 0; m < NUM_OF_MACROS; m++){
-            data_out << "{0.0}|";
-        }
-        data_out.close();
-    }
-    //Else, validate it.
-    else {
+    c_calendar.PassDateToStruct(eat.day);
+    return EC_None;
+}
+/**
+ * @brief Adds an eat (see PrepareEat()) to its day: day totals, year presence map and event log. Safe to call from a thread other than the one that prepared the eat.
+ * @param usr User to target.
+ * @param eat Eat to add.
+ * @param day_totals Optional pointer to return the new totals of that day.
+ * @returns ErrorCodes thrown by CommitEats();
+**/
+ErrorCode food::CommitEat(const string& usr, const s_eat& eat, macro_totals* day_totals){
+    return CommitEats(usr, &eat, 1, day_totals);
+}
+/**
+ * @brief Adds several eats of the same day at once: the day file is read and replaced once, and the events are logged with a single write. Safe to call from a thread other than the one that prepared the eats.
+ * @param usr User to target.
+ * @param eats Eats to add, in the order they were eaten.
+ * @param count Amount of eats.
+ * @param day_totals Optional pointer to return the new totals of that day.
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_FileCorrupted; EC_DirCreateNoPerm; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: fm::DayDataCheck(); fm::CommitFile(); fm::SetYearMapDay(); events::AppendEvents();
+ * @warning Every eat must belong to the day of the first one.
+**/
+ErrorCode food::CommitEats(const string& usr, const s_eat* eats, const size_t count, macro_totals* day_totals){
+    if (count == 0){
+        return EC_None;
+    }
+    //Get data file for the eat day
+    const date::s_date& day = eats[0].day;
+    fs::path daydat = fm::GetDateDataPath(usr, day);
+    //Add every eat
+    macro_totals totals;
+    vector<events::s_event> day_events(count);
+    for (size_t i = 0; i < count; i++){
+        totals += eats[i].nutrients;
+        day_events[i] = eats[i].event;
+    }
+    //If daily data exists, validate it and add current macros to the food macros.
+    ErrorCode ec;
+    if (fs::exists(daydat)){
         ec = fm::DayDataCheck(daydat);
         if (ec != EC_None){
             return ec;
         }
+        //Open today data file
+        ifstream data_in;
+        data_in.open(daydat);
+        if (!data_in.is_open()){
+            return EC_FileReadNoPerm;
+        }
+        //Get current macros and add them with the food macros. Skip portion size. Days written under an older schema lack the last nutrients.
+        string data;
+        fixed_t value;
+        for (uint8_t i = 0; i < nutrients::Count() && getline(data_in, data, '|'); i++){
+            strings::RemoveBrackets(data);
+            if (!fixed_point::FromStr(data, value)){
+                return EC_FileCorrupted;
+            }
+            totals[i] += value;
+        }
+        data_in.close();
     }
-    //Open today data file
-    ifstream data_in;
-    data_in.open(daydat);
-    if (!data_in.is_open()){
-        return EC_FileReadNoPerm;
+    //Else, this is the first eat of the day. Create folder structure.
+    else if (!fs::exists(daydat.parent_path())){
+        error_code f_ec;
+        if (!fs::create_directories(daydat.parent_path(), f_ec)){
+            return EC_DirCreateNoPerm;
+        }
     }
-    //Get current macros and add them with the food macros. Skip portion size.
-    string data;
-    for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-        getline(data_in, data, '|');
-        strings::RemoveBrackets(data);
-        macros[i] += stod(data);
+    //Build new day data, skipping portion size.
+    string day_data;
+    for (uint8_t i = 0; i < nutrients::Count(); i++){
+        day_data += strings::DataToFile(fixed_point::ToStr(totals[i]));
     }
-    data_in.close();
-    //Create temp file
-    fs::path tmp_daydat;
-    ec = fm::CreateTempFile(daydat, tmp_daydat);
+    //Commit day data
+    ec = fm::CommitFile(daydat, day_data);
     if (ec != EC_None){
         return ec;
     }
-    //Open temp file (read)
-    data_in.open(tmp_daydat);
-    if (!data_in.is_open()){
-        return EC_FileReadNoPerm;
-    }
-    //Open original file (write)
-    data_out.open(daydat);
-    if (!data_out.is_open()){
-        return EC_FileWriteNoPerm;
+    //Mark day in year presence map
+    ec = fm::SetYearMapDay(usr, day, 1);
+    if (ec != EC_None){
+        return ec;
     }
-    //Insert added macros, skipping portion size and _END_ termination.
-    for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-        data_out << strings::DataToFile(to_string(macros[i]));
+    //Return totals if asked
+    if (day_totals != NULL){
+        *day_totals = totals;
     }
-    //Close files
-    data_in.close();
-    data_out.close();
-    //Remove temp file
-    ec = fm::SafeDeleteFile(tmp_daydat);
+    //Log events and return
+    return events::AppendEvents(usr, day, day_events.data(), count);
+}
+/**
+ * @brief Adds macros to the current day.
+ * @param usr User to target.
+ * @param food Food to add macros from (food to eat).
+ * @param amount Amount of food to eat, specified in portions or grams (see boolean).
+ * @param portions_or_grams Choose the counting option. 0 for portions, 1 for grams. Portions will multiply the food macros by the stored portion size times amount of portions. Grams will multiply macros by amount of grams.
+ * @param day Optional pointer to return the date the food was added to.
+ * @param day_totals Optional pointer to return the new totals of that day.
+ * @warning This function does NOT directly check if usr_foods.dat is valid or if food is registered. This is done by calling GetFoodData(). If you wish to modify this function, keep that in mind. Food string must be an in-file name.
+ * @returns ErrorCodes thrown by any of these functions: PrepareEat(); CommitEat();
+**/
+ErrorCode food::InternalEatFood(const string& usr, const string& food, unsigned long& amount, bool portions_or_grams, date::s_date* day, macro_totals* day_totals){
+    //Build eat
+    s_eat eat;
+    ErrorCode ec = PrepareEat(usr, food, amount, portions_or_grams, eat);
     if (ec != EC_None){
         return ec;
     }
-    //Return
-    return EC_None;
+    //Return day if asked
+    if (day != NULL){
+        *day = eat.day;
+    }
+    //Write it
+    return CommitEat(usr, eat, day_totals);
 }
 /**
  * @brief Removes food from user database.
  * @param usr User to target.
  * @param food Food to remove (food name).
- * @returns Possible ErrorCodes: EC_ItemNotFound; EC_FileReadNoPerm; EC_FileWriteNoPerm; EC_None;
- * @returns [OR] ErrorCodes thrown by any of these functions: fm::UserFoodsDatCheck(); fm::CreateTempFile(); fm::SafeDeleteFile(); IsFoodRegistered();
+ * @returns Possible ErrorCodes: EC_ItemNotFound; EC_FileReadNoPerm; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: fm::UserFoodsDatCheck(); fm::CommitFile(); IsFoodRegistered(); fm::ReadFoodsBin(); fm::WriteFoodsBin();
  * @warning food string must be an in-file name.
 **/
 ErrorCode food::InternalRemoveFood(const string& usr, const string& food){
+    //If catalog is binary, drop the record and rewrite the catalog (a single atomic commit, so the header always matches the records).
+    if (IsCatalogBinary(usr)){
+        fs::path foodsbin = foods_bin(usr);
+        vector<fm::s_food_record> records;
+        ErrorCode ec = fm::ReadFoodsBin(foodsbin, records);
+        if (ec != EC_None){
+            return ec;
+        }
+        vector<fm::s_food_record>::iterator it = lower_bound(records.begin(), records.end(), food, [](const fm::s_food_record& a, const string& b){ return strcmp(a.name, b.c_str()) < 0; });
+        if (it == records.end() || it->name != food || !it->alive){
+            return EC_ItemNotFound;
+        }
+        it->alive = 0;
+        return fm::WriteFoodsBin(foodsbin, records);
+    }
     //Validate user_foods.dat
     fs::path foodsdat = foods_dat(usr);
     ErrorCode ec = fm::UserFoodsDatCheck(foodsdat);
@@ -259,425 +733,406 @@ ErrorCode food::InternalRemoveFood(const string& usr, const string& food){
     else if (ec != EC_ItemFound){
         return ec;
     }
-    //Create temp file
-    fs::path tmp_foodsdat;
-    ec = fm::CreateTempFile(foodsdat, tmp_foodsdat);
-    if (ec != EC_None){
-        return ec;
-    }
-    //Open temp file (read)
+    //Open foods data (read)
     ifstream data_in;
-    data_in.open(tmp_foodsdat);
+    data_in.open(foodsdat);
     if (!data_in.is_open()){
         return EC_FileReadNoPerm;
     }
-    //Open original file (write)
-    ofstream data_out;
-    data_out.open(foodsdat);
-    if (!data_out.is_open()){
-        data_in.close();
-        return EC_FileWriteNoPerm;
-    }
-    //Dump data skipping selected food
-    string data;
+    //Gather data skipping selected food
+    string data, foods_data;
     while(getline(data_in, data, '|')){
-        //If not at the _END_ line
-        if (data != "_END_"){
-            //Remove brackets from data
-            strings::RemoveBrackets(data);
-            //If not at the wanted food line, restore it. Else, just skip it.
-            if (!data.starts_with(food)){
-                data_out << strings::DataToFile(data);
-            }
+        //Remove brackets from data
+        strings::RemoveBrackets(data);
+        //If not at the wanted food line, keep it. Else, just skip it.
+        if (data.substr(0, data.find_first_of('/')) != food){
+            foods_data += strings::DataToFile(data);
         }
     }
-    //Close files
     data_in.close();
-    data_out.close();
-    //Remove temp file
-    ec = fm::SafeDeleteFile(tmp_foodsdat);
-    if (ec != EC_None){
-        return ec;
-    }
-    //Return
-    return EC_None;
+    //Commit foods data and return
+    return fm::CommitFile(foodsdat, foods_data);
 }
 /**
  * @brief Modify food macros in user database.
  * @param usr User to target.
  * @param food_data Food data string to insert.
- * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_FileWriteNoPerm; EC_None;
- * @returns [OR] ErrorCodes thrown by any of these functions: fm::UserFoodsDatCheck(); fm::CreateTempFile(); fm::SafeDeleteFile();
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: fm::UserFoodsDatCheck(); fm::CommitFile(); BinSearchFood(); fm::WriteFileAt();
  * @warning food_data string should come correctly formatted into a generic data string.
  * @exception Possible exceptions if data is manipulated after the file is validated.
 **/
 ErrorCode food::InternalModifyFood(const string& usr, const string& food_data){
+    //If catalog is binary, overwrite the record in place.
+    if (IsCatalogBinary(usr)){
+        fs::path foodsbin = foods_bin(usr);
+        fm::s_food_record new_record;
+        if (!FoodDataToRecord(food_data, new_record)){
+            return EC_FileCorrupted;
+        }
+        fm::s_foods_bin_header header;
+        fm::s_food_record record;
+        uint32_t index;
+        ErrorCode ec = BinSearchFood(foodsbin, new_record.name, header, index, record);
+        if (ec == EC_ItemNotFound || (ec == EC_ItemFound && !record.alive)){
+            return EC_ItemNotFound;
+        }
+        else if (ec != EC_ItemFound){
+            return ec;
+        }
+        return fm::WriteFileAt(foodsbin, RecordOffset(index), &new_record, sizeof(new_record));
+    }
     fs::path foodsdat = foods_dat(usr);
     //Validate user_foods.dat
     ErrorCode ec = fm::UserFoodsDatCheck(foodsdat);
     if (ec != EC_None){
         return ec;
     }
-    //Create temp file
-    fs::path tmp_foodsdat;
-    ec = fm::CreateTempFile(foodsdat, tmp_foodsdat);
-    if (ec != EC_None){
-        return ec;
-    }
-    //Open original file (write)   
-    ofstream data_out;
-    data_out.open(foodsdat);
-    if (!data_out.is_open()){
-        return EC_FileWriteNoPerm;
-    }
-    //Open temp data (read)
+    //Open foods data (read)
     ifstream data_in;
-    data_in.open(tmp_foodsdat);
+    data_in.open(foodsdat);
     if (!data_in.is_open()){
-        data_out.close();
         return EC_FileReadNoPerm;
     }
     //Copy data and replace food string when found
-    string data, food_name = food_data.substr(1,food_data.find_first_of('/'));
+    string data, foods_data, food_name = food_data.substr(1,food_data.find_first_of('/'));
     while (getline(data_in, data, '|')){
-        //First, make sure we are not at the _END_ line of the temp file.
-        if (data != "_END_"){
-            //Remove brackets
-            strings::RemoveBrackets(data);
-            //If current line starts with the wanted food name, input the new food data.
-            if (data.starts_with(food_name)){
-                data_out << food_data;
-            }
-            //Else, input the original food data.
-            else {
-                data_out << strings::DataToFile(data);
-            }
+        //Remove brackets
+        strings::RemoveBrackets(data);
+        //If current line starts with the wanted food name, input the new food data.
+        if (data.starts_with(food_name)){
+            foods_data += food_data;
+        }
+        //Else, input the original food data.
+        else {
+            foods_data += strings::DataToFile(data);
         }
     }
-    //Close all
     data_in.close();
-    data_out.close();
-    //Remove temp file
-    ec = fm::SafeDeleteFile(tmp_foodsdat);
-    if (ec != EC_None){
-        return ec;
-    }
-    //Return
-    return EC_None;
+    //Commit foods data and return
+    return fm::CommitFile(foodsdat, foods_data);
 }
 /**
  * @brief Register a new food in user_foods.dat.
  * @param usr User to target.
  * @param food_data Food data string to insert.
- * @returns Possible ErrorCodes: EC_FileWriteNoPerm; EC_None;
- * @returns [OR] ErrorCodes thrown by any of these functions: fm::UserFoodsDatCheck(); fm::CreateTempFile(); fm::SafeDeleteFile();
+ * @returns Possible ErrorCodes: EC_ItemFound; EC_FileCorrupted; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: fm::UserFoodsDatCheck(); fm::ReadFileData(); fm::CommitFile(); CommitFoodChanges();
  * @warning food_data string should come correctly formatted into a generic data string.
  * @exception Possible exceptions if data is manipulated after the file is validated.
 **/
 ErrorCode food::InternalRegisterFood(const string& usr, const string& food_data){
+    //If catalog is binary, revive a tombstone or insert the record in order, rewriting the catalog once.
+    if (IsCatalogBinary(usr)){
+        s_food_change change = {0, food_data};
+        return CommitFoodChanges(usr, &change, 1);
+    }
     //Validate user_foods.dat
-    bool file_empty = 0;
     fs::path foods = foods_dat(usr);
-    fs::path* tmp_foods;
     ErrorCode ec = fm::UserFoodsDatCheck(foods);
     //If there was an error, return
     if (ec != EC_None && ec != EC_FileEmpty){
         return ec;
     }
-    //Prepare data_out
-    ofstream data_out;
-    //If file is not empty, create temp file.
+    //If file is not empty, read current foods.
+    string foods_data;
     if (ec != EC_FileEmpty){
-        //Create temp file
-        tmp_foods = new fs::path;
-        ec = fm::CreateTempFile(foods, *tmp_foods);
+        ec = fm::ReadFileData(foods, foods_data);
         if (ec != EC_None){
             return ec;
         }
-        //Open data in app mode
-        data_out.open(foods, ios_base::app);        
     }
-    //Else, skip temp file
-    else {
-        file_empty = 1;
-        //Open data
-        data_out.open(foods); 
-    }
-    //If data is not open, exit with error.
-    if (!data_out.is_open()){
-        if (!file_empty){
-            delete tmp_foods;
-        }
-        return EC_FileWriteNoPerm;
-    }
-    //Input food string
-    data_out << food_data;
-    //Close file.
-    data_out.close();
-    //If temp file was created, remove it.
-    if (!file_empty){
-        ec = fm::SafeDeleteFile(*tmp_foods);
-        delete tmp_foods;
+    //Append food string, commit and return.
+    foods_data += food_data;
+    return fm::CommitFile(foods, foods_data);
+}
+/**
+ * @brief Apply several catalog changes of an user with a single catalog write: the catalog is read once, every change is applied in memory, in order, and the catalog is committed once. A change that can not be applied is skipped; the rest are still written.
+ * @param usr User to target.
+ * @param changes Changes to apply, in queue order.
+ * @param count Amount of changes.
+ * @returns Possible ErrorCodes: EC_ItemFound (food to register is already registered); EC_ItemNotFound (food to modify is not registered); EC_FileCorrupted (bad food data string); EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: fm::UserFoodsDatCheck(); fm::ReadFileData(); fm::CommitFile(); fm::ReadFoodsBin(); fm::WriteFoodsBin();
+ * @warning Like InternalRegisterFood(), it does NOT check if foods to register are already in a text catalog.
+**/
+ErrorCode food::CommitFoodChanges(const string& usr, const s_food_change* changes, const size_t count){
+    ErrorCode first_ec = EC_None;
+    //If catalog is binary, apply changes to the sorted records and rewrite the catalog.
+    if (IsCatalogBinary(usr)){
+        fs::path foodsbin = foods_bin(usr);
+        vector<fm::s_food_record> records;
+        ErrorCode ec = fm::ReadFoodsBin(foodsbin, records);
+        if (ec != EC_None){
+            return ec;
+        }
+        for (size_t i = 0; i < count; i++){
+            fm::s_food_record new_record;
+            if (!FoodDataToRecord(changes[i].food_data, new_record)){
+                first_ec = first_ec == EC_None ? EC_FileCorrupted : first_ec;
+                continue;
+            }
+            //Find food, or the place where it should be inserted.
+            vector<fm::s_food_record>::iterator it = lower_bound(records.begin(), records.end(), new_record, [](const fm::s_food_record& a, const fm::s_food_record& b){ return strcmp(a.name, b.name) < 0; });
+            bool found = it != records.end() && strcmp(it->name, new_record.name) == 0;
+            //Modify: food must be registered.
+            if (changes[i].modify && (!found || !it->alive)){
+                first_ec = first_ec == EC_None ? EC_ItemNotFound : first_ec;
+            }
+            //Register: food must not be registered.
+            else if (!changes[i].modify && found && it->alive){
+                first_ec = first_ec == EC_None ? EC_ItemFound : first_ec;
+            }
+            //Replace record (or revive tombstone)
+            else if (found){
+                *it = new_record;
+            }
+            //Insert record in order
+            else {
+                records.insert(it, new_record);
+            }
+        }
+        ec = fm::WriteFoodsBin(foodsbin, records);
+        return ec != EC_None ? ec : first_ec;
+    }
+    //Validate user_foods.dat
+    fs::path foodsdat = foods_dat(usr);
+    ErrorCode ec = fm::UserFoodsDatCheck(foodsdat);
+    if (ec != EC_None && ec != EC_FileEmpty){
+        return ec;
+    }
+    //If file is not empty, read current foods.
+    string data;
+    if (ec != EC_FileEmpty){
+        ec = fm::ReadFileData(foodsdat, data);
         if (ec != EC_None){
             return ec;
         }
     }
-    //Return
-    return EC_None;
+    vector<string> foods;
+    size_t start = 0, end;
+    while ((end = data.find('|', start)) != string::npos){
+        string food_str = data.substr(start, end - start);
+        strings::RemoveBrackets(food_str);
+        foods.push_back(strings::DataToFile(food_str));
+        start = end + 1;
+    }
+    //Apply changes
+    for (size_t i = 0; i < count; i++){
+        //Register: append food string.
+        if (!changes[i].modify){
+            foods.push_back(changes[i].food_data);
+            continue;
+        }
+        //Modify: replace the food string that starts with the food name.
+        string food_name = changes[i].food_data.substr(0, changes[i].food_data.find_first_of('/') + 1);
+        for (string& food_str : foods){
+            if (food_str.starts_with(food_name)){
+                food_str = changes[i].food_data;
+            }
+        }
+    }
+    //Commit foods data and return
+    string foods_data;
+    for (string& food_str : foods){
+        foods_data += food_str;
+    }
+    ec = fm::CommitFile(foodsdat, foods_data);
+    return ec != EC_None ? ec : first_ec;
 }
 /**
- * @brief Print macro label from macro index.
- * @param macro_index Macro index to print. Consult macro indexes inside function switch.
+ * @brief Get macro label from macro index.
+ * @param macro_index Nutrient index (see nutrients::GetSchema()), or PORTION_INDEX for the portion size.
+ * @returns Macro label, or an empty string if the index is not a macro.
 **/
-void food::PrintMacro(const uint8_t macro_index){
-    switch (macro_index){
-        case 0:
-            cout << "Calories(Kcal): ";
-            break;
-        case 1:
-            cout << "Carbohydrates: ";
-            break;
-        case 2:
-            cout << "Sugars: ";
-            break;
-        case 3:
-            cout << "Protein: ";
-            break;
-        case 4:
-            cout << "Fats: ";
-            break;
-        case (NUM_OF_MACROS):
-            cout << "Portion size: ";
-            break;
-        default:
-            cout << "Macro not found.";
-            break;
+string food::GetMacroLabel(const uint8_t macro_index){
+    //Schema nutrient
+    if (macro_index < nutrients::Count()){
+        return nutrients::GetLabel(macro_index);
     }
-    return;
+    //Portion size
+    else if (macro_index == PORTION_INDEX){
+        return "Portion size";
+    }
+    //Anything else
+    return "";
 }
 #pragma endregion
-#pragma region Macros
+#pragma region Catalog
 /**
- * @brief Get macros for the given date and user.
- * @param username Name of the user to search.
- * @param macros Provide a vector of doubles to store found macros.
- * @param date_data Struct of date::s_date type.
- * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_None;
- * @returns [OR] ErrorCodes thrown by any of these functions: fm::DayDataCheck();
- * @exception Possible exception when transforming string to double with stod(). File gets validated before loop operation, but any data manipulation while the loop is running can cause stod() to fail and crash the program.
- * @warning The function does NOT check if the file exists or the path makes sense. It just builds an untested path with the given information.
+ * @brief Checks if the user food catalog uses the binary format (user_foods.bin).
+ * @param usr User to target.
+ * @returns 1(true) if the catalog is binary, 0(false) if it is text.
 **/
-ErrorCode food::GetDateMacros(const string& username, vector<double>& macros, date::s_date& date_data){
-    //Clear macros vector
-    macros.clear();
-    //Get path to data
-    fs::path data_p = fm::GetDateDataPath(username, date_data);
-    //Validate file
-    ErrorCode ec = fm::DayDataCheck(data_p);
-    //If file is not found, set all macros to 0 and return.
-    if (ec == EC_FileNotFound){
-        for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-            macros.push_back(0);
+bool food::IsCatalogBinary(const string& usr){
+    return fs::exists(foods_bin(usr));
+}
+/**
+ * @brief Convert the user food catalog between text (user_foods.dat) and binary (user_foods.bin) formats. The new catalog is committed before the old one is removed, and the binary catalog takes precedence while both exist.
+ * @param usr User to target.
+ * @param to_binary If true, convert text to binary. If false, convert binary to text.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: fm::UserFoodsDatCheck(); fm::UserFoodsBinCheck(); fm::ReadFileData(); fm::ReadFoodsBin(); fm::WriteFoodsBin(); fm::CommitFile(); fm::SafeDeleteFile();
+**/
+ErrorCode food::ConvertFoodCatalog(const string& usr, const bool to_binary){
+    fs::path foodsdat = foods_dat(usr), foodsbin = foods_bin(usr);
+    //Already in the desired format, return.
+    if (IsCatalogBinary(usr) == to_binary){
+        return EC_None;
+    }
+    ErrorCode ec;
+    //Text to binary
+    if (to_binary){
+        //Validate user_foods.dat. Missing or empty files become an empty catalog.
+        vector<fm::s_food_record> records;
+        ec = fm::UserFoodsDatCheck(foodsdat);
+        if (ec == EC_None){
+            //Read and parse every food
+            string data;
+            ec = fm::ReadFileData(foodsdat, data);
+            if (ec != EC_None){
+                return ec;
+            }
+            size_t start = 0, end;
+            while ((end = data.find('|', start)) != string::npos){
+                fm::s_food_record record;
+                if (!FoodDataToRecord(data.substr(start, end - start), record)){
+                    return EC_FileCorrupted;
+                }
+                records.push_back(record);
+                start = end + 1;
+            }
+        }
+        else if (ec != EC_FileEmpty && ec != EC_FileNotFound){
+            return ec;
+        }
+        //Sort records by name and write catalog
+        sort(records.begin(), records.end(), [](const fm::s_food_record& a, const fm::s_food_record& b){ return strcmp(a.name, b.name) < 0; });
+        ec = fm::WriteFoodsBin(foodsbin, records);
+        if (ec != EC_None){
+            return ec;
+        }
+        //Remove text catalog
+        if (fs::exists(foodsdat)){
+            return fm::SafeDeleteFile(foodsdat);
         }
         return EC_None;
     }
-    //If there was a problem, return error.
-    else if (ec != EC_None){
+    //Binary to text
+    ec = fm::UserFoodsBinCheck(foodsbin);
+    if (ec != EC_None && ec != EC_FileEmpty){
         return ec;
     }
-    //Open data file
-    ifstream data_in;
-    data_in.open(data_p);
-    if (!data_in.is_open()){
-        return EC_FileReadNoPerm;
+    vector<fm::s_food_record> records;
+    ec = fm::ReadFoodsBin(foodsbin, records);
+    if (ec != EC_None){
+        return ec;
     }
-    //Get data
     string data;
-    for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-        //Get data
-        getline(data_in, data, '|');
-        //Remove brackets
-        strings::RemoveBrackets(data);
-        //Insert data
-        macros.push_back(stod(data));
+    for (fm::s_food_record& r : records){
+        if (r.alive){
+            data += RecordToFoodData(r);
+        }
     }
-    //Close and return
-    data_in.close();
-    return EC_None;
+    //Commit text catalog and remove binary catalog
+    ec = fm::CommitFile(foodsdat, data);
+    if (ec != EC_None){
+        return ec;
+    }
+    return fm::SafeDeleteFile(foodsbin);
+}
+#pragma endregion
+#pragma region Macros
+/**
+ * @brief Get macros for the given date and user.
+ * @param username Name of the user to search.
+ * @param macros Set to store found macros (fixed point, see FIXED_SCALE).
+ * @param date_data Struct of date::s_date type.
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_FileCorrupted (file changed after validation); EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: fm::DayDataCheck(); fm::ReadYearBin();
+ * @warning The function does NOT check if the file exists or the path makes sense. It just builds an untested path with the given information.
+**/
+ErrorCode food::GetDateMacros(const string& username, macro_totals& macros, date::s_date& date_data){
+    return ReadDateMacros(username, macros, date_data, NULL);
 }
 /**
  * @brief Get macros for the given year. Provide desired year inside struct.
  * @param username Name of the user to search.
- * @param macros Provide a vector of doubles to store found macros.
+ * @param macros Set to store found macros (fixed point, see FIXED_SCALE).
  * @param date_data Struct of date::s_date type. Month, month day & week day will be ignored (See warning).
- * @returns Possible ErrorCodes: EC_None;
- * @returns [OR] ErrorCodes thrown by food::GetDateMacros();
- * @warning Month & month day will be calculated automatically to the last day of December.
+ * @returns ErrorCodes thrown by SumYearDays();
+ * @warning Month & month day will be set to the last day of December.
 **/
-ErrorCode food::GetYearMacros(const string& username, vector<double>& macros, date::s_date& date_data){
-    //Clear and initialize macros vector
-    macros.clear();
-    for (uint8_t t = 0; t < NUM_OF_MACROS; t++){
-        macros.push_back(0);
-    }
-    //Save desired year
-    int target_yr = date_data.year;
-    //Set desired date
+ErrorCode food::GetYearMacros(const string& username, macro_totals& macros, date::s_date& date_data){
+    latency::phase_scope phase(latency::PH_Parse);
+    //Set last year day
     date_data.month = date::month_name::December;
     date_data.month_day = 31;
-    c_calendar.SetDate(date_data.year, date_data.month, date_data.month_day);
-    //Year loop
-    while (c_calendar.GetYear() == target_yr){
-        //Declare transitory vector
-        vector<double> t_macros;
-        //Pass date to struct
-        c_calendar.PassDateToStruct(date_data);
-        //Get daily macros
-        ErrorCode ec = GetDateMacros(username, t_macros, date_data);
-        switch (ec){
-            //No data found, skip
-            case EC_ItemNotFound:
-                break;
-            //Sum daily macros
-            case EC_None:
-                for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-                    macros[i] += t_macros[i];
-                }
-                break;
-            //Error
-            default:
-                macros.clear();
-                return ec;
-        }
-        //Date back one day
-        c_calendar--;
-        //Clear temp macros
-        t_macros.clear();
-    }
-    //Refresh date and return
-    c_calendar.RefreshDate();
-    return EC_None;
+    date_data.week_day = date::CalcDayOfWeek(date_data.year, date_data.month, date_data.month_day);
+    //Sum whole year
+    return SumYearDays(username, date_data.year, 0, YEAR_BIN_DAYS - 1, macros);
 }
 /**
  * @brief Get macros for the given month in given year. Provide desired month & year inside struct.
  * @param username Name of the user to search.
- * @param macros Provide a vector of doubles to store found macros.
+ * @param macros Set to store found macros (fixed point, see FIXED_SCALE).
  * @param date_data Struct of date::s_date type. Month day & week day will be ignored (See warning).
- * @returns Possible ErrorCodes: EC_None;
- * @returns [OR] ErrorCodes thrown by food::GetDateMacros();
- * @warning Month day will be calculated automatically to the last day of the month.
+ * @returns ErrorCodes thrown by SumYearDays();
+ * @warning Month day will be set to the last day of the month.
 **/
-ErrorCode food::GetMonthMacros(const string& username, vector<double>& macros, date::s_date& date_data){
-    //Clear and initialize macros vector
-    macros.clear();
-    for (uint8_t t = 0; t < NUM_OF_MACROS; t++){
-        macros.push_back(0);
-    }
-    //Saved desired month
-    date::month_name target_month = date_data.month;
+ErrorCode food::GetMonthMacros(const string& username, macro_totals& macros, date::s_date& date_data){
+    latency::phase_scope phase(latency::PH_Parse);
     //Calculate last month day
     date_data.month_day = date::GetMonthLength(date_data.month, date_data.year);
-    //Set desired date    
-    c_calendar.SetDate(date_data.year, date_data.month, date_data.month_day);
-    //Month day loop
-    while (c_calendar.GetMonth() == target_month){
-        //Declare transitory vector
-        vector<double> t_macros;
-        //Pass date to struct
-        c_calendar.PassDateToStruct(date_data);
-        //Get daily macros
-        ErrorCode ec = GetDateMacros(username, t_macros, date_data);
-        switch (ec){
-            //No data found, skip
-            case EC_ItemNotFound:
-                break;
-            //Sum daily macros
-            case EC_None:
-                for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-                    macros[i] += t_macros[i];
-                }
-                break;
-            //Error
-            default:
-                macros.clear();
-                return ec;
-        }
-        //Date back one day
-        c_calendar--;
-        //Clear temp macros
-        t_macros.clear();
-    }
-    //Refresh date and return.
-    c_calendar.RefreshDate();
-    return EC_None;
+    date_data.week_day = date::CalcDayOfWeek(date_data.year, date_data.month, date_data.month_day);
+    //Sum month day range
+    return SumYearDays(username, date_data.year, date::GetYearDay(date_data.year, date_data.month, 1), date::GetYearDay(date_data.year, date_data.month, date_data.month_day), macros);
 }
 /**
  * @brief Get macros for the given week in given date. Provide desired day, month & year inside struct.
  * @param username Name of the user to search.
- * @param macros Provide a vector of doubles to store found macros.
+ * @param macros Set to store found macros (fixed point, see FIXED_SCALE).
  * @param date_data Struct of date::s_date type. Week day will be ignored (See warning).
- * @returns Possible ErrorCodes: EC_None;
- * @returns [OR] ErrorCodes thrown by food::GetDateMacros();
- * @warning The week will be the same as the given day's week. Month day will be corrected to point to the next Sunday (if not Sunday already).
+ * @returns ErrorCodes thrown by SumYearDays();
+ * @warning The week will be the same as the given day's week. Date will be corrected to point to the next Sunday (if not Sunday already).
 **/
-ErrorCode food::GetWeekMacros(const string& username, vector<double>& macros, date::s_date& date_data){
-    //Clear and initialize macros vector
-    macros.clear();
-    for (uint8_t t = 0; t < NUM_OF_MACROS; t++){
-        macros.push_back(0);
-    }
+ErrorCode food::GetWeekMacros(const string& username, macro_totals& macros, date::s_date& date_data){
+    latency::phase_scope phase(latency::PH_Parse);
     //Set desired date
-    c_calendar.SetDate(date_data.year, date_data.month, date_data.month_day);    
-    //Get week day
-    date_data.week_day = c_calendar.GetWeekDay();
+    c_calendar.SetDate(date_data.year, date_data.month, date_data.month_day);
     //Forward date until Sunday (if needed).
-    for (uint8_t t = 7 - date_data.week_day; t > 0; t--){
+    for (uint8_t t = 7 - c_calendar.GetWeekDay(); t > 0; t--){
         c_calendar++;
     }
-    //Week day loop
-    for (uint8_t d = 7; d > 0; d--){
-        //Declare transitory vector
-        vector<double> t_macros;
-        //Pass date to struct
-        c_calendar.PassDateToStruct(date_data);
-        //Get daily macros
-        ErrorCode ec = GetDateMacros(username, t_macros, date_data);
-        switch (ec){
-            //No data found, skip
-            case EC_ItemNotFound: {
-                break;
-            }
-            //Sum daily macros
-            case EC_None: {
-                for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-                    macros[i] += t_macros[i];
-                }
-                break;
-            }
-            //Error
-            default: {
-                macros.clear();
-                return ec;
-            }
-        }
-        //Go back one day
-        c_calendar--;
-        //Clear temp macros
-        t_macros.clear();
-    }
-    //All done, refresh date.
+    c_calendar.PassDateToStruct(date_data);
     c_calendar.RefreshDate();
+    //Sum week days (Monday to Sunday). If the week starts in the previous year, sum both parts.
+    uint16_t sunday = date::GetYearDay(date_data.year, date_data.month, date_data.month_day);
+    if (sunday >= 6){
+        return SumYearDays(username, date_data.year, sunday - 6, sunday, macros);
+    }
+    macro_totals t_macros;
+    uint16_t prev_length = date::IsLeapYear(date_data.year - 1) ? 366 : 365;
+    ErrorCode ec = SumYearDays(username, date_data.year - 1, prev_length - (6 - sunday), prev_length - 1, t_macros);
+    if (ec != EC_None){
+        return ec;
+    }
+    ec = SumYearDays(username, date_data.year, 0, sunday, macros);
+    if (ec != EC_None){
+        return ec;
+    }
+    macros += t_macros;
     return EC_None;
 }
 /**
  * @brief Get macros for the given day in given date. Provide desired day, month & year inside struct.
  * @param username Name of the user to search.
- * @param macros Provide a vector of doubles to store found macros.
+ * @param macros Set to store found macros (fixed point, see FIXED_SCALE).
  * @param date_data Struct of date::s_date type. Week day will be ignored (see warning).
  * @returns ErrorCodes thrown by food::GetDateMacros();
  * @warning Week day is calculated automatically.
 **/
-ErrorCode food::GetDayMacros(const string& username, vector<double>& macros, date::s_date& date_data){
+ErrorCode food::GetDayMacros(const string& username, macro_totals& macros, date::s_date& date_data){
+    latency::phase_scope phase(latency::PH_Parse);
     //Set desired week day
     date_data.week_day = date::CalcDayOfWeek(date_data.year, date_data.month, date_data.month_day);
     //Get daily macros and return
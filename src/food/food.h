@@ -4,23 +4,69 @@ using namespace std;
 #include <vector>
 #include "../errors/errors.h"
 #include "../date/date.h"
+#include "../io/io_fb.h"
+using namespace io_fb;
+#include "../events/events.h"
 
+#ifndef _FOOD_
+#define _FOOD_
 namespace food {
+#pragma region Data
+/**
+ * @brief Position inside a food catalog, used to read it page by page.
+ * @param offset (uint64_t) Byte offset (text catalog) or record index (binary catalog) of the next food to read. Start at 0.
+ * @param end (bool) Set when there are no foods left after the last read page.
+**/
+typedef struct {
+    uint64_t offset;
+    bool end;
+} s_food_cursor;
+/**
+ * @brief Food eaten but not yet written (see PrepareEat() and CommitEat()).
+ * @param day (date::s_date) Day the food was eaten.
+ * @param event (events::s_event) Event to log.
+ * @param nutrients (macro_totals) Eaten nutrients, added to the day totals.
+**/
+typedef struct {
+    date::s_date day;
+    events::s_event event;
+    macro_totals nutrients;
+} s_eat;
+/**
+ * @brief Food catalog change not yet written (see CommitFoodChanges()).
+ * @param modify (bool) 1(true) to modify a registered food, 0(false) to register a new one.
+ * @param food_data (string) Food data string, formatted as in user_foods.dat.
+**/
+typedef struct {
+    bool modify;
+    string food_data;
+} s_food_change;
+#pragma endregion
 #pragma region Macros
-ErrorCode GetDateMacros(const string& username, vector<double>& macros, date::s_date& date_data);
-ErrorCode GetYearMacros(const string& username, vector<double>& macros, date::s_date& date_data);
-ErrorCode GetMonthMacros(const string& username, vector<double>& macros, date::s_date& date_data);
-ErrorCode GetWeekMacros(const string& username, vector<double>& macros, date::s_date& date_data);
-ErrorCode GetDayMacros(const string& username, vector<double>& macros, date::s_date& date_data);
+ErrorCode GetDateMacros(const string& username, macro_totals& macros, date::s_date& date_data);
+ErrorCode GetYearMacros(const string& username, macro_totals& macros, date::s_date& date_data);
+ErrorCode GetMonthMacros(const string& username, macro_totals& macros, date::s_date& date_data);
+ErrorCode GetWeekMacros(const string& username, macro_totals& macros, date::s_date& date_data);
+ErrorCode GetDayMacros(const string& username, macro_totals& macros, date::s_date& date_data);
 #pragma endregion
 #pragma region Food
-ErrorCode PrintFoodList(const string& usr, vector<string>& foods);
-ErrorCode InternalEatFood(const string& usr, const string& food, unsigned long& amount, bool portions_or_grams);
+ErrorCode GetFoodNames(const string& usr, vector<string>& foods);
+ErrorCode GetFoodPage(const string& usr, s_food_cursor& cursor, const size_t count, vector<string>& foods);
+ErrorCode PrepareEat(const string& usr, const string& food, const unsigned long amount, const bool portions_or_grams, s_eat& eat);
+ErrorCode CommitEat(const string& usr, const s_eat& eat, macro_totals* day_totals = NULL);
+ErrorCode CommitEats(const string& usr, const s_eat* eats, const size_t count, macro_totals* day_totals = NULL);
+ErrorCode InternalEatFood(const string& usr, const string& food, unsigned long& amount, bool portions_or_grams, date::s_date* day = NULL, macro_totals* day_totals = NULL);
 ErrorCode InternalRemoveFood(const string& usr, const string& food);
 ErrorCode IsFoodRegistered(const string& usr, const string& food);
 ErrorCode InternalModifyFood(const string& usr, const string& food_data);
 ErrorCode InternalRegisterFood(const string& usr, const string& food);
-ErrorCode GetFoodData(const string& usr, const string& food, vector<double>& macros);
-void PrintMacro(const uint8_t macro_index);
+ErrorCode CommitFoodChanges(const string& usr, const s_food_change* changes, const size_t count);
+ErrorCode GetFoodData(const string& usr, const string& food, food_macros& macros);
+string GetMacroLabel(const uint8_t macro_index);
+#pragma endregion
+#pragma region Catalog
+bool IsCatalogBinary(const string& usr);
+ErrorCode ConvertFoodCatalog(const string& usr, const bool to_binary);
 #pragma endregion
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
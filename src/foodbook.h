@@ -0,0 +1,16 @@
+//libfoodbook public API: data files, users, foods and macro queries, without any terminal I/O.
+//Embedders link libfoodbook.a (or libfoodbook.so), run filemanager::InitialFilesCheck() once from the folder that holds (or will hold) the data folder, and then use these modules.
+#include "errors/errors.h"
+#include "io/io_fb.h"
+#include "date/date.h"
+#include "nutrients/nutrients.h"
+#include "filemanager/filemanager.h"
+#include "events/events.h"
+#include "search/search.h"
+#include "backup/backup.h"
+#include "watcher/watcher.h"
+#include "user/users.h"
+#include "food/food.h"
+#include "persist/persist.h"
+#include "latency/latency.h"
+#include "profiler/profiler.h"
@@ -0,0 +1,367 @@
+#include "console.h"
+#include "../latency/latency.h"
+#include <streambuf>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#if LINUX
+#include <unistd.h>
+#include <sys/ioctl.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#endif
+
+#pragma region Internal Use Functions
+//Pending output (written since the last render), whether a new frame was started since then, the current frame as shown on screen and whether it is known (the screen holds whatever was there before Start() until the first frame is fully drawn).
+static string c_pending;
+static bool c_cleared = 0;
+static string c_shown;
+static bool c_shown_valid = 0;
+/**
+ * @brief Stream buffer that collects cout output into the pending frame output. A cout flush renders it.
+**/
+class frame_buf : public streambuf {
+    protected:
+    int overflow(int c) override {
+        if (c != EOF){
+            c_pending += (char)c;
+        }
+        return c;
+    }
+    streamsize xsputn(const char* s, streamsize n) override {
+        c_pending.append(s, n);
+        return n;
+    }
+    int sync() override {
+        io_fb::screen::Flush();
+        return 0;
+    }
+};
+static frame_buf c_frame_buf;
+static streambuf* c_cout_buf = NULL;
+/**
+ * @brief Split a frame into screen lines. Carriage returns overwrite the line from its start (progress counters), so only the text after the last one is kept.
+ * @param frame Frame text.
+ * @param lines Vector that will contain the lines. The last one is the line the cursor is at (it may be empty).
+**/
+void SplitLines(const string& frame, vector<string>& lines){
+    lines.assign(1, "");
+    for (char c : frame){
+        if (c == '\n'){
+            lines.emplace_back();
+        }
+        else if (c == '\r'){
+            lines.back().clear();
+        }
+        else {
+            lines.back() += c;
+        }
+    }
+    return;
+}
+/**
+ * @brief Get the terminal size.
+ * @param rows Terminal rows.
+ * @param cols Terminal columns.
+ * @returns 1(true) if output is a terminal and its size is known, 0(false) if not.
+**/
+bool GetTerminalSize(size_t& rows, size_t& cols){
+    #if LINUX
+    winsize size;
+    if (!isatty(STDOUT_FILENO) || ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0 || size.ws_col == 0){
+        return 0;
+    }
+    rows = size.ws_row;
+    cols = size.ws_col;
+    #elif defined(_WIN32)
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)){
+        return 0;
+    }
+    rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    cols = info.srWindow.Right - info.srWindow.Left + 1;
+    #else
+    return 0;
+    #endif
+    return 1;
+}
+/**
+ * @brief Build the escape sequences that turn the shown frame into a new one.
+ * @param shown Frame on screen.
+ * @param frame New frame.
+ * @returns Output to write.
+**/
+string RenderFrame(const string& shown, const string& frame){
+    vector<string> old_lines, new_lines;
+    SplitLines(shown, old_lines);
+    SplitLines(frame, new_lines);
+    //If any frame does not fit the terminal, screen rows are unknown (scroll, wrapped lines). Redraw everything.
+    size_t rows, cols;
+    bool fits = GetTerminalSize(rows, cols) && old_lines.size() <= rows && new_lines.size() <= rows;
+    for (size_t i = 0; fits && i < max(old_lines.size(), new_lines.size()); i++){
+        fits = (i >= old_lines.size() || old_lines[i].length() < cols) && (i >= new_lines.size() || new_lines[i].length() < cols);
+    }
+    if (!fits){
+        return "\x1b[H\x1b[2J\x1b[3J" + frame;
+    }
+    //Rewrite changed lines only
+    string out;
+    for (size_t i = 0; i < new_lines.size(); i++){
+        if (i < old_lines.size() && old_lines[i] == new_lines[i]){
+            continue;
+        }
+        out += "\x1b[" + to_string(i + 1) + ";1H" + new_lines[i] + "\x1b[K";
+    }
+    //Clear lines left from the old frame
+    if (old_lines.size() > new_lines.size()){
+        out += "\x1b[" + to_string(new_lines.size() + 1) + ";1H\x1b[J";
+    }
+    //Leave cursor at the end of the frame
+    out += "\x1b[" + to_string(new_lines.size()) + ';' + to_string(new_lines.back().length() + 1) + 'H';
+    return out;
+}
+/**
+ * @brief Write all data to the standard output with as few calls as possible (one, unless the system splits it).
+ * @param data Data to write.
+**/
+void WriteOut(const string& data){
+    #if LINUX
+    size_t written = 0;
+    while (written < data.size()){
+        ssize_t w = write(STDOUT_FILENO, data.data() + written, data.size() - written);
+        if (w <= 0){
+            return;
+        }
+        written += w;
+    }
+    #else
+    fwrite(data.data(), 1, data.size(), stdout);
+    fflush(stdout);
+    #endif
+    return;
+}
+/**
+ * @brief Render pending output and read a line from the standard input. The line is recorded as shown if the terminal echoed it. Waiting for the line is not part of the latency of the running operation (see latency::phase).
+ * @param line String that will contain the line, without the line break.
+**/
+void ReadLine(string& line){
+    io_fb::screen::Flush();
+    latency::phase_scope phase(latency::PH_Input);
+    getline(cin, line, '\n');
+    io_fb::screen::Echo(line);
+    return;
+}
+/**
+ * @brief Render pending output and give cout its original buffer back (exit handler).
+**/
+void StopScreen(){
+    io_fb::screen::Flush();
+    cout.rdbuf(c_cout_buf);
+    return;
+}
+#pragma endregion
+#pragma region Screen
+/**
+ * @brief Route cout through the renderer. Call it once, before any output.
+**/
+void io_fb::screen::Start(){
+    if (c_cout_buf != NULL){
+        return;
+    }
+    #if defined(_WIN32)
+    //Enable escape sequences on the Windows console
+    HANDLE out_h = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode;
+    if (GetConsoleMode(out_h, &mode)){
+        SetConsoleMode(out_h, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+    #endif
+    c_cout_buf = cout.rdbuf(&c_frame_buf);
+    c_shown_valid = 0;
+    //Render whatever is left on exit (fatal errors, exit from menus).
+    atexit(StopScreen);
+    return;
+}
+/**
+ * @brief Start a new frame. Output pending from the previous frame is discarded, as it would be cleared before anyone could read it.
+**/
+void io_fb::screen::Clear(){
+    c_pending.clear();
+    c_cleared = 1;
+    return;
+}
+/**
+ * @brief Render pending output with a single write. A new frame is diffed against the shown one (the first one is fully redrawn); output to the same frame is written as it is.
+**/
+void io_fb::screen::Flush(){
+    if (!c_cleared && c_pending.empty()){
+        return;
+    }
+    string out;
+    if (c_cleared){
+        out = c_shown_valid ? RenderFrame(c_shown, c_pending) : "\x1b[H\x1b[2J\x1b[3J" + c_pending;
+        c_shown = move(c_pending);
+        c_shown_valid = 1;
+    }
+    else {
+        out = c_pending;
+        c_shown += c_pending;
+    }
+    c_pending.clear();
+    c_cleared = 0;
+    WriteOut(out);
+    return;
+}
+/**
+ * @brief Record a line the user typed, which the terminal already shows. Does nothing if the input is not a terminal (no echo).
+ * @param line Typed line, without the line break.
+**/
+void io_fb::screen::Echo(const string& line){
+    #if LINUX
+    bool echo = isatty(STDIN_FILENO);
+    #elif defined(_WIN32)
+    bool echo = _isatty(_fileno(stdin));
+    #else
+    bool echo = 0;
+    #endif
+    if (echo){
+        c_shown += line + '\n';
+    }
+    return;
+}
+#pragma endregion
+#pragma region Input
+/**
+ * @brief Asks the user to enter a string input. The allowed input will depend on the string mode (see mode).
+ * @param mode String mode to allow. This will make sure the user does not input any forbidden values.
+ * @param input String that will contain the recieved input. Set to empty at the function start.
+ * @warning If string is not ascii compliant, the input will not be accepted.
+ * @returns If input is successfully taken it returns 1. If user cancels, it returns 0.
+**/
+bool io_fb::input::GetStringInput(const StrModes mode, string &input){
+    //Get input
+    string tmp_str;
+    do {
+        tmp_str = "";
+        ReadLine(tmp_str);
+        //If string is empty, cancel
+        if (tmp_str.empty()){
+            return 0;
+        }
+        //Resize string accordingly
+        switch (mode){
+            case SM_FoodName:
+                if (tmp_str.length() > MAX_FOOD_NAME){
+                    tmp_str.resize(MAX_FOOD_NAME);
+                }
+                break;
+            case SM_UserName:
+                if (tmp_str.length() > MAX_USR_NAME){
+                    tmp_str.resize(MAX_USR_NAME);
+                }
+                break;
+            case SM_Command:
+                if (tmp_str.length() > MAX_COMMAND_L){
+                    tmp_str.resize(MAX_COMMAND_L);
+                }
+                break;
+            case SM_Dir:
+                if (tmp_str.length() > MAX_DIR_L){
+                    tmp_str.resize(MAX_DIR_L);
+                }
+                break;
+        }
+        //If string is not ascii compliant, retry
+        if (!strings::IsStringValid(tmp_str)){
+            cout << "Forbidden character found. Try again.\n";
+        }
+        //If is a name
+        else if (mode == SM_UserName || mode == SM_FoodName){
+            //If name is not valid, retry
+            if (!name::IsValidName(tmp_str,0)){
+                cout << "Forbidden character found. Try again.\n";
+            }
+            //Else, break
+            else {
+                break;
+            }
+        }
+        //All good, break
+        else {
+            break;
+        }
+    } while(true);
+    input = tmp_str;
+    return 1;
+}
+/**
+ * @brief Asks the user to enter a numeric input. The allowed input will depend on the numeric mode(see mode).
+ * @param input_here A pointer to the variable that will contain the desired input. See exception.
+ * @param mode Numeric mode to allow. This will make sure the user does not input any forbidden values.
+ * @exception If the input variable is not correct to the specified mode, the function may crash (wrong cast or wrong string conversion).
+ * @returns If input is successfully taken and converted it returns 1. If user cancels, it returns 0.
+**/
+bool io_fb::input::GetNumericInput(void *input_here, const NumericMode mode){
+    do {
+        //Get input
+        string tmp_str = "";
+        cout << "Enter a number (leave empty to cancel): ";
+        ReadLine(tmp_str);
+        //If cancel, set number to 0 (reserved for failure/invalid input) and return 0
+        if (tmp_str.empty()){
+            switch (mode){
+                case Mode_Int:
+                    *(int *)input_here = 0;
+                    return 0;
+                case Mode_UIntLong:
+                    *(unsigned long *)input_here = 0;
+                    return 0;
+                case Mode_UInt8:
+                    *(uint8_t *)input_here = 0;
+                    return 0;
+                case Mode_Float:
+                    *(float *)input_here = 0;
+                    return 0;
+                case Mode_Double:
+                    *(double *)input_here = 0;
+                    return 0;
+            }
+        }
+        //Else if string is numeric, convert to number, set and break
+        else if (strings::IsNumericStr(tmp_str, mode)){
+            //Cast input according to chosen mode.
+            switch (mode){
+                case Mode_Int:
+                    *(int *)input_here = stoi(tmp_str);
+                    break;
+                case Mode_UIntLong:
+                    *(unsigned long *)input_here = stoul(tmp_str);
+                    break;
+                case Mode_UInt8:
+                    *(uint8_t *)input_here = stoul(tmp_str);
+                    break;
+                case Mode_Float:
+                    *(float *)input_here = stof(tmp_str);
+                    break;
+                case Mode_Double:
+                    *(double *)input_here = stod(tmp_str);
+                    break;
+            }
+            break;
+        }
+        //Else we reenter the loop until a valid option is selected
+    } while (true);
+    return 1;
+}
+/**
+ * @brief Ask the user to press enter before continuing execution. Anything the user writes is discarded from the stream (ignored).
+**/
+void io_fb::input::ConsoleWait(){
+    cout << "Press 'Enter' to continue...\n";
+    string discard;
+    ReadLine(discard);
+    return;
+}
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "io_fb.h"
+
+#ifndef _CONSOLE_
+#define _CONSOLE_
+#pragma region Macros
+    //Terminal helpers. They belong to the terminal interface, not to libfoodbook.
+    #define ClearConsole io_fb::screen::Clear() //Start a new screen (rendered when input is asked, see io_fb::screen).
+#pragma endregion
+namespace io_fb{
+#pragma region Screen
+/**
+ * @brief In-process terminal renderer. Everything written to cout is composed into a frame buffer; ClearConsole starts a new frame. Frames are rendered when input is asked (or cout is flushed) with a single write(): a new frame only rewrites the lines that differ from the previous one, using ANSI escape sequences. Frames that do not fit the terminal (or when its size is unknown) are fully redrawn.
+**/
+namespace screen{
+    void Start();
+    void Clear();
+    void Flush();
+    void Echo(const string& line);
+}
+#pragma endregion
+#pragma region Input
+namespace input{
+    void ConsoleWait();
+    bool GetNumericInput(void *input_here, const NumericMode mode);
+    bool GetStringInput(const StrModes mode, string &input);
+}
+#pragma endregion
+}
+#endif
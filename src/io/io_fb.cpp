@@ -1,5 +1,5 @@
 #include "io_fb.h"
-#include <limits>
+#include <cmath>
 
 #pragma region Strings
 /**
@@ -45,25 +45,6 @@ bool io_fb::strings::iStrCmp(const string& string_a, const string& string_b){
     //Strings are equal, return success.
     return 1;
 }
-/**
- * @brief Checks if target string starts with desired start ignoring case differences (case insensitive).
- * @param target String to check.
- * @param desired_start Desired start for target. Must be no longer than target.
- * @returns If target starts with desired start, returns 1. If it does not start as desired, or desired start is longer than target string, returns 0.
- * @warning Comparation is done with iStrCmp();
-**/
-bool io_fb::strings::iStrStartsWith(string target, string desired_start){
-    //If desired_start is longer than target, return 0
-    if (target.size() < desired_start.size()){
-        return 0;
-    }
-    //If target is longer than desired start, resize it to desired_start.
-    else if(target.size() > desired_start.size()){
-        target.resize(desired_start.size());
-    }
-    //Compare strings and return
-    return iStrCmp(target, desired_start);
-}
 /**
  * @brief Checks if every character in a string is numeric (see mode).
  * @param target String to check.
@@ -137,6 +118,70 @@ void io_fb::strings::RemoveBrackets(string& target){
     return;
 }
 #pragma endregion
+#pragma region Fixed Point
+/**
+ * @brief Parse a decimal string ("12", "12.5", "12.000000") into a fixed point value, exactly. Decimals past FIXED_DECIMALS are rounded (half away from zero).
+ * @param str String to parse. A leading '-' is allowed.
+ * @param value Variable that will contain the parsed value.
+ * @returns 1(true) if string is a valid decimal number that fits, 0(false) if not.
+**/
+bool io_fb::fixed_point::FromStr(const string& str, fixed_t& value){
+    bool negative = !str.empty() && str[0] == '-';
+    string digits = negative ? str.substr(1) : str;
+    if (!strings::IsNumericStr(digits, Mode_Double) || digits == "."){
+        return 0;
+    }
+    //Split integer and decimal parts
+    size_t dot = digits.find('.');
+    string int_part = digits.substr(0, dot);
+    string dec_part = dot == string::npos ? "" : digits.substr(dot + 1);
+    //Integer part (leading zeros skipped), making sure it fits once scaled.
+    fixed_t result = 0;
+    for (char c : int_part){
+        if (result > (INT64_MAX / FIXED_SCALE - 9) / 10){
+            return 0;
+        }
+        result = result * 10 + (c - '0');
+    }
+    //Decimal part
+    for (uint8_t i = 0; i < FIXED_DECIMALS; i++){
+        result = result * 10 + (i < dec_part.length() ? dec_part[i] - '0' : 0);
+    }
+    //Round on the first dropped decimal
+    if (dec_part.length() > FIXED_DECIMALS && dec_part[FIXED_DECIMALS] >= '5'){
+        result++;
+    }
+    value = negative ? -result : result;
+    return 1;
+}
+/**
+ * @brief Transform a fixed point value into a decimal string with FIXED_DECIMALS decimals ("955.000").
+ * @param value Value to transform.
+ * @returns Decimal string.
+**/
+string io_fb::fixed_point::ToStr(const fixed_t value){
+    uint64_t abs_value = value < 0 ? -(uint64_t)value : value;
+    string decimals = to_string(abs_value % FIXED_SCALE);
+    decimals.insert(0, FIXED_DECIMALS - decimals.length(), '0');
+    return (value < 0 ? "-" : "") + to_string(abs_value / FIXED_SCALE) + '.' + decimals;
+}
+/**
+ * @brief Round a double to the nearest fixed point value.
+ * @param value Value to transform.
+ * @returns Fixed point value.
+**/
+io_fb::fixed_t io_fb::fixed_point::FromDouble(const double value){
+    return llround(value * FIXED_SCALE);
+}
+/**
+ * @brief Transform a fixed point value into a double (meant for printing only).
+ * @param value Value to transform.
+ * @returns Double value.
+**/
+double io_fb::fixed_point::ToDouble(const fixed_t value){
+    return (double)value / FIXED_SCALE;
+}
+#pragma endregion
 #pragma region Names
 /**
  * @brief Transform a in file name to a valid name (replace '_' with space and add upper case depending on mode rules).
@@ -220,135 +265,3 @@ bool io_fb::name::IsValidName(const string& name, const bool in_file_name){
     return 1;
 }
 #pragma endregion
-#pragma region Input
-/**
- * @brief Asks the user to enter a string input. The allowed input will depend on the string mode (see mode).
- * @param mode String mode to allow. This will make sure the user does not input any forbidden values.
- * @param input String that will contain the recieved input. Set to empty at the function start.
- * @warning If string is not ascii compliant, the input will not be accepted.
- * @returns If input is successfully taken it returns 1. If user cancels, it returns 0.
-**/
-bool io_fb::input::GetStringInput(const StrModes mode, string &input){
-    //Get input
-    string tmp_str;
-    do {
-        tmp_str = "";
-        getline(cin, tmp_str, '\n');
-        //If string is empty, cancel
-        if (tmp_str.empty()){
-            return 0;
-        }
-        //Resize string accordingly
-        switch (mode){
-            case SM_FoodName:
-                if (tmp_str.length() > MAX_FOOD_NAME){
-                    tmp_str.resize(MAX_FOOD_NAME);
-                }
-                break;
-            case SM_UserName:
-                if (tmp_str.length() > MAX_USR_NAME){
-                    tmp_str.resize(MAX_USR_NAME);
-                }
-                break;
-            case SM_Command:
-                if (tmp_str.length() > MAX_COMMAND_L){
-                    tmp_str.resize(MAX_COMMAND_L);
-                }
-                break;
-            case SM_Dir:
-                if (tmp_str.length() > MAX_DIR_L){
-                    tmp_str.resize(MAX_DIR_L);
-                }
-                break;
-        }
-        //If string is not ascii compliant, retry
-        if (!strings::IsStringValid(tmp_str)){
-            cout << "Forbidden character found. Try again.\n";
-        }
-        //If is a name
-        else if (mode == SM_UserName || mode == SM_FoodName){
-            //If name is not valid, retry
-            if (!name::IsValidName(tmp_str,0)){
-                cout << "Forbidden character found. Try again.\n";
-            }
-            //Else, break
-            else {
-                break;
-            }
-        }
-        //All good, break
-        else {
-            break;
-        }
-    } while(true);
-    input = tmp_str;
-    return 1;
-}
-/**
- * @brief Asks the user to enter a numeric input. The allowed input will depend on the numeric mode(see mode).
- * @param input_here A pointer to the variable that will contain the desired input. See exception.
- * @param mode Numeric mode to allow. This will make sure the user does not input any forbidden values.
- * @exception If the input variable is not correct to the specified mode, the function may crash (wrong cast or wrong string conversion).
- * @returns If input is successfully taken and converted it returns 1. If user cancels, it returns 0.
-**/
-bool io_fb::input::GetNumericInput(void *input_here, const NumericMode mode){
-    do {
-        //Get input
-        string tmp_str = "";
-        cout << "Enter a number (leave empty to cancel): ";
-        getline(cin, tmp_str, '\n');
-        //If cancel, set number to 0 (reserved for failure/invalid input) and return 0
-        if (tmp_str.empty()){
-            switch (mode){
-                case Mode_Int:
-                    *(int *)input_here = 0;
-                    return 0;
-                case Mode_UIntLong:
-                    *(unsigned long *)input_here = 0;
-                    return 0;
-                case Mode_UInt8:
-                    *(uint8_t *)input_here = 0;
-                    return 0;
-                case Mode_Float:
-                    *(float *)input_here = 0;
-                    return 0;
-                case Mode_Double:
-                    *(double *)input_here = 0;
-                    return 0;
-            }
-        }
-        //Else if string is numeric, convert to number, set and break
-        else if (strings::IsNumericStr(tmp_str, mode)){
-            //Cast input according to chosen mode.
-            switch (mode){
-                case Mode_Int:
-                    *(int *)input_here = stoi(tmp_str);
-                    break;
-                case Mode_UIntLong:
-                    *(unsigned long *)input_here = stoul(tmp_str);
-                    break;
-                case Mode_UInt8:
-                    *(uint8_t *)input_here = stoul(tmp_str);
-                    break;
-                case Mode_Float:
-                    *(float *)input_here = stof(tmp_str);
-                    break;
-                case Mode_Double:
-                    *(double *)input_here = stod(tmp_str);
-                    break;
-            }
-            break;
-        }
-        //Else we reenter the loop until a valid option is selected
-    } while (true);
-    return 1;
-}
-/**
- * @brief Ask the user to press enter before continuing execution. Anything the user writes is discarded from the stream (ignored).
-**/
-void io_fb::input::ConsoleWait(){
-    cout << "Press 'Enter' to continue...\n";
-    cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    return;
-}
-#pragma endregion
\ No newline at end of file
@@ -1,14 +1,18 @@
 #include <iostream>
 using namespace std;
 #include <string>
+#include <cstdint>
 
+#ifndef _IO_FB_
+#define _IO_FB_
 #pragma region Macros
-    //Set LINUX to false (or 0) for Windows use.
-    #define LINUX false
-    #if LINUX
-    #define ClearConsole system("clear") //Clear console for Linux.
+    //LINUX follows the target platform (false, or 0, for Windows builds). It can also be set from the compiler (-DLINUX=false).
+    #ifndef LINUX
+    #if defined(__linux__)
+    #define LINUX true
     #else
-    #define ClearConsole system("CLS") //Clear console for Windows.
+    #define LINUX false
+    #endif
     #endif
 
     //Length limits
@@ -16,7 +20,13 @@ using namespace std;
     #define MAX_FOOD_NAME 50
     #define MAX_COMMAND_L 10
     #define MAX_DIR_L 4096
-    #define NUM_OF_MACROS 5 //Add 1 to allocate portion where needed
+    #define NUM_OF_MACROS 5 //Built-in macros, the first nutrients of every nutrient schema
+    #define MAX_NUTRIENTS 16 //Nutrient capacity of macro sets and binary records. Add 1 to allocate portion where needed
+    #define PORTION_INDEX MAX_NUTRIENTS //Portion size slot inside food macros
+
+    //Fixed point macro totals: thousandths of a gram (or kcal) stored in int64.
+    #define FIXED_SCALE 1000
+    #define FIXED_DECIMALS 3
 
     //Handy macros
     #define isCharNumber(x) (x >= '0' && x <= '9')
@@ -32,13 +42,62 @@ enum StrModes{SM_UserName, SM_FoodName, SM_Command, SM_Dir};
 namespace strings{
     void StrToLower(string& target);
     bool iStrCmp(const string& string_a, const string& string_b);
-    bool iStrStartsWith(string target, string desired_start);
     bool IsStringValid(const string& target);
     bool IsNumericStr(const string &target, const NumericMode mode);
     string DataToFile(const string& data);
     void RemoveBrackets(string& target);
 }
 #pragma endregion
+#pragma region Fixed Point
+typedef int64_t fixed_t;
+namespace fixed_point{
+    bool FromStr(const string& str, fixed_t& value);
+    string ToStr(const fixed_t value);
+    fixed_t FromDouble(const double value);
+    double ToDouble(const fixed_t value);
+}
+#pragma endregion
+#pragma region Macro Set
+/**
+ * @brief Fixed size set of macro values, kept on the stack. Element-wise operators are plain loops over a compile-time bound, so they can be unrolled and vectorized.
+ * @param values (T[N]) Values in nutrient schema order (see nutrients::GetSchema()). Zero initialized.
+**/
+template<size_t N, typename T = fixed_t>
+struct MacroSet {
+    T values[N] = {};
+    constexpr size_t size() const {
+        return N;
+    }
+    T& operator[](const size_t i){
+        return values[i];
+    }
+    const T& operator[](const size_t i) const {
+        return values[i];
+    }
+    //Set every value to 0.
+    void Clear(){
+        for (size_t i = 0; i < N; i++){
+            values[i] = 0;
+        }
+    }
+    MacroSet& operator+=(const MacroSet& other){
+        for (size_t i = 0; i < N; i++){
+            values[i] += other.values[i];
+        }
+        return *this;
+    }
+    MacroSet& operator*=(const T scale){
+        for (size_t i = 0; i < N; i++){
+            values[i] *= scale;
+        }
+        return *this;
+    }
+};
+//Day totals and their aggregates, in fixed point. Only the first nutrients::Count() values are in use.
+typedef MacroSet<MAX_NUTRIENTS> macro_totals;
+//Catalog macros per gram, plus portion size (at PORTION_INDEX).
+typedef MacroSet<MAX_NUTRIENTS + 1, double> food_macros;
+#pragma endregion
 #pragma region Names
 namespace name{
     string InFileNameToName(const string& name, const uint8_t mode);
@@ -46,11 +105,5 @@ namespace name{
     bool IsValidName(const string& name, const bool in_file_name);      
 }
 #pragma endregion
-#pragma region Input
-namespace input{
-    void ConsoleWait();
-    bool GetNumericInput(void *input_here, const NumericMode mode);
-    bool GetStringInput(const StrModes mode, string &input);
 }
-#pragma endregion
-}
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include <chrono>
+#include <bit>
+#include <cmath>
+#include "latency.h"
+using namespace latency;
+
+#pragma region Internal Use Functions
+//Slow operation threshold, in microseconds.
+static uint64_t c_slow_us = LATENCY_SLOW_MS * 1000;
+//Latency of every operation. Operations are timed on the interface thread only.
+static histogram c_histograms[OP_Count];
+//Operation running on this thread: whether there is one, its current phase, when that phase was entered and the time charged to every phase.
+static thread_local bool c_running = 0;
+static thread_local phase c_phase = PH_Other;
+static thread_local chrono::steady_clock::time_point c_mark;
+static thread_local uint64_t c_phase_us[PH_Count];
+/**
+ * @brief Charge the time since the last switch to the current phase and enter another one.
+ * @param p Phase to enter.
+**/
+void SwitchPhase(const phase p){
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    c_phase_us[c_phase] += chrono::duration_cast<chrono::microseconds>(now - c_mark).count();
+    c_mark = now;
+    c_phase = p;
+}
+#pragma endregion
+#pragma region Histogram Class
+/**
+ * @brief Get the bucket of a value. Values under LATENCY_SUB_BUCKETS get a bucket each; above that, every power of 2 range is split in LATENCY_SUB_BUCKETS / 2 buckets.
+ * @param value Value.
+ * @returns Bucket index.
+**/
+size_t histogram::Index(const uint64_t value){
+    if (value < LATENCY_SUB_BUCKETS){
+        return value;
+    }
+    //Shift that leaves the value between LATENCY_SUB_BUCKETS / 2 and LATENCY_SUB_BUCKETS - 1
+    size_t shift = bit_width(value) - bit_width((uint64_t)LATENCY_SUB_BUCKETS) + 1;
+    return LATENCY_SUB_BUCKETS + (shift - 1) * (LATENCY_SUB_BUCKETS / 2) + (value >> shift) - LATENCY_SUB_BUCKETS / 2;
+}
+/**
+ * @brief Get the highest value a bucket holds.
+ * @param index Bucket index.
+ * @returns Highest value of the bucket.
+**/
+uint64_t histogram::HighestEquivalent(const size_t index){
+    if (index < LATENCY_SUB_BUCKETS){
+        return index;
+    }
+    size_t shift = (index - LATENCY_SUB_BUCKETS) / (LATENCY_SUB_BUCKETS / 2) + 1;
+    uint64_t sub = (index - LATENCY_SUB_BUCKETS) % (LATENCY_SUB_BUCKETS / 2) + LATENCY_SUB_BUCKETS / 2;
+    return ((sub + 1) << shift) - 1;
+}
+/**
+ * @brief Record a value.
+ * @param value Value (microseconds). Values over LATENCY_MAX_US are recorded as LATENCY_MAX_US.
+**/
+void histogram::Record(const uint64_t value){
+    uint64_t v = min(value, (uint64_t)LATENCY_MAX_US);
+    if (counts.empty()){
+        counts.resize(Index(LATENCY_MAX_US) + 1, 0);
+    }
+    counts[Index(v)]++;
+    total++;
+    max_value = max(max_value, v);
+    return;
+}
+/**
+ * @brief Get the amount of recorded values.
+ * @returns Recorded values.
+**/
+uint64_t histogram::Count() const {
+    return total;
+}
+/**
+ * @brief Get the highest recorded value.
+ * @returns Highest value, 0 if there are none.
+**/
+uint64_t histogram::Max() const {
+    return max_value;
+}
+/**
+ * @brief Get the value under which a percentage of the recorded values fall (rounded up to the bucket, so it is never under the real one).
+ * @param percentile Percentage, from 0 to 100 (50 for the median, 99.9 for p999).
+ * @returns Percentile value, 0 if there are no values.
+**/
+uint64_t histogram::Percentile(const double percentile) const {
+    if (total == 0){
+        return 0;
+    }
+    uint64_t target = max((uint64_t)1, (uint64_t)ceil(percentile / 100 * total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++){
+        seen += counts[i];
+        if (seen >= target){
+            return min(HighestEquivalent(i), max_value);
+        }
+    }
+    return max_value;
+}
+#pragma endregion
+#pragma region Phase Scope Class
+/**
+ * @brief Enter a phase.
+ * @param p Phase to enter.
+**/
+phase_scope::phase_scope(const phase p){
+    active = c_running;
+    outer = c_phase;
+    if (active){
+        SwitchPhase(p);
+    }
+}
+/**
+ * @brief Go back to the phase that was running when the scope started.
+**/
+phase_scope::~phase_scope(){
+    if (active && c_running){
+        SwitchPhase(outer);
+    }
+}
+#pragma endregion
+#pragma region Public Functions
+/**
+ * @brief Set the latency from which operations are reported as slow by End().
+ * @param slow_ms Threshold in milliseconds.
+**/
+void latency::SetSlowThreshold(const uint64_t slow_ms){
+    c_slow_us = slow_ms * 1000;
+    return;
+}
+/**
+ * @brief Start timing an operation on this thread. Time is charged to PH_Other until a phase_scope says otherwise.
+**/
+void latency::Begin(){
+    c_running = 1;
+    c_phase = PH_Other;
+    for (uint8_t i = 0; i < PH_Count; i++){
+        c_phase_us[i] = 0;
+    }
+    c_mark = chrono::steady_clock::now();
+    return;
+}
+/**
+ * @brief Stop timing the operation of this thread and record its latency (time waiting for input left out).
+ * @param op Operation that was timed.
+ * @param sample Struct that will contain the operation timing.
+ * @returns 1(true) if the operation was slow (see SetSlowThreshold()), 0(false) if not or if no operation was being timed.
+**/
+bool latency::End(const operation op, s_sample& sample){
+    if (!c_running){
+        return 0;
+    }
+    SwitchPhase(PH_Other);
+    c_running = 0;
+    sample.op = op;
+    sample.total_us = 0;
+    for (uint8_t i = 0; i < PH_Count; i++){
+        sample.phase_us[i] = c_phase_us[i];
+        if (i != PH_Input){
+            sample.total_us += c_phase_us[i];
+        }
+    }
+    c_histograms[op].Record(sample.total_us);
+    return sample.total_us >= c_slow_us;
+}
+/**
+ * @brief Get the latency histogram of an operation.
+ * @param op Operation.
+ * @returns Histogram (microseconds).
+**/
+const histogram& latency::GetHistogram(const operation op){
+    return c_histograms[op];
+}
+/**
+ * @brief Get the name of an operation, for reports.
+ * @param op Operation.
+ * @returns Operation name.
+**/
+string latency::GetOperationName(const operation op){
+    switch (op){
+        case OP_Startup:
+            return "startup_check";
+        case OP_LogIn:
+            return "log_in";
+        case OP_Eat:
+            return "eat";
+        case OP_RegisterFood:
+            return "register_food";
+        case OP_ModifyFood:
+            return "modify_food";
+        case OP_BrowseHistory:
+            return "browse_history";
+        default:
+            return "unknown";
+    }
+}
+/**
+ * @brief Get the name of a phase, for reports.
+ * @param p Phase.
+ * @returns Phase name.
+**/
+string latency::GetPhaseName(const phase p){
+    switch (p){
+        case PH_Other:
+            return "other";
+        case PH_Input:
+            return "input";
+        case PH_Validation:
+            return "validation";
+        case PH_Parse:
+            return "parse";
+        case PH_Write:
+            return "write";
+        default:
+            return "unknown";
+    }
+}
+#pragma endregion
@@ -0,0 +1,84 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#ifndef _LATENCY_
+#define _LATENCY_
+
+namespace latency {
+#pragma region Data
+//Histogram precision: every power of 2 range is split in LATENCY_SUB_BUCKETS / 2 buckets (under 1.6% error). Power of 2.
+#define LATENCY_SUB_BUCKETS 128
+//Largest value histograms tell apart (microseconds, about 18 minutes). Larger values are recorded as this one.
+#define LATENCY_MAX_US (1ULL << 30)
+//Default slow operation threshold, in milliseconds.
+#define LATENCY_SLOW_MS 100
+/**
+ * @brief Where the time of an operation goes. PH_Other is time outside any phase (menus, output, computing). PH_Input (waiting for the user) is not part of the operation latency.
+**/
+enum phase {PH_Other, PH_Input, PH_Validation, PH_Parse, PH_Write, PH_Count};
+/**
+ * @brief Timed user visible operations.
+**/
+enum operation {OP_Startup, OP_LogIn, OP_Eat, OP_RegisterFood, OP_ModifyFood, OP_BrowseHistory, OP_Count};
+/**
+ * @brief Timing of a single operation.
+ * @param op (operation) Operation.
+ * @param total_us (uint64_t) Operation latency in microseconds (every phase but PH_Input).
+ * @param phase_us (uint64_t[PH_Count]) Microseconds spent in every phase.
+**/
+typedef struct {
+    operation op;
+    uint64_t total_us;
+    uint64_t phase_us[PH_Count];
+} s_sample;
+#pragma endregion
+#pragma region Histogram Class
+/**
+ * @brief Latency histogram with log-linear buckets (HdrHistogram style): fixed memory, constant time recording and percentiles with bounded relative error. Values are microseconds.
+**/
+class histogram {
+    //Public functions
+    public:
+    void Record(const uint64_t value);
+    uint64_t Count() const;
+    uint64_t Max() const;
+    uint64_t Percentile(const double percentile) const;
+
+    //Private data
+    private:
+    vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+
+    //Private functions
+    private:
+    static size_t Index(const uint64_t value);
+    static uint64_t HighestEquivalent(const size_t index);
+};
+#pragma endregion
+#pragma region Phase Scope Class
+/**
+ * @brief Charges the time spent in a scope to a phase of the operation running on this thread, if any (see Begin()). Nested scopes are charged to the innermost phase only.
+**/
+class phase_scope {
+    public:
+    phase_scope(const phase p);
+    ~phase_scope();
+    private:
+    phase outer;
+    bool active;
+};
+#pragma endregion
+#pragma region Public Function Headers
+void SetSlowThreshold(const uint64_t slow_ms);
+void Begin();
+bool End(const operation op, s_sample& sample);
+const histogram& GetHistogram(const operation op);
+string GetOperationName(const operation op);
+string GetPhaseName(const phase p);
+#pragma endregion
+}
+#endif
@@ -0,0 +1,159 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <filesystem>
+namespace fs = filesystem;
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include "nutrients.h"
+using namespace nutrients;
+#include "../io/io_fb.h"
+using namespace io_fb;
+#include "../filemanager/filemanager.h"
+namespace fm = filemanager;
+
+#pragma region Internal Use Functions
+//Built-in macros, in file order. Every schema starts with them.
+static const char* const base_names[NUM_OF_MACROS] = {"calories", "carbohydrates", "sugars", "protein", "fats"};
+static const char* const base_labels[NUM_OF_MACROS] = {"Calories(Kcal)", "Carbohydrates", "Sugars", "Protein", "Fats"};
+/**
+ * @brief Build the default schema (built-in macros only).
+ * @returns Default schema.
+**/
+s_schema DefaultSchema(){
+    s_schema schema;
+    schema.version = NUTRIENTS_BASE_VERSION;
+    for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
+        schema.names.push_back(base_names[i]);
+        schema.labels.push_back(base_labels[i]);
+    }
+    return schema;
+}
+/**
+ * @brief Transform a schema into a data string ready to dump into nutrients.dat.
+ * @param schema Schema to transform.
+ * @returns Formatted schema data string.
+**/
+string SchemaToData(const s_schema& schema){
+    //Labels keep their case, so they are not passed through strings::DataToFile().
+    string data = '{' + to_string(schema.version) + "}|";
+    for (size_t i = 0; i < schema.names.size(); i++){
+        data += '{' + schema.names[i] + '/' + schema.labels[i] + "}|";
+    }
+    return data;
+}
+/**
+ * @brief Checks if a string is a valid nutrient label (printable, without data separators).
+ * @param label Label to check.
+ * @returns 1(true) if label is valid, 0(false) if not.
+**/
+bool IsValidLabel(const string& label){
+    if (label.empty() || label.length() > MAX_USR_NAME){
+        return 0;
+    }
+    for (char c : label){
+        if (c < ' ' || c > '~' || c == '{' || c == '}' || c == '|' || c == '/'){
+            return 0;
+        }
+    }
+    return 1;
+}
+//Loaded schema. Starts as the default one, so macros can be handled before LoadSchema() runs.
+static s_schema c_schema = DefaultSchema();
+#pragma endregion
+#pragma region Public Functions
+/**
+ * @brief Check nutrient schema data without touching any file.
+ * @param file_data Whole nutrients.dat content.
+ * @param schema Optional pointer to return the parsed schema.
+ * @returns Possible ErrorCodes: EC_FileCorrupted; EC_None;
+**/
+ErrorCode nutrients::SchemaDataCheck(const string& file_data, s_schema* schema){
+    s_schema t_schema;
+    istringstream data_in(file_data);
+    string data;
+    //Get version
+    if (!getline(data_in, data, '|') || !data.starts_with('{') || !data.ends_with('}')){
+        return EC_FileCorrupted;
+    }
+    strings::RemoveBrackets(data);
+    if (!strings::IsNumericStr(data, Mode_UIntLong) || data.length() > 9 || stoul(data) < NUTRIENTS_BASE_VERSION){
+        return EC_FileCorrupted;
+    }
+    t_schema.version = stoul(data);
+    //Get nutrients
+    while (getline(data_in, data, '|')){
+        if (!data.starts_with('{') || !data.ends_with('}') || data.find('/') == string::npos){
+            return EC_FileCorrupted;
+        }
+        strings::RemoveBrackets(data);
+        string n_name = data.substr(0, data.find('/'));
+        string n_label = data.substr(data.find('/') + 1);
+        //Name must be a valid and unique in-file name, label must be printable.
+        if (!name::IsValidName(n_name, 1) || !IsValidLabel(n_label) || find(t_schema.names.begin(), t_schema.names.end(), n_name) != t_schema.names.end()){
+            return EC_FileCorrupted;
+        }
+        //Built-in macros must come first, in order.
+        if (t_schema.names.size() < NUM_OF_MACROS && n_name != base_names[t_schema.names.size()]){
+            return EC_FileCorrupted;
+        }
+        t_schema.names.push_back(n_name);
+        t_schema.labels.push_back(n_label);
+        if (t_schema.names.size() > MAX_NUTRIENTS){
+            return EC_FileCorrupted;
+        }
+    }
+    //Every built-in macro must be there.
+    if (t_schema.names.size() < NUM_OF_MACROS){
+        return EC_FileCorrupted;
+    }
+    //Return schema if asked
+    if (schema != NULL){
+        *schema = move(t_schema);
+    }
+    return EC_None;
+}
+/**
+ * @brief Load the nutrient schema from nutrients.dat. If the file does not exist (data folder created before schemas, or a new one), the default schema is written.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: fm::ReadFileData(); fm::CommitFile(); SchemaDataCheck();
+ * @warning A corrupted schema is NOT replaced: the data files depend on it, so it must be fixed by hand.
+**/
+ErrorCode nutrients::LoadSchema(){
+    //If schema does not exist, write the default one.
+    if (!fs::exists(nutrients_dat_p)){
+        c_schema = DefaultSchema();
+        return fm::CommitFile(nutrients_dat_p, SchemaToData(c_schema));
+    }
+    //Read and check schema
+    string file_data;
+    ErrorCode ec = fm::ReadFileData(nutrients_dat_p, file_data);
+    if (ec != EC_None){
+        return ec;
+    }
+    return SchemaDataCheck(file_data, &c_schema);
+}
+/**
+ * @brief Get the loaded nutrient schema.
+ * @returns Loaded schema (the default one if LoadSchema() was not called).
+**/
+const s_schema& nutrients::GetSchema(){
+    return c_schema;
+}
+/**
+ * @brief Get the amount of nutrients of the loaded schema.
+ * @returns Nutrient count, between NUM_OF_MACROS and MAX_NUTRIENTS.
+**/
+uint8_t nutrients::Count(){
+    return c_schema.names.size();
+}
+/**
+ * @brief Get the printed label of a nutrient.
+ * @param nutrient Nutrient index. Must be lower than Count().
+ * @returns Nutrient label.
+**/
+const string& nutrients::GetLabel(const uint8_t nutrient){
+    return c_schema.labels[nutrient];
+}
+#pragma endregion
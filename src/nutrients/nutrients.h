@@ -0,0 +1,35 @@
+#include "../errors/errors.h"
+#include "../io/io_fb.h"
+#include <vector>
+
+#ifndef _NUTRIENTS_
+#define _NUTRIENTS_
+
+#pragma region Paths
+#define nutrients_dat_p "data/nutrients.dat"
+#pragma endregion
+namespace nutrients {
+#pragma region Data
+//Version of the default schema (the NUM_OF_MACROS built-in macros).
+#define NUTRIENTS_BASE_VERSION 1
+/**
+ * @brief Nutrient schema (data/nutrients.dat), kept as struct-of-arrays: index i of every vector describes nutrient i, which is also value i of every macro set and data file. Schemas only grow: the first NUM_OF_MACROS nutrients are always the built-in macros, and files written under an older schema (fewer nutrients) are padded with 0 when validated.
+ * @param version (uint32_t) Schema version. Bump it when appending nutrients.
+ * @param names (vector<string>) In-file nutrient names.
+ * @param labels (vector<string>) Printed nutrient labels.
+**/
+typedef struct {
+    uint32_t version;
+    vector<string> names;
+    vector<string> labels;
+} s_schema;
+#pragma endregion
+#pragma region Public Function Headers
+ErrorCode SchemaDataCheck(const string& file_data, s_schema* schema = NULL);
+ErrorCode LoadSchema();
+const s_schema& GetSchema();
+uint8_t Count();
+const string& GetLabel(const uint8_t nutrient);
+#pragma endregion
+}
+#endif
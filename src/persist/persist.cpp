@@ -0,0 +1,313 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "persist.h"
+using namespace persist;
+#include "../filemanager/filemanager.h"
+namespace fm = filemanager;
+#include "../user/users.h"
+#include "../latency/latency.h"
+#include "../watcher/watcher.h"
+
+#pragma region Internal Use Functions
+//Single producer (UI thread), single consumer (persistence thread) ring. Slots from c_head to c_tail are queued; c_head only moves forward once a mutation is written.
+static s_mutation c_queue[PERSIST_QUEUE_SIZE];
+static atomic<uint64_t> c_head = 0;
+static atomic<uint64_t> c_tail = 0;
+//Time every queued mutation was queued at (latency statistics).
+static chrono::steady_clock::time_point c_queued_at[PERSIST_QUEUE_SIZE];
+//Queue position right after the last catalog mutation (catalog flushes wait for it).
+static atomic<uint64_t> c_catalog_tail = 0;
+//First write error since the last flush.
+static atomic<int> c_error = EC_None;
+//Persistence thread, its settings and its wake up requests (guarded by c_wake_mutex).
+static thread c_thread;
+static durability_mode c_mode = DM_Immediate;
+static chrono::milliseconds c_batch_ms(PERSIST_BATCH_MS);
+static mutex c_wake_mutex;
+static condition_variable c_wake;
+static bool c_wake_req = 0;
+static atomic<bool> c_stop = 0;
+//Group commit statistics (guarded by c_stats_mutex).
+static mutex c_stats_mutex;
+static s_stats c_stats = {};
+/**
+ * @brief Wake the persistence thread up so it writes everything queued, whatever the durability mode.
+**/
+void Wake(){
+    {
+        lock_guard<mutex> lock(c_wake_mutex);
+        c_wake_req = 1;
+    }
+    c_wake.notify_one();
+}
+/**
+ * @brief Write a mutation.
+ * @param mutation Mutation to write.
+ * @returns ErrorCodes thrown by any of these functions: food::CommitEat(); food::InternalRegisterFood(); food::InternalModifyFood(); user_lib::RegisterNewUser();
+**/
+ErrorCode Apply(const s_mutation& mutation){
+    switch (mutation.type){
+        case MT_Eat:
+            return food::CommitEat(mutation.usr, mutation.eat);
+        case MT_RegisterFood:
+            return food::InternalRegisterFood(mutation.usr, mutation.food_data);
+        case MT_ModifyFood:
+            return food::InternalModifyFood(mutation.usr, mutation.food_data);
+        case MT_RegisterUser:
+            return user_lib::RegisterNewUser(mutation.usr);
+    }
+    return EC_None;
+}
+/**
+ * @brief Take the first write error since the last call.
+ * @returns Error, or EC_None.
+**/
+ErrorCode TakeError(){
+    return static_cast<ErrorCode>(c_error.exchange(EC_None));
+}
+/**
+ * @brief Keep the first write error since the last flush.
+ * @param ec Error.
+**/
+void KeepError(const ErrorCode ec){
+    int none = EC_None;
+    if (ec != EC_None){
+        c_error.compare_exchange_strong(none, ec);
+    }
+}
+/**
+ * @brief Write a batch of queued mutations as a single group commit (see filemanager::BeginGroupCommit()): back-to-back eats of the same user and day become a single day file update, the catalog mutations of each user become a single catalog write (see food::CommitFoodChanges()), and every written file is flushed once, at the end. Mutations are only released (and flushes answered) once the whole batch is on disk.
+ * @param head Queue position of the first mutation.
+ * @param tail Queue position right after the last mutation.
+**/
+void WriteBatch(const uint64_t head, const uint64_t tail){
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    fm::BeginGroupCommit();
+    vector<food::s_eat> eats;
+    vector<food::s_food_change> changes;
+    for (uint64_t i = head; i < tail;){
+        s_mutation& mutation = c_queue[i % PERSIST_QUEUE_SIZE];
+        //Catalog mutation, gather every catalog mutation of the user in the batch. Eats do not read the catalog (see food::PrepareEat()), so they can be written in between.
+        if (mutation.type == MT_RegisterFood || mutation.type == MT_ModifyFood){
+            //Already written with an earlier mutation of the user.
+            if (mutation.usr.empty()){
+                i++;
+                continue;
+            }
+            changes.clear();
+            for (uint64_t j = i; j < tail; j++){
+                s_mutation& next = c_queue[j % PERSIST_QUEUE_SIZE];
+                if ((next.type == MT_RegisterFood || next.type == MT_ModifyFood) && (j == i || next.usr == mutation.usr)){
+                    changes.push_back({next.type == MT_ModifyFood, move(next.food_data)});
+                    if (j != i){
+                        next.usr.clear();
+                    }
+                }
+            }
+            //A single mutation is written as it is (a binary catalog modify is then written in place).
+            if (changes.size() == 1){
+                mutation.food_data = move(changes[0].food_data);
+                KeepError(Apply(mutation));
+            }
+            else {
+                KeepError(food::CommitFoodChanges(mutation.usr, changes.data(), changes.size()));
+            }
+            i++;
+            continue;
+        }
+        //Not an eat, write it as it is.
+        if (mutation.type != MT_Eat){
+            KeepError(Apply(mutation));
+            i++;
+            continue;
+        }
+        //Gather the eats that follow for the same user and day
+        eats.assign(1, mutation.eat);
+        for (i++; i < tail; i++){
+            s_mutation& next = c_queue[i % PERSIST_QUEUE_SIZE];
+            if (next.type != MT_Eat || next.usr != mutation.usr || next.eat.day.year != mutation.eat.day.year || next.eat.day.month != mutation.eat.day.month || next.eat.day.month_day != mutation.eat.day.month_day){
+                break;
+            }
+            eats.push_back(next.eat);
+        }
+        KeepError(food::CommitEats(mutation.usr, eats.data(), eats.size()));
+    }
+    size_t synced;
+    vector<filesystem::path> written;
+    KeepError(fm::EndGroupCommit(&synced, &written));
+    //Let the watcher tell these writes apart from outside changes.
+    watcher::NoteWrites(written);
+    //Batch is on disk. Update statistics and free slots.
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    {
+        lock_guard<mutex> lock(c_stats_mutex);
+        c_stats.batches++;
+        c_stats.mutations += tail - head;
+        c_stats.synced += synced;
+        c_stats.write_ms += chrono::duration<double, milli>(end - start).count();
+        for (uint64_t i = head; i < tail; i++){
+            double latency = chrono::duration<double, milli>(end - c_queued_at[i % PERSIST_QUEUE_SIZE]).count();
+            c_stats.latency_ms += latency;
+            c_stats.max_latency_ms = max(c_stats.max_latency_ms, latency);
+        }
+    }
+    for (uint64_t i = head; i < tail; i++){
+        c_queue[i % PERSIST_QUEUE_SIZE].usr.clear();
+        c_queue[i % PERSIST_QUEUE_SIZE].food_data.clear();
+    }
+    c_head.store(tail, memory_order_release);
+    c_head.notify_all();
+}
+/**
+ * @brief Persistence thread. Sleeps until the durability mode (or a flush) asks for a write, then writes everything queued, in order, as one group commit. Write errors are kept for the next flush; later mutations are still written.
+**/
+void PersistLoop(){
+    do {
+        //Wait for a write request
+        {
+            unique_lock<mutex> lock(c_wake_mutex);
+            auto requested = []{
+                return c_wake_req || c_stop || (c_mode == DM_Immediate && c_head != c_tail);
+            };
+            if (c_mode == DM_Batched){
+                c_wake.wait_for(lock, c_batch_ms, requested);
+            }
+            else {
+                c_wake.wait(lock, requested);
+            }
+            c_wake_req = 0;
+        }
+        //Write queued mutations
+        uint64_t head = c_head.load(memory_order_relaxed);
+        uint64_t tail = c_tail.load(memory_order_acquire);
+        if (head != tail){
+            WriteBatch(head, tail);
+        }
+    } while (!c_stop || c_head != c_tail);
+}
+#pragma endregion
+#pragma region Public Functions
+/**
+ * @brief Start the persistence thread. Until it is started, mutations are written as they are queued, by the caller. A running thread is stopped first (see Stop()).
+ * @param mode Durability mode.
+ * @param batch_ms Milliseconds between writes in batched mode.
+**/
+void persist::Start(const durability_mode mode, const unsigned long batch_ms){
+    Stop();
+    c_mode = mode;
+    c_batch_ms = chrono::milliseconds(batch_ms);
+    c_stop = 0;
+    c_thread = thread(PersistLoop);
+}
+/**
+ * @brief Write everything queued and stop the persistence thread. Call it before the program ends.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] First error thrown by Apply() since the last flush.
+**/
+ErrorCode persist::Stop(){
+    if (c_thread.joinable()){
+        {
+            lock_guard<mutex> lock(c_wake_mutex);
+            c_stop = 1;
+        }
+        c_wake.notify_one();
+        c_thread.join();
+    }
+    return TakeError();
+}
+/**
+ * @brief Queue a mutation. In-memory state should be updated by the caller, as the files may not be written for a while (see durability_mode). Waits only if the queue is full.
+ * @param mutation Mutation to queue. Its strings are moved into the queue.
+ * @returns Possible ErrorCodes: EC_None (always, if the thread is running);
+ * @returns [OR] ErrorCodes thrown by Apply() (if it is not).
+**/
+ErrorCode persist::Enqueue(s_mutation& mutation){
+    latency::phase_scope phase(latency::PH_Write);
+    //Not started, write it now.
+    if (!c_thread.joinable()){
+        return Apply(mutation);
+    }
+    //Wait for a free slot
+    uint64_t tail = c_tail.load(memory_order_relaxed);
+    uint64_t head;
+    while (tail - (head = c_head.load(memory_order_acquire)) == PERSIST_QUEUE_SIZE){
+        Wake();
+        c_head.wait(head);
+    }
+    //Fill slot and publish it
+    s_mutation& slot = c_queue[tail % PERSIST_QUEUE_SIZE];
+    slot.type = mutation.type;
+    slot.usr = move(mutation.usr);
+    slot.food_data = move(mutation.food_data);
+    slot.eat = mutation.eat;
+    c_queued_at[tail % PERSIST_QUEUE_SIZE] = chrono::steady_clock::now();
+    if (mutation.type != MT_Eat){
+        c_catalog_tail.store(tail + 1, memory_order_relaxed);
+    }
+    c_tail.store(tail + 1, memory_order_release);
+    //Let the thread know, if it writes right away. The lock keeps it from missing the new tail.
+    if (c_mode == DM_Immediate){
+        {
+            lock_guard<mutex> lock(c_wake_mutex);
+        }
+        c_wake.notify_one();
+    }
+    return EC_None;
+}
+/**
+ * @brief Register a new user through the queue, so users.dat is only written by the persistence thread, and wait until it is written (flush barrier), as the user files are created right after.
+ * @param name User friendly name to register (see user_lib::RegisterNewUser()).
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] ErrorCodes thrown by any of these functions: Enqueue(); Flush();
+**/
+ErrorCode persist::RegisterUser(const string& name){
+    s_mutation mutation = {MT_RegisterUser, name};
+    ErrorCode ec = Enqueue(mutation);
+    if (ec != EC_None){
+        return ec;
+    }
+    return Flush();
+}
+/**
+ * @brief Flush barrier. Waits until every mutation queued so far is written. Call it before reading files the queue may be writing, and before backups, restores and log outs.
+ * @param catalog_only If true, only waits for food catalog mutations (and everything queued before them).
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] First error thrown by Apply() since the last flush.
+**/
+ErrorCode persist::Flush(const bool catalog_only){
+    latency::phase_scope phase(latency::PH_Write);
+    uint64_t target = catalog_only ? c_catalog_tail.load(memory_order_relaxed) : c_tail.load(memory_order_relaxed);
+    uint64_t head = c_head.load(memory_order_acquire);
+    if (head < target){
+        Wake();
+        while ((head = c_head.load(memory_order_acquire)) < target){
+            c_head.wait(head);
+        }
+    }
+    return TakeError();
+}
+/**
+ * @brief Get group commit statistics since the program started.
+ * @param stats Struct that will contain the statistics.
+**/
+void persist::GetStats(s_stats& stats){
+    lock_guard<mutex> lock(c_stats_mutex);
+    stats = c_stats;
+}
+/**
+ * @brief Take the first write error since the last flush, without waiting for anything.
+ * @returns Possible ErrorCodes: EC_None;
+ * @returns [OR] First error thrown by Apply() since the last flush.
+**/
+ErrorCode persist::GetError(){
+    return TakeError();
+}
+#pragma endregion
@@ -0,0 +1,64 @@
+#include "../errors/errors.h"
+#include "../food/food.h"
+#include <string>
+
+#ifndef _PERSIST_
+#define _PERSIST_
+
+namespace persist {
+#pragma region Data
+//Mutations the queue holds. Power of 2. When it is full, queuing waits for the persistence thread to write some.
+#define PERSIST_QUEUE_SIZE 64
+//Default milliseconds between writes in batched mode.
+#define PERSIST_BATCH_MS 200
+/**
+ * @brief When queued mutations are written.
+ * DM_Immediate: as soon as they are queued. DM_Batched: every few milliseconds (see Start()). DM_OnExit: only on flush (Flush(), Stop()).
+**/
+enum durability_mode {DM_Immediate, DM_Batched, DM_OnExit};
+/**
+ * @brief Mutation types: eat (food::CommitEat()), register food (food::InternalRegisterFood()), modify food (food::InternalModifyFood()) and register user (user_lib::RegisterNewUser(), see RegisterUser()).
+**/
+enum mutation_type {MT_Eat, MT_RegisterFood, MT_ModifyFood, MT_RegisterUser};
+/**
+ * @brief Change to user files, written by the persistence thread.
+ * @param type (mutation_type) Mutation type.
+ * @param usr (string) User to target (in-file name), or user to register (MT_RegisterUser, user friendly name).
+ * @param food_data (string) Food data string (MT_RegisterFood and MT_ModifyFood only).
+ * @param eat (food::s_eat) Eat to write (MT_Eat only).
+**/
+typedef struct {
+    mutation_type type;
+    string usr;
+    string food_data;
+    food::s_eat eat;
+} s_mutation;
+/**
+ * @brief Group commit statistics. Every write of queued mutations is a batch, flushed to disk once (see filemanager::BeginGroupCommit()).
+ * @param batches (uint64_t) Batches written.
+ * @param mutations (uint64_t) Mutations written.
+ * @param synced (uint64_t) Files and folders flushed at the end of the batches.
+ * @param write_ms (double) Time spent writing and flushing batches.
+ * @param latency_ms (double) Sum of the time every mutation waited from being queued until it was on disk.
+ * @param max_latency_ms (double) Longest of those waits.
+**/
+typedef struct {
+    uint64_t batches;
+    uint64_t mutations;
+    uint64_t synced;
+    double write_ms;
+    double latency_ms;
+    double max_latency_ms;
+} s_stats;
+#pragma endregion
+#pragma region Public Function Headers
+void Start(const durability_mode mode, const unsigned long batch_ms = PERSIST_BATCH_MS);
+ErrorCode Stop();
+ErrorCode Enqueue(s_mutation& mutation);
+ErrorCode RegisterUser(const string& name);
+ErrorCode Flush(const bool catalog_only = 0);
+ErrorCode GetError();
+void GetStats(s_stats& stats);
+#pragma endregion
+}
+#endif
@@ -0,0 +1,185 @@
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include "profiler.h"
+using namespace profiler;
+#include "../filemanager/filemanager.h"
+namespace fm = filemanager;
+
+#pragma region Internal Use Functions
+//Whether spans are recorded, and the time they are measured from.
+static atomic<bool> c_enabled = 0;
+static chrono::steady_clock::time_point c_origin;
+//Finished spans (guarded by c_spans_mutex).
+static mutex c_spans_mutex;
+static vector<s_span> c_spans;
+//Innermost open span of this thread, and the thread number (0 until the thread opens a span).
+static thread_local span* c_top = NULL;
+static thread_local uint32_t c_thread_n = 0;
+static atomic<uint32_t> c_threads = 0;
+/**
+ * @brief Get microseconds since the profiler was enabled.
+ * @returns Microseconds.
+**/
+uint64_t NowUs(){
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - c_origin).count();
+}
+/**
+ * @brief Escape a string for a JSON string value.
+ * @param str String to escape.
+ * @returns Escaped string, without quotes.
+**/
+string EscapeJson(const string& str){
+    string out;
+    for (char c : str){
+        if (c == '"' || c == '\\'){
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)c < 0x20){
+            out += ' ';
+        }
+        else {
+            out += c;
+        }
+    }
+    return out;
+}
+#pragma endregion
+#pragma region Span Class
+/**
+ * @brief Open a span on this thread. Does nothing if the profiler is not enabled.
+ * @param phase Phase of the span.
+ * @param user User folder the span belongs to. If empty, the user of the enclosing span is used.
+ * @param open If 0(false), no span is opened (for scopes that are only a phase sometimes).
+**/
+span::span(const startup_phase phase, const string& user, const bool open){
+    if (!open || !c_enabled.load(memory_order_relaxed)){
+        return;
+    }
+    if (c_thread_n == 0){
+        c_thread_n = ++c_threads;
+    }
+    active = 1;
+    parent = c_top;
+    record = {phase, user.empty() && parent != NULL ? parent->record.user : user, c_thread_n, NowUs(), 0, 0, 0, 0, 0};
+    c_top = this;
+}
+/**
+ * @brief Close the span and keep it. Its duration is charged as nested time to the enclosing span.
+**/
+span::~span(){
+    if (!active){
+        return;
+    }
+    record.duration_us = NowUs() - record.start_us;
+    record.self_us = record.duration_us - min(nested_us, record.duration_us);
+    if (parent != NULL){
+        parent->nested_us += record.duration_us;
+    }
+    c_top = parent;
+    lock_guard<mutex> lock(c_spans_mutex);
+    c_spans.push_back(move(record));
+}
+#pragma endregion
+#pragma region Public Functions
+/**
+ * @brief Start or stop recording spans. Starting drops every span recorded before and restarts the clock; stopping keeps them (see GetSpans()).
+ * @param enabled 1(true) to start, 0(false) to stop.
+**/
+void profiler::Enable(const bool enabled){
+    if (enabled){
+        lock_guard<mutex> lock(c_spans_mutex);
+        c_spans.clear();
+        c_origin = chrono::steady_clock::now();
+    }
+    c_enabled = enabled;
+    return;
+}
+/**
+ * @brief Check if spans are being recorded.
+ * @returns 1(true) if they are, 0(false) if not.
+**/
+bool profiler::IsEnabled(){
+    return c_enabled.load(memory_order_relaxed);
+}
+/**
+ * @brief Count a file read by the innermost span of this thread, if any.
+ * @param bytes Bytes read.
+**/
+void profiler::CountRead(const uint64_t bytes){
+    if (c_top != NULL){
+        c_top->record.files++;
+        c_top->record.bytes += bytes;
+    }
+    return;
+}
+/**
+ * @brief Count a repair (file or folder written or removed) made by the innermost span of this thread, if any.
+**/
+void profiler::CountRepair(){
+    if (c_top != NULL){
+        c_top->record.repairs++;
+    }
+    return;
+}
+/**
+ * @brief Get the finished spans, in start order.
+ * @param spans Vector that will contain the spans.
+**/
+void profiler::GetSpans(vector<s_span>& spans){
+    {
+        lock_guard<mutex> lock(c_spans_mutex);
+        spans = c_spans;
+    }
+    stable_sort(spans.begin(), spans.end(), [](const s_span& a, const s_span& b){
+        return a.start_us < b.start_us;
+    });
+    return;
+}
+/**
+ * @brief Write the finished spans as a Chrome trace event file (complete "X" events, one track per thread), which trace viewers (chrome://tracing, Perfetto) open as it is.
+ * @param trace_p Path to the trace file. It is replaced.
+ * @returns ErrorCodes thrown by filemanager::CommitFile();
+**/
+ErrorCode profiler::WriteTrace(const filesystem::path& trace_p){
+    vector<s_span> spans;
+    GetSpans(spans);
+    string trace = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < spans.size(); i++){
+        const s_span& s = spans[i];
+        trace += i == 0 ? "\n" : ",\n";
+        trace += "{\"name\":\"" + GetPhaseName(s.phase) + "\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":" + to_string(s.thread);
+        trace += ",\"ts\":" + to_string(s.start_us) + ",\"dur\":" + to_string(s.duration_us) + ",\"args\":{\"user\":\"" + EscapeJson(s.user) + '"';
+        trace += ",\"self_us\":" + to_string(s.self_us) + ",\"files\":" + to_string(s.files) + ",\"bytes\":" + to_string(s.bytes) + ",\"repairs\":" + to_string(s.repairs) + "}}";
+    }
+    trace += "\n]}\n";
+    return fm::CommitFile(trace_p, trace);
+}
+/**
+ * @brief Get the name of a phase, for reports and traces.
+ * @param phase Phase.
+ * @returns Phase name.
+**/
+string profiler::GetPhaseName(const startup_phase phase){
+    switch (phase){
+        case SP_Startup:
+            return "startup_check";
+        case SP_DataFolder:
+            return "data_folder";
+        case SP_Schema:
+            return "schema";
+        case SP_UsrFolder:
+            return "usr_folder";
+        case SP_UserFolder:
+            return "user_folder";
+        case SP_TempRecovery:
+            return "temp_recovery";
+        case SP_Orphans:
+            return "orphans";
+        default:
+            return "unknown";
+    }
+}
+#pragma endregion
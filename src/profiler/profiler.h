@@ -0,0 +1,75 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include "../errors/errors.h"
+
+#ifndef _PROFILER_
+#define _PROFILER_
+
+namespace profiler {
+#pragma region Data
+/**
+ * @brief Phases of the initial files check. SP_Startup is the whole check; the rest are nested into it (SP_TempRecovery into the folder being checked).
+**/
+enum startup_phase {SP_Startup, SP_DataFolder, SP_Schema, SP_UsrFolder, SP_UserFolder, SP_TempRecovery, SP_Orphans, SP_Count};
+/**
+ * @brief A finished phase span.
+ * @param phase (startup_phase) Phase.
+ * @param user (string) User folder the span belongs to, empty if none. Nested spans inherit it.
+ * @param thread (uint32_t) Profiler thread number (1 is the first thread that opened a span).
+ * @param start_us (uint64_t) Start, in microseconds since Enable().
+ * @param duration_us (uint64_t) Duration in microseconds, nested spans included.
+ * @param self_us (uint64_t) Duration in microseconds, nested spans of the same thread left out.
+ * @param files (uint64_t) Files read inside the span (not inside nested spans).
+ * @param bytes (uint64_t) Bytes read inside the span (not inside nested spans).
+ * @param repairs (uint64_t) Files or folders written or removed inside the span (not inside nested spans).
+**/
+typedef struct {
+    startup_phase phase;
+    string user;
+    uint32_t thread;
+    uint64_t start_us;
+    uint64_t duration_us;
+    uint64_t self_us;
+    uint64_t files;
+    uint64_t bytes;
+    uint64_t repairs;
+} s_span;
+#pragma endregion
+#pragma region Span Class
+/**
+ * @brief Records the time, files, bytes and repairs of a scope as a phase span, if the profiler is enabled. Spans nest per thread.
+**/
+class span {
+    public:
+    span(const startup_phase phase, const string& user = "", const bool open = 1);
+    ~span();
+    span(const span&) = delete;
+    span& operator=(const span&) = delete;
+
+    //Private data
+    private:
+    s_span record;
+    uint64_t nested_us = 0;
+    span* parent = NULL;
+    bool active = 0;
+
+    //Counters reach the innermost span of the thread.
+    friend void CountRead(const uint64_t bytes);
+    friend void CountRepair();
+};
+#pragma endregion
+#pragma region Public Function Headers
+void Enable(const bool enabled);
+bool IsEnabled();
+void CountRead(const uint64_t bytes);
+void CountRepair();
+void GetSpans(vector<s_span>& spans);
+ErrorCode WriteTrace(const filesystem::path& trace_p);
+string GetPhaseName(const startup_phase phase);
+#pragma endregion
+}
+#endif
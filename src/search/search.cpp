@@ -0,0 +1,248 @@
+#include <algorithm>
+#include "search.h"
+using namespace search;
+
+#pragma region Internal Use Functions
+/**
+ * @brief Insert a match into a bounded result list, keeping it sorted by distance and then by name. If the list is full, the worst match is dropped.
+ * @param results Sorted result list.
+ * @param match Match to insert.
+ * @param k Maximum amount of results.
+**/
+void InsertMatch(vector<s_match>& results, const s_match& match, const size_t k){
+    auto better = [](const s_match& a, const s_match& b){
+        return a.distance != b.distance ? a.distance < b.distance : a.name < b.name;
+    };
+    //If list is full and match is not better than the worst one, skip it.
+    if (results.size() >= k && !better(match, results.back())){
+        return;
+    }
+    //Insert in order and drop the worst match if needed.
+    results.insert(upper_bound(results.begin(), results.end(), match, better), match);
+    if (results.size() > k){
+        results.pop_back();
+    }
+    return;
+}
+/**
+ * @brief Checks if a full result list can still accept a match with the given distance. Names are visited in alphabetical order, so a later name only wins with a strictly lower distance.
+ * @param results Sorted result list.
+ * @param distance Lowest distance the next matches can have.
+ * @param k Maximum amount of results.
+ * @returns 1(true) if a match with that distance could still enter the list, 0(false) if not.
+**/
+bool CanImprove(const vector<s_match>& results, const uint8_t distance, const size_t k){
+    return results.size() < k || distance < results.back().distance;
+}
+#pragma endregion
+#pragma region Name Index Class
+/**
+ * @brief Build the index from a list of names. Any previous content is discarded. Duplicated names are stored once.
+ * @param names Names to index. They are matched as given (use in-file names for case insensitive search).
+**/
+void name_index::Build(const vector<string>& names){
+    Clear();
+    //Sort names so children are always appended in order.
+    this->names = names;
+    sort(this->names.begin(), this->names.end());
+    this->names.erase(unique(this->names.begin(), this->names.end()), this->names.end());
+    //Insert every name
+    for (size_t i = 0; i < this->names.size(); i++){
+        uint32_t node = 0;
+        for (char c : this->names[i]){
+            uint32_t child = FindChild(node, c);
+            node = child != 0 ? child : AddChild(node, c);
+        }
+        nodes[node].name_id = i;
+    }
+    return;
+}
+/**
+ * @brief Remove every name from the index.
+**/
+void name_index::Clear(){
+    names.clear();
+    nodes.clear();
+    //Root node
+    nodes.push_back({0, 0, -1, '\0'});
+    return;
+}
+/**
+ * @brief Checks if the index has no names.
+ * @returns 1(true) if empty, 0(false) if not.
+**/
+bool name_index::IsEmpty(){
+    return names.empty();
+}
+/**
+ * @brief Get amount of indexed names.
+ * @returns Amount of names.
+**/
+size_t name_index::Size(){
+    return names.size();
+}
+/**
+ * @brief Checks if a name is indexed (exact match).
+ * @param name Name to search.
+ * @returns 1(true) if name is indexed, 0(false) if not.
+**/
+bool name_index::Contains(const string& name){
+    if (nodes.empty()){
+        return 0;
+    }
+    uint32_t node = 0;
+    for (char c : name){
+        node = FindChild(node, c);
+        if (node == 0){
+            return 0;
+        }
+    }
+    return nodes[node].name_id >= 0;
+}
+/**
+ * @brief Get the first K names (alphabetically) starting with the given prefix.
+ * @param prefix Prefix to complete. An empty prefix lists the first K names.
+ * @param k Maximum amount of results.
+ * @param results Vector that will contain the names. It will be cleared.
+**/
+void name_index::Complete(const string& prefix, const size_t k, vector<string>& results){
+    results.clear();
+    if (nodes.empty() || k == 0){
+        return;
+    }
+    //Walk prefix
+    uint32_t node = 0;
+    for (char c : prefix){
+        node = FindChild(node, c);
+        if (node == 0){
+            return;
+        }
+    }
+    //Collect subtree in alphabetical order
+    vector<s_match> matches;
+    CollectSubtree(node, 0, k, matches);
+    for (s_match& m : matches){
+        results.push_back(m.name);
+    }
+    return;
+}
+/**
+ * @brief Get the best K names for a query, tolerating typos. A name matches if some prefix of it is within the allowed edit distance of the query (0 for 1-2 characters, 1 for 3-5 characters, 2 for longer queries). Exact prefix matches come first.
+ * @param query Query string.
+ * @param k Maximum amount of results.
+ * @param results Vector that will contain the matches, ordered by distance and then by name. It will be cleared.
+**/
+void name_index::Match(const string& query, const size_t k, vector<s_match>& results){
+    results.clear();
+    if (nodes.empty() || k == 0){
+        return;
+    }
+    //Choose the allowed distance from query length.
+    uint8_t max_distance = query.size() <= 2 ? 0 : (query.size() <= 5 ? 1 : 2);
+    //First row: distance from the empty prefix to every query prefix.
+    vector<uint8_t> row(query.size() + 1);
+    for (size_t j = 0; j < row.size(); j++){
+        row[j] = min<size_t>(j, 255);
+    }
+    //Walk the trie
+    FuzzyWalk(0, query, row, row.back(), max_distance, k, results);
+    return;
+}
+/**
+ * @brief Find the child of a node with the given character.
+ * @param node Parent node.
+ * @param c Character to find.
+ * @returns Child node index, or 0 if not found.
+**/
+uint32_t name_index::FindChild(const uint32_t node, const char c){
+    for (uint32_t child = nodes[node].first_child; child != 0; child = nodes[child].next_sibling){
+        if (nodes[child].c == c){
+            return child;
+        }
+    }
+    return 0;
+}
+/**
+ * @brief Append a new child to a node. Children must be appended in character order.
+ * @param node Parent node.
+ * @param c Child character.
+ * @returns New child node index.
+**/
+uint32_t name_index::AddChild(const uint32_t node, const char c){
+    uint32_t child = nodes.size();
+    nodes.push_back({0, 0, -1, c});
+    //If first child, link it from the parent.
+    if (nodes[node].first_child == 0){
+        nodes[node].first_child = child;
+    }
+    //Else, link it after the last sibling.
+    else {
+        uint32_t last = nodes[node].first_child;
+        while (nodes[last].next_sibling != 0){
+            last = nodes[last].next_sibling;
+        }
+        nodes[last].next_sibling = child;
+    }
+    return child;
+}
+/**
+ * @brief Add every name of a subtree with the same distance, in alphabetical order, until the result list can no longer improve.
+ * @param node Subtree root.
+ * @param distance Distance assigned to every name.
+ * @param k Maximum amount of results.
+ * @param results Sorted result list.
+**/
+void name_index::CollectSubtree(const uint32_t node, const uint8_t distance, const size_t k, vector<s_match>& results){
+    if (!CanImprove(results, distance, k)){
+        return;
+    }
+    if (nodes[node].name_id >= 0){
+        InsertMatch(results, {names[nodes[node].name_id], distance}, k);
+    }
+    for (uint32_t child = nodes[node].first_child; child != 0; child = nodes[child].next_sibling){
+        CollectSubtree(child, distance, k, results);
+    }
+    return;
+}
+/**
+ * @brief Recursive edit distance walk (one Levenshtein row per trie level). Subtrees whose row can no longer reach the allowed distance are pruned.
+ * @param node Current node.
+ * @param query Query string.
+ * @param row Distances between the current node prefix and every query prefix.
+ * @param best Lowest distance between the whole query and any prefix on the current path.
+ * @param max_distance Allowed distance.
+ * @param k Maximum amount of results.
+ * @param results Sorted result list.
+**/
+void name_index::FuzzyWalk(const uint32_t node, const string& query, const vector<uint8_t>& row, const uint8_t best, const uint8_t max_distance, const size_t k, vector<s_match>& results){
+    //Row minimum is a lower bound for every deeper row.
+    uint8_t row_min = *min_element(row.begin(), row.end());
+    //If the query can no longer get closer, every name below shares the best distance.
+    if (row_min > max_distance || row_min >= best){
+        if (best <= max_distance){
+            CollectSubtree(node, best, k, results);
+        }
+        return;
+    }
+    //If nothing below can enter the result list, prune.
+    if (!CanImprove(results, row_min, k)){
+        return;
+    }
+    //Add this node name
+    if (nodes[node].name_id >= 0 && best <= max_distance){
+        InsertMatch(results, {names[nodes[node].name_id], best}, k);
+    }
+    //Compute child rows and descend
+    vector<uint8_t> next(row.size());
+    for (uint32_t child = nodes[node].first_child; child != 0; child = nodes[child].next_sibling){
+        char c = nodes[child].c;
+        next[0] = min(row[0] + 1, 255);
+        for (size_t j = 1; j < row.size(); j++){
+            uint8_t cost = query[j - 1] == c ? 0 : 1;
+            next[j] = min({row[j] + 1, next[j - 1] + 1, row[j - 1] + cost, 255});
+        }
+        FuzzyWalk(child, query, next, min(best, next.back()), max_distance, k, results);
+    }
+    return;
+}
+#pragma endregion
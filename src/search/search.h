@@ -0,0 +1,58 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <vector>
+
+#ifndef _SEARCH_
+#define _SEARCH_
+namespace search {
+#pragma region Data
+/**
+ * @brief Search result.
+ * @param name (string) Matched name.
+ * @param distance (uint8_t) Edit distance between the query and the closest prefix of the name. 0 means the query is an exact prefix.
+**/
+typedef struct {
+    string name;
+    uint8_t distance;
+} s_match;
+#pragma endregion
+#pragma region Name Index Class
+/**
+ * @brief Trie over a list of names. Supports prefix completion and typo tolerant matching (edit distance against name prefixes), returning the best K matches ordered by distance and then alphabetically.
+**/
+class name_index {
+    //Public functions
+    public:
+    void Build(const vector<string>& names);
+    void Clear();
+    bool IsEmpty();
+    size_t Size();
+    bool Contains(const string& name);
+    void Complete(const string& prefix, const size_t k, vector<string>& results);
+    void Match(const string& query, const size_t k, vector<s_match>& results);
+
+    //Private data
+    private:
+    /**
+     * @brief Trie node. Children are a sibling list sorted by character.
+    **/
+    typedef struct {
+        uint32_t first_child;
+        uint32_t next_sibling;
+        int32_t name_id;
+        char c;
+    } s_node;
+    vector<s_node> nodes;
+    vector<string> names;
+
+    //Private functions
+    private:
+    uint32_t FindChild(const uint32_t node, const char c);
+    uint32_t AddChild(const uint32_t node, const char c);
+    void CollectSubtree(const uint32_t node, const uint8_t distance, const size_t k, vector<s_match>& results);
+    void FuzzyWalk(const uint32_t node, const string& query, const vector<uint8_t>& row, const uint8_t best, const uint8_t max_distance, const size_t k, vector<s_match>& results);
+};
+#pragma endregion
+}
+#endif
@@ -3,30 +3,147 @@
 #include <chrono>
 using namespace std::chrono;
 #include <algorithm>
+#include <cstring>
 #include "user.h"
 #include "../food/food.h"
 #include "../filemanager/filemanager.h"
+#include "../backup/backup.h"
+#include "../events/events.h"
+#include "../nutrients/nutrients.h"
+#include "../watcher/watcher.h"
+#include "../persist/persist.h"
 
+#pragma region Internal Use Functions
+/**
+ * @brief Print macro label from macro index.
+ * @param macro_index Nutrient index (see nutrients::GetSchema()), or PORTION_INDEX for the portion size.
+**/
+void PrintMacro(const uint8_t macro_index){
+    string label = food::GetMacroLabel(macro_index);
+    if (label.empty()){
+        cout << "Macro not found.";
+    }
+    else {
+        cout << label << ": ";
+    }
+    return;
+}
+/**
+ * @brief Print restore progress on a single console line.
+ * @param done Files done.
+ * @param total Total files.
+**/
+void PrintRestoreProgress(const uint64_t done, const uint64_t total){
+    cout << '\r' << done << '/' << total << " files" << flush;
+    return;
+}
+/**
+ * @brief End the group commit of a write made from the menus (see filemanager::BeginGroupCommit()) and note the written files to the watcher, so they are not taken for outside changes (see watcher::NoteWrites()).
+ * @param written Files written outside the group (by other threads). Group files are added to them.
+ * @returns ErrorCodes thrown by filemanager::EndGroupCommit();
+**/
+ErrorCode EndNotedWrites(vector<filesystem::path> written = {}){
+    vector<filesystem::path> group;
+    ErrorCode ec = filemanager::EndGroupCommit(NULL, &group);
+    written.insert(written.end(), group.begin(), group.end());
+    watcher::NoteWrites(written);
+    return ec;
+}
+/**
+ * @brief Report problems found in validated backup files and, once the user agrees, write the valid ones into the user folder.
+ * @param usr User to restore.
+ * @param entries Entries read by backup::ReadRestoreFiles() or backup::ReadRestoreArchive().
+ * @returns Possible ErrorCodes: EC_UserCancelled; EC_FileNotFound (no valid files found); EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: backup::CommitRestoreFiles(); EndNotedWrites();
+**/
+ErrorCode CommitRestore(const string& usr, vector<backup::s_restore_entry>& entries){
+    //Report problems before restoring anything.
+    size_t valid = 0;
+    vector<string> report;
+    for (backup::s_restore_entry& entry : entries){
+        if (entry.status == EC_None){
+            valid++;
+            if (entry.repaired){
+                report.push_back(entry.path + ": invalid entries will be discarded.");
+            }
+        }
+        else if (entry.status == EC_WrongFile){
+            report.push_back(entry.path + ": not a user data file, skipped.");
+        }
+        else {
+            report.push_back(entry.path + ": corrupted, skipped.");
+        }
+    }
+    if (valid == 0){
+        cout << "\n\nNo valid files found in backup.\n";
+        input::ConsoleWait();
+        return EC_FileNotFound;
+    }
+    if (!report.empty()){
+        uint8_t num_input;
+        do {
+            ClearConsole;
+            cout << "Problems found in backup:\n\n";
+            for (string& line : report){
+                cout << line << '\n';
+            }
+            cout << "\nDo you want to restore the " << valid << " valid files?\n1.Yes\n2.No\n\n";
+            if (!input::GetNumericInput(&num_input, Mode_UInt8) || num_input == 2){
+                return EC_UserCancelled;
+            }
+        } while (num_input != 1);
+    }
+    //Restore data
+    ClearConsole;
+    cout << "Please wait while the restore is being done...\n";
+    filemanager::BeginGroupCommit();
+    ErrorCode ec = backup::CommitRestoreFiles(usr, entries, PrintRestoreProgress);
+    //Restored files are written by worker threads, so they are noted apart from the group (rebuilt maps and indexes).
+    vector<filesystem::path> restored;
+    for (backup::s_restore_entry& entry : entries){
+        if (entry.status == EC_None){
+            restored.push_back(filesystem::path(user_folder(usr)) / entry.path);
+        }
+    }
+    ErrorCode g_ec = EndNotedWrites(restored);
+    ec = ec != EC_None ? ec : g_ec;
+    if (ec != EC_None){
+        return ec;
+    }
+    cout << "\nData restored successfully.\n";
+    input::ConsoleWait();
+    return EC_None;
+}
+#pragma endregion
 #pragma region User Class
     #pragma region User
     /**
-     * @brief Asks the user for a backup directory from where to restore the current user files. If the same file is found, it will be replaced by the backed up.
+     * @brief Asks user for a backup directory or archive file and restores the user folder from it. If the directory holds snapshots of the user, the user chooses one of them (listed from snapshots.dat). Else, the directory must contain a plain copy of the user folder. Archives can be restored whole or one file at a time. Backups are read once and validated before anything is written; corrupted or unknown files are reported and skipped, and valid files are written atomically.
      * @returns Possible ErrorCodes: EC_UserCancelled; EC_DirNotFound; EC_None;
-     * @exception Possible exception error from filesystem::copy() unhandled.
-     * @exception Confirmed exception when back up directory is the same as the user directory (from & to are the same).
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); backup::ListSnapshots(); backup::ReadRestoreFiles(); CommitRestore(); RestoreArchive();
     **/
     ErrorCode user_lib::user::RestoreData(){
-        filesystem::path from, to = user_folder(username);
+        //Write pending changes, so they do not land over the restored files.
+        ErrorCode ec = persist::Flush();
+        if (ec != EC_None){
+            return ec;
+        }
+        filesystem::path root, from, to = user_folder(username);
         //Get valid backup path
         do {
             ClearConsole;
             //Get path input
-            cout << "Please input a backup directory or leave empty to cancel:\n";
+            cout << "Please input a backup directory or archive file, or leave empty to cancel:\n";
             string tmp_str;
             if (!input::GetStringInput(SM_Dir,tmp_str)){
                 return EC_UserCancelled;
             }
-            from = tmp_str;
+            root = tmp_str;
+            //If it is an archive file, restore from it.
+            if (filesystem::is_regular_file(root) && root.extension() == ARCHIVE_EXT){
+                return RestoreArchive(root);
+            }
+            from = root;
             from.append(username);
             //Path does not exist or is not a directory
             if (!filesystem::exists(from)){
@@ -46,21 +163,63 @@ using namespace std::chrono;
                 break;
             }
         } while(true);
-        //Restore data
+        //If directory holds snapshots, choose one.
+        vector<backup::s_snapshot> snapshots;
+        ec = backup::ListSnapshots(root, username, snapshots);
+        if (ec != EC_None && ec != EC_FileNotFound){
+            return ec;
+        }
+        if (!snapshots.empty()){
+            do {
+                ClearConsole;
+                cout << "Choose a snapshot to restore:\n\n";
+                for (size_t i = 0; i < snapshots.size(); i++){
+                    cout << '[' << (i + 1) << ']' << snapshots[i].name << " (" << snapshots[i].files << " files, ";
+                    cout << snapshots[i].bytes << " bytes)\n";
+                }
+                cout << '\n';
+                unsigned long chosen_s = 0;
+                if (!input::GetNumericInput(&chosen_s, Mode_UIntLong)){
+                    return EC_UserCancelled;
+                }
+                //If valid index selected, restore from that snapshot.
+                if (chosen_s > 0 && chosen_s <= snapshots.size()){
+                    from = backup::GetSnapshotPath(root, username, snapshots[chosen_s - 1].name);
+                    break;
+                }
+            } while(true);
+        }
+        //Read and validate backup files
         ClearConsole;
-        cout << "Please wait while the restore is being done...\n";
-        filesystem::copy(from, to, filesystem::copy_options::overwrite_existing | filesystem::copy_options::recursive);
-        cout << "Data restored successfully.\n";
-        input::ConsoleWait();
+        cout << "Checking backup files...\n";
+        vector<backup::s_restore_entry> entries;
+        ec = backup::ReadRestoreFiles(from, username, entries, PrintRestoreProgress);
+        if (ec != EC_None){
+            return ec;
+        }
+        //Report problems and restore valid files
+        ec = CommitRestore(username, entries);
+        if (ec == EC_FileNotFound){
+            return EC_None;
+        }
+        else if (ec != EC_None){
+            return ec;
+        }
+        food_index_ready = 0;
+        today_ready = 0;
         return EC_None;
     }
     /**
-     * @brief Asks user for an empty backup directory. Once the path is valid, it creates the backup of the current user folder.
+     * @brief Asks user for a backup directory and format. Once the path is valid, it creates either an incremental snapshot of the current user folder inside it (only files changed since the previous snapshot are copied, the rest are hard-linked) or a single compressed archive file.
      * @returns Possible ErrorCodes: EC_UserCancelled; EC_None;
-     * @returns [OR] ErrorCodes thrown by any of this functions: filemanager::SafeDeleteFile();
-     * @exception Possible exception error from filesystem::copy() unhandled.
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); filemanager::SafeDeleteFile(); backup::CreateSnapshot(); backup::CreateArchive();
     **/
     ErrorCode user_lib::user::BackupFiles(){
+        //Write pending changes, so the backup holds them.
+        ErrorCode ec = persist::Flush();
+        if (ec != EC_None){
+            return ec;
+        }
         filesystem::path to;
         //Get valid backup path
         do {
@@ -81,11 +240,6 @@ using namespace std::chrono;
                 cout << "Specify a directory, not a file. Try again.\n";
                 input::ConsoleWait();
             }
-            //Path is not empty
-            else if (!filesystem::is_empty(to)){
-                cout << "Directory is not empty. Try again.\n";
-                input::ConsoleWait();
-            }
             //Test path permission
             else {
                 filesystem::path test = to;
@@ -108,95 +262,127 @@ using namespace std::chrono;
                 }
             }
         } while(true);
-        //Do the copy
+        //Choose backup format
+        uint8_t num_input;
+        do {
+            ClearConsole;
+            cout << "Choose a backup format:\n1.Snapshot folder (incremental)\n2.Single archive file (compressed)\n\n";
+            if (!input::GetNumericInput(&num_input, Mode_UInt8)){
+                return EC_UserCancelled;
+            }
+        } while (num_input != 1 && num_input != 2);
         ClearConsole;
         cout << "Please wait while the copy is being done. Do not close the program.\n";
-        filesystem::copy(user_folder(username), to.append(username), filesystem::copy_options::recursive);
-        cout << "Copy successfully done.\n";
-        input::ConsoleWait();
-        return EC_None;
-    }  
-    /**
-     * @brief Creates all user files and folders for the current date (Daily data and user foods data).
-     * @warning It DOES refresh the common date object.
-     * @returns Possible ErrorCodes: EC_FileWriteNoPerm; EC_None;
-     * @returns [OR] ErrorCodes thrown by any of this functions: CreateDailyData();
-    **/
-    ErrorCode user_lib::user::CreateUserFiles(){
-        date::s_date date;
-        //Get current date and destroy object.
-        date::calendar* t_calendar = new date::calendar();
-        t_calendar->PassDateToStruct(date);
-        delete t_calendar;
-        //Create daily data and daily folder struct
-        if (!filesystem::exists(filemanager::GetDateDataPath(username, date))){
-            ErrorCode ec = CreateDailyData();
+        //Create archive
+        if (num_input == 2){
+            filesystem::path archive_p;
+            vector<backup::s_archive_entry> entries;
+            ec = backup::CreateArchive(to, username, archive_p, entries);
             if (ec != EC_None){
                 return ec;
             }
+            cout << "Archive " << archive_p.filename().string() << " created: " << entries.size() << " files, ";
+            cout << filesystem::file_size(archive_p) << " bytes.\n";
+            input::ConsoleWait();
+            return EC_None;
         }
-        //Create personal food
-        if (!filesystem::exists(foods_dat(username))){
-            ofstream data_out;
-            data_out.open(foods_dat(username));
-            if (!data_out.is_open()){
-                return EC_FileWriteNoPerm;
-            }
-            data_out.close();
+        //Create snapshot
+        backup::s_snapshot snapshot;
+        ec = backup::CreateSnapshot(to, username, snapshot);
+        if (ec != EC_None){
+            return ec;
         }
+        cout << "Snapshot " << snapshot.name << " created: " << snapshot.files << " files, ";
+        cout << snapshot.copied << " copied and " << (snapshot.files - snapshot.copied) << " unchanged.\n";
+        input::ConsoleWait();
         return EC_None;
-    }
+    }  
     /**
-     * @brief Creates day macro file and folder structure if missing.
-     * @warning It DOES refresh the common date object.
-     * @returns Possible ErrorCodes: EC_FileWriteNoPerm; EC_DirCreateNoPerm; EC_None;
+     * @brief Restore user files from an archive file. The user chooses to restore every file or a single one (read straight from the archive index). Archived files are decompressed into memory and validated before anything is written, like folder backups.
+     * @param archive_p Path to archive file.
+     * @returns Possible ErrorCodes: EC_UserCancelled; EC_None;
+     * @returns [OR] ErrorCodes thrown by any of this functions: backup::ReadArchiveIndex(); backup::ReadRestoreArchive(); CommitRestore();
     **/
-    ErrorCode user_lib::user::CreateDailyData(){
-        //Create date struct
-        date::s_date date;
-        //Get current date and destroy object.
-        date::calendar* t_calendar = new date::calendar();
-        t_calendar->PassDateToStruct(date);
-        delete t_calendar;
-        //If file (and as such, folder structure) do EXIST, exit to avoid overriding it.
-        filesystem::path path = filemanager::GetDateDataPath(username, date);
-        if (filesystem::exists(path)){
-            return EC_None;
+    ErrorCode user_lib::user::RestoreArchive(const filesystem::path& archive_p){
+        //Read archive index
+        vector<backup::s_archive_entry> files;
+        ErrorCode ec = backup::ReadArchiveIndex(archive_p, files);
+        if (ec != EC_None){
+            return ec;
         }
-        //If folder structure does not exist, create it.
-        if (!filesystem::exists(path.parent_path())){
-            if (!filesystem::create_directories(path.parent_path())){
-                return EC_DirCreateNoPerm;
+        //Choose what to restore
+        uint8_t num_input;
+        do {
+            ClearConsole;
+            cout << "Archive holds " << files.size() << " files.\n";
+            cout << "1.Restore all files\n2.Restore a single file\n\n";
+            if (!input::GetNumericInput(&num_input, Mode_UInt8)){
+                return EC_UserCancelled;
             }
+        } while (num_input != 1 && num_input != 2);
+        //Keep a single file
+        if (num_input == 2){
+            unsigned long chosen_f = 0;
+            do {
+                ClearConsole;
+                for (size_t i = 0; i < files.size(); i++){
+                    cout << '[' << (i + 1) << ']' << files[i].path << '\n';
+                }
+                cout << '\n';
+                if (!input::GetNumericInput(&chosen_f, Mode_UIntLong)){
+                    return EC_UserCancelled;
+                }
+            } while (chosen_f == 0 || chosen_f > files.size());
+            files = {files[chosen_f - 1]};
         }
-        //Create file.
-        ofstream data_out;
-        data_out.open(path);
-        if (!data_out.is_open()){
-            return EC_FileWriteNoPerm;
+        //Decompress and validate archived files
+        ClearConsole;
+        cout << "Checking archived files...\n";
+        vector<backup::s_restore_entry> entries;
+        ec = backup::ReadRestoreArchive(archive_p, files, username, entries, PrintRestoreProgress);
+        if (ec != EC_None){
+            return ec;
         }
-        for (uint8_t m = 0; m < NUM_OF_MACROS; m++){
-            data_out << "{0.0}|";
+        //Report problems and restore valid files
+        ec = CommitRestore(username, entries);
+        if (ec == EC_FileNotFound){
+            return EC_None;
         }
-        //Close and return.
-        data_out.close();
+        else if (ec != EC_None){
+            return ec;
+        }
+        food_index_ready = 0;
+        today_ready = 0;
         return EC_None;
     }
     /**
      * @brief Load user into this object. Username is transformed into an in-file name inside this function.
      * @param usrname User to log in. Will be transformed into in-file name, in case it isn't.
-     * @returns ErrorCodes thrown by private function CreateUserFiles();
+     * @returns ErrorCodes thrown by CreateUserFiles();
     **/
     ErrorCode user_lib::user::LoadUser(const string& usrname){
         username = name::NameToInFileName(usrname);
-        return CreateUserFiles();
+        food_index_ready = 0;
+        today_ready = 0;
+        ErrorCode ec = CreateUserFiles(username);
+        //Watch user files for outside changes. If the watcher can not start, changes will only be seen on the next login.
+        if (ec == EC_None){
+            watcher::Start(username);
+        }
+        return ec;
     };
     /**
-     * @brief Clear user name internally.
+     * @brief Write pending changes and clear user name internally. The user is logged out even if changes could not be written.
+     * @returns ErrorCodes thrown by persist::Flush();
     **/
-    void user_lib::user::LogOut(){
+    ErrorCode user_lib::user::LogOut(){
+        ErrorCode ec = persist::Flush();
+        watcher::Stop();
         username.clear();
-        return;
+        food_index.Clear();
+        food_index_ready = 0;
+        today_ready = 0;
+        return ec;
     }
     /**
      * @brief Returns user name in user friendly fashion.
@@ -205,10 +391,67 @@ using namespace std::chrono;
     string user_lib::user::GetUserName(){
         return name::InFileNameToName(username, 2);
     };
+    /**
+     * @brief Apply data file changes made from outside the program (reported by the watcher). Each changed file is validated again and the caches that depend on it are dropped, so the next read picks the new data.
+     * @returns Possible ErrorCodes: EC_ItemNotFound (user is no longer registered); EC_None;
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); filemanager::RevalidateFile(); filemanager::SetYearMapDay(); IsUsernameTaken();
+    **/
+    ErrorCode user_lib::user::SyncDataChanges(){
+        //Get changes
+        vector<watcher::s_invalidation> changes;
+        watcher::Poll(changes);
+        //Most changes are pending writes of this program. Let them finish, then drop them, so only outside changes are validated again.
+        if (!changes.empty()){
+            ErrorCode ec = persist::Flush();
+            if (ec != EC_None){
+                return ec;
+            }
+            watcher::DropOwnWrites(changes);
+        }
+        for (watcher::s_invalidation& c : changes){
+            //Validate file again
+            ErrorCode ec = filemanager::RevalidateFile(c.type, c.path);
+            if (ec != EC_None){
+                return ec;
+            }
+            //Drop dependent caches
+            switch (c.type){
+                //User must still be registered
+                case filemanager::users_dat: {
+                    ec = IsUsernameTaken(username);
+                    if (ec == EC_ItemNotFound){
+                        return EC_ItemNotFound;
+                    }
+                    else if (ec != EC_ItemFound){
+                        return ec;
+                    }
+                    break;
+                }
+                //Food catalog
+                case filemanager::usr_foods_dat: {
+                    food_index.Clear();
+                    food_index_ready = 0;
+                    break;
+                }
+                //Today's day file
+                case filemanager::x_day_dat: {
+                    today_ready = 0;
+                    ec = filemanager::SetYearMapDay(username, c.date, filesystem::exists(c.path));
+                    if (ec != EC_None){
+                        return ec;
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        return EC_None;
+    }
     /**
      * @brief Delete user process. The function will ask the user for confirmation and instructions. It can optionally backup user files. After confirmation and possible backup are done, user files are deleted and user name is removed from users.dat.
-     * @returns Possible returns: EC_UserCancelled; EC_FileReadNoPerm; EC_FileWriteNoPerm; EC_None;
-     * @returns [OR] ErrorCodes thrown by any of this functions: BackupFiles(); filemanager::SafeDeleteFolder(); filemanager::SafeDeleteFile(); filemanager::UsersDataCheck(); filemanager::CreateTempFile();
+     * @returns Possible returns: EC_UserCancelled; EC_None;
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); BackupFiles(); RemoveUser(); LogOut();
     **/
     ErrorCode user_lib::user::DeleteUser(){
         //Confirm deletion
@@ -252,69 +495,25 @@ using namespace std::chrono;
                 break;
             }
         } while(true);
-        //Delete user files
-        filesystem::path mut_path = user_folder(username);
-        ec = filemanager::SafeDeleteFolder(mut_path);
-        if (ec != EC_None){
-            return ec;
-        }
-        //Check if users.dat is valid
-        ec = filemanager::UsersDataCheck();
-        if (ec != EC_None){
-            return ec;
-        }
-        //Create temp file
-        mut_path = users_dat_p;
-        filesystem::path usersdat_tmp;
-        ec = filemanager::CreateTempFile(mut_path, usersdat_tmp);
+        //Write pending changes, then delete user files and unregister user
+        ec = persist::Flush();
         if (ec != EC_None){
             return ec;
         }
-        //Open temp file to read
-        ifstream data_in;
-        data_in.open(usersdat_tmp);
-        if (!data_in.is_open()){
-            return EC_FileReadNoPerm;
-        }
-        //Open original file to modify
-        ofstream data_out;
-        data_out.open(mut_path);
-        if(!data_out.is_open()){
-            data_in.close();
-            return EC_FileWriteNoPerm;
-        }
-        //Pass data skipping target name
-        string data;
-        while (getline(data_in, data, '|')){
-            //If data is not _END_
-            if (data != "_END_"){
-                //Remove brackets
-                strings::RemoveBrackets(data);                  
-                //If data is not username, re-input data.
-                if (data != username){
-                    data_out << strings::DataToFile(data);
-                }
-            }
-        }
-        //Close files
-        data_in.close();
-        data_out.close();
-        //Delete temp file
-        ec = filemanager::SafeDeleteFile(usersdat_tmp);
+        ec = RemoveUser(username);
         if (ec != EC_None){
             return ec;
         }
         //Log out and return.
-        LogOut();
-        return EC_None;
+        return LogOut();
     }
     #pragma endregion 
     #pragma region Food
     /**
      * @brief Asks the user for a food name and size. Size can be given in portions or grams, something the user gets to choose before.
      * @returns Possible ErrorCodes: EC_UserCancelled;
-     * @returns [OR] ErrorCodes thrown by any of this functions: CreateDailyData(); food::IsFoodRegistered(); food::InternalEatFood; food::PrintFoodList();
-     * @warning Daily data file is not directly checked by this function. It is done inside food::InternalEatFood();
+     * @returns [OR] ErrorCodes thrown by any of this functions: SearchFood(); SelectFood(); persist::Flush(); food::IsFoodRegistered(); food::PrepareEat(); persist::Enqueue();
+     * @warning Daily data file is not directly checked by this function. It is done when the eat is written (food::CommitEat()).
     **/
     ErrorCode user_lib::user::EatFood(){
         uint8_t num_input;
@@ -333,43 +532,34 @@ using namespace std::chrono;
             }
             //Enter food name.
             if (num_input == 1){
-                //Ask for food name and break.
-                do {
-                    ClearConsole;
-                    cout << "What did you eat? (leave empty to cancel): ";
-                    input::GetStringInput(SM_FoodName, food);
-                    break;
-                } while(true);
+                //Search food, retry options if cancelled.
+                ec = SearchFood(food);
+                if (ec == EC_UserCancelled){
+                    food.clear();
+                }
+                else if (ec != EC_None){
+                    return ec;
+                }
             }
             //List all foods and select one.
             else if (num_input == 2){
-                do {
-                    ClearConsole;
-                    //Print and retrieve all foods.
-                    vector<string> foods;
-                    ec = food::PrintFoodList(username, foods);
-                    if (ec != EC_None){
-                        return ec;
-                    }
-                    //Select food
-                    cout << '\n';
-                    unsigned long chosen_f = 0;
-                    if (!input::GetNumericInput(&chosen_f, Mode_UIntLong)){
-                        break;
-                    }
-                    //If valid index selected, save food and break loop.
-                    else if (chosen_f > 0 && chosen_f <= foods.size()){
-                        //Get food
-                        food = foods[chosen_f - 1];
-                        break;
-                    }
-                } while (true);
+                //Select food, retry options if cancelled.
+                ec = SelectFood(food);
+                if (ec == EC_UserCancelled){
+                    food.clear();
+                }
+                else if (ec != EC_None){
+                    return ec;
+                }
             }
         } while(food.empty());
         ClearConsole;
-        //Validate user_foods.dat
-        filesystem::path userfoods = foods_dat(username);
-        ec = filemanager::UserFoodsDatCheck(userfoods);
+        //Write pending catalog changes and validate user food catalog
+        ec = persist::Flush(1);
+        if (ec != EC_None){
+            return ec;
+        }
+        ec = filemanager::UserFoodsCheck(username);
         if (ec != EC_None){
             return ec;
         }
@@ -393,6 +583,7 @@ using namespace std::chrono;
             }
             //Prompt selected option
             ClearConsole;
+            bool portions;
             switch(input) {
                 //Ask for amount of portions.
                 case 1: {
@@ -400,13 +591,8 @@ using namespace std::chrono;
                     if (!input::GetNumericInput(&amount, Mode_UIntLong) || amount == 0){
                         return EC_UserCancelled;
                     }
-                    //Daily data safety check (in case data was maliciously deleted)
-                    ec = CreateDailyData();
-                    if (ec != EC_None){
-                        return ec;
-                    }
-                    //Eat food
-                    return food::InternalEatFood(username, food, amount, 1);
+                    portions = 1;
+                    break;
                 }
                 //Ask for amount of grams.
                 case 2: {
@@ -414,44 +600,77 @@ using namespace std::chrono;
                     if (!input::GetNumericInput(&amount, Mode_UIntLong) || amount == 0){
                         return EC_UserCancelled;
                     }
-                    //Daily data safety check (in case data was maliciously deleted)
-                    ec = CreateDailyData();
-                    if (ec != EC_None){
-                        return ec;
-                    }
-                    //Eat food
-                    return food::InternalEatFood(username, food, amount, 0);
+                    portions = 0;
+                    break;
                 }
                 //Option not valid, retry.
                 default: {
-                    break;
+                    continue;
                 }
             }
+            //Eat food and add it to today's cached totals. Files are written in the background.
+            persist::s_mutation eat = {persist::MT_Eat, username};
+            ec = food::PrepareEat(username, food, amount, portions, eat.eat);
+            if (ec != EC_None){
+                return ec;
+            }
+            if (today_ready && eat.eat.day.year == today_date.year && eat.eat.day.month == today_date.month && eat.eat.day.month_day == today_date.month_day){
+                today_macros += eat.eat.nutrients;
+            }
+            else {
+                today_ready = 0;
+            }
+            return persist::Enqueue(eat);
         } while (true);
     }
     /**
-     * @brief Remove food form. Asks the user for generic string input.
+     * @brief Remove food form. Lets the user enter a food name or choose it from the paged food list.
      * @returns Possible ErrorCodes: EC_UserCancelled;
-     * @returns [OR] ErrorCodes thrown by any of this functions: food::InternalRemoveFood();
+     * @returns [OR] ErrorCodes thrown by any of this functions: SearchFood(); SelectFood(); persist::Flush(); food::InternalRemoveFood(); EndNotedWrites();
     **/
     ErrorCode user_lib::user::RemoveFood(){
-        ClearConsole;
-        cout << "Enter food name (empty to cancel): ";
-        //Get food name
+        uint8_t num_input;
+        ErrorCode ec;
         string food;
-        if (!input::GetStringInput(SM_FoodName, food)){
-            return EC_UserCancelled;
+        //Select mode to enter food.
+        do {
+            num_input = 0;
+            food.clear();
+            //Print options.
+            ClearConsole;
+            cout << "1.Enter food name\n2.List all foods\n\n";
+            //Get user input.
+            if (!input::GetNumericInput(&num_input, Mode_UInt8)){
+                return EC_UserCancelled;
+            }
+            //Enter food name or list all foods.
+            if (num_input == 1 || num_input == 2){
+                ec = num_input == 1 ? SearchFood(food) : SelectFood(food);
+                //Retry options if cancelled.
+                if (ec == EC_UserCancelled){
+                    food.clear();
+                }
+                else if (ec != EC_None){
+                    return ec;
+                }
+            }
+        } while(food.empty());
+        //Write pending catalog changes and actually remove food
+        ec = persist::Flush(1);
+        if (ec != EC_None){
+            return ec;
         }
-        //Transform food to in file name
-        food = name::NameToInFileName(food);
-        //Actually remove food
-        return food::InternalRemoveFood(username, food);
+        food_index_ready = 0;
+        filemanager::BeginGroupCommit();
+        ec = food::InternalRemoveFood(username, food);
+        ErrorCode g_ec = EndNotedWrites();
+        return ec != EC_None ? ec : g_ec;
     }
     /**
      * @brief Modify food form. Asks the user for a food name, macros and portion size, and replaces the old food data.
      * @param food Optional food name, defaulted at NULL. If not defined, function will allocate a new string inside of it and ask the user for a food name.
      * @returns Possible ErrorCodes: EC_UserCancelled;
-     * @returns [OR] ErrorCodes thrown by any of these functions: food::IsFoodRegistered(); food::InternalModifyFood();
+     * @returns [OR] ErrorCodes thrown by any of these functions: persist::Flush(); food::IsFoodRegistered(); persist::Enqueue();
     **/
     ErrorCode user_lib::user::ModifyFood(string* food){
         //Ask for food name or use provided
@@ -467,8 +686,12 @@ using namespace std::chrono;
         }
         //Transform food into in-file name.
         *food = name::NameToInFileName(*food);
-        //Check if food exist
-        ErrorCode ec = food::IsFoodRegistered(username, *food);
+        //Write pending catalog changes and check if food exist
+        ErrorCode ec = persist::Flush(1);
+        if (ec != EC_None){
+            return ec;
+        }
+        ec = food::IsFoodRegistered(username, *food);
         if (ec != EC_ItemFound){
             return ec;
         }
@@ -483,8 +706,8 @@ using namespace std::chrono;
         }
         //Enter macros
         double number_input;
-        for (uint8_t i = 0; i < NUM_OF_MACROS; i++) {
-            food::PrintMacro(i);
+        for (uint8_t i = 0; i < nutrients::Count(); i++) {
+            PrintMacro(i);
             cout << '\n';
             //Get macro value
             if (!input::GetNumericInput(&number_input, Mode_Double)){
@@ -495,19 +718,20 @@ using namespace std::chrono;
             //Close macro with '/'
             food->append("/");
             //If at the last macro, append the portion size at the end
-            if (i + 1 == NUM_OF_MACROS){
+            if (i + 1 == nutrients::Count()){
                 food->append(to_string(portion));
             }
         }
         //Prepare food data string
         *food = strings::DataToFile(*food);
-        //Call internal modify
-        return food::InternalModifyFood(username, *food);
+        //Queue internal modify
+        persist::s_mutation modify = {persist::MT_ModifyFood, username, *food};
+        return persist::Enqueue(modify);
     }
     /**
      * @brief Register food form. Asks the user for a food name, macros and portion size. Checks if food is already registered. If it is, asks the user if he wants to modify it.
      * @returns Possible ErrorCodes: EC_UserCancelled;
-     * @returns [OR] ErrorCodes thrown by any of this functions: ModifyFood(); food::IsFoodRegistered(); food::InternalRegisterFood();
+     * @returns [OR] ErrorCodes thrown by any of this functions: ModifyFood(); persist::Flush(); food::IsFoodRegistered(); persist::Enqueue();
     **/
     ErrorCode user_lib::user::RegisterFood(){
         string food;
@@ -518,9 +742,12 @@ using namespace std::chrono;
             if (!input::GetStringInput(SM_FoodName, food)){
                 return EC_UserCancelled;
             }
-            //Validate usr_foods.dat
-            filesystem::path foods_p = foods_dat(username);
-            ErrorCode ec = filemanager::UserFoodsDatCheck(foods_p);
+            //Write pending catalog changes and validate user food catalog
+            ErrorCode ec = persist::Flush(1);
+            if (ec != EC_None){
+                return ec;
+            }
+            ec = filemanager::UserFoodsCheck(username);
             if (ec != EC_None && ec != EC_FileEmpty){
                 return ec;
             }
@@ -574,9 +801,9 @@ using namespace std::chrono;
         }
         //Ask the user for every macro value related to the portion size.
         double in_macro;
-        for (uint8_t i = 0; i < NUM_OF_MACROS; i++) {
+        for (uint8_t i = 0; i < nutrients::Count(); i++) {
             //Print macro label
-            food::PrintMacro(i);
+            PrintMacro(i);
             cout << '\n';
             //Get macro
             if (!input::GetNumericInput(&in_macro, Mode_Double)){
@@ -587,21 +814,28 @@ using namespace std::chrono;
             //Close macro with '/'
             food.append("/");
             //If at the last macro, append the portion size at the end.
-            if (i + 1 == NUM_OF_MACROS){
+            if (i + 1 == nutrients::Count()){
                 food.append(to_string(portion));
             }
         }
         //Format food string to data string
         food = strings::DataToFile(food);
-        //Pass food string into InternalRegisterFood, where actual register takes place.
-        return food::InternalRegisterFood(username, food);
+        //Queue food string for InternalRegisterFood, where actual register takes place.
+        food_index_ready = 0;
+        persist::s_mutation reg = {persist::MT_RegisterFood, username, food};
+        return persist::Enqueue(reg);
     }
     /**
      * @brief Allows user to navigate through the foods registry, consulting food names and macros.
      * @returns Possible ErrorCodes: EC_UserCancelled; EC_FileReadNoPerm;
-     * @returns [OR] ErrorCodes thrown by any of this functions: food::PrintFoodList(); food::GetFoodData();
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); SearchFood(); SelectFood(); food::GetFoodData();
     **/
     ErrorCode user_lib::user::FoodBook(){
+        //Write pending catalog changes
+        ErrorCode ec = persist::Flush(1);
+        if (ec != EC_None){
+            return ec;
+        }
         uint8_t num_input;
         do {
             //Print options.
@@ -614,127 +848,307 @@ using namespace std::chrono;
             //Enter food name.
             if (num_input == 1){
                 do {
-                    ClearConsole;
-                    cout << "Enter a food name (empty to cancel): ";
-                    //Get user input.
+                    //Search food
                     string input;
-                    if (!input::GetStringInput(SM_FoodName, input)){
+                    ErrorCode ec = SearchFood(input);
+                    if (ec == EC_UserCancelled){
                         break;
                     }
-                    vector<double> macros;
-                    //Transform name to in file name
-                    input = name::NameToInFileName(input);
+                    else if (ec != EC_None){
+                        return ec;
+                    }
                     //Get food data
-                    ErrorCode ec = food::GetFoodData(username, input, macros);
-                    //If food is not found
-                    if (ec == EC_ItemNotFound){
-                        ClearConsole;
-                        cout << "Food doesn't exist.\n";
-                        input::ConsoleWait();
+                    food_macros macros;
+                    ec = food::GetFoodData(username, input, macros);
+                    if (ec != EC_None){
+                        return ec;
                     }
-                    //Macros retrieved
-                    else if (ec == EC_None){
-                        ClearConsole;
-                        //Print food name
-                        cout << name::InFileNameToName(input,1) << ":\n\n";
-                        //Mutiply macros by portion size
-                        for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-                            macros[i] *= macros[NUM_OF_MACROS];
-                        }
-                        //Print all macros
-                        for (uint8_t i = 0; i < NUM_OF_MACROS + 1; i++){
-                            food::PrintMacro(i);
-                            cout << macros[i] << '\n';
-                        }
-                        cout << '\n';
-                        //Wait for user confirmation.
-                        input::ConsoleWait();
+                    ClearConsole;
+                    //Print food name
+                    cout << name::InFileNameToName(input,1) << ":\n\n";
+                    //Mutiply macros by portion size
+                    for (uint8_t i = 0; i < nutrients::Count(); i++){
+                        macros[i] *= macros[PORTION_INDEX];
                     }
-                    //If there was an error, return it.
-                    else {
-                        return ec;
+                    //Print all macros and portion size
+                    for (uint8_t i = 0; i < nutrients::Count(); i++){
+                        PrintMacro(i);
+                        cout << macros[i] << '\n';
                     }
+                    PrintMacro(PORTION_INDEX);
+                    cout << macros[PORTION_INDEX] << '\n';
+                    cout << '\n';
+                    //Wait for user confirmation.
+                    input::ConsoleWait();
                 } while(true);
             }
             //List all foods and select one.
             else if (num_input == 2){
-                do {
-                    ClearConsole;
-                    vector<string> foods;
-                    ErrorCode ec = food::PrintFoodList(username, foods);
-                    //If there was a problem, return error.
-                    if (ec != EC_None){
-                        return ec;
-                    }
-                    //Select food
-                    cout << '\n';
-                    string food;
-                    unsigned long chosen_f = 0;
-                    if (!input::GetNumericInput(&chosen_f, Mode_UIntLong)){
-                        break;
-                    }
-                    //If valid index selected, print food macros.
-                    else if (chosen_f > 0 && chosen_f <= foods.size()){
-                        //Get food
-                        food = foods[chosen_f - 1];
-                        ClearConsole;
-                        //Get food macros
-                        vector<double> macros;
-                        ec = food::GetFoodData(username, food, macros);
-                        if (ec != EC_None){
-                            return ec;
-                        }
-                        //Mutiply macros by portion size
-                        for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-                            macros[i] *= macros[NUM_OF_MACROS];
-                        }
-                        //Print food name
-                        cout << name::InFileNameToName(food, 1) << ":\n\n";
-                        //Print all macros
-                        for (uint8_t i = 0; i < NUM_OF_MACROS + 1; i++){
-                            food::PrintMacro(i);
-                            cout << macros[i] << '\n';
-                        }
-                        cout << '\n';
-                        //Wait for user confirmation.
-                        input::ConsoleWait();
-                        break;
-                    }
-                    //Invalid index selected, retry.
-                    else {
-                        cout << "Choose a valid food.\n";
-                        input::ConsoleWait();
-                    }
-                } while (true);
+                //Select food, back to options if cancelled.
+                string food;
+                ErrorCode ec = SelectFood(food);
+                if (ec == EC_UserCancelled){
+                    continue;
+                }
+                else if (ec != EC_None){
+                    return ec;
+                }
+                ClearConsole;
+                //Get food macros
+                food_macros macros;
+                ec = food::GetFoodData(username, food, macros);
+                if (ec != EC_None){
+                    return ec;
+                }
+                //Mutiply macros by portion size
+                for (uint8_t i = 0; i < nutrients::Count(); i++){
+                    macros[i] *= macros[PORTION_INDEX];
+                }
+                //Print food name
+                cout << name::InFileNameToName(food, 1) << ":\n\n";
+                //Print all macros and portion size
+                for (uint8_t i = 0; i < nutrients::Count(); i++){
+                    PrintMacro(i);
+                    cout << macros[i] << '\n';
+                }
+                PrintMacro(PORTION_INDEX);
+                cout << macros[PORTION_INDEX] << '\n';
+                cout << '\n';
+                //Wait for user confirmation.
+                input::ConsoleWait();
             }
         } while(true);
         return EC_UserCancelled;
     }
+    /**
+     * @brief Lets the user switch the food book between the text format and the binary format (faster lookups and updates on big food books).
+     * @returns Possible ErrorCodes: EC_UserCancelled; EC_None;
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); food::ConvertFoodCatalog(); EndNotedWrites();
+    **/
+    ErrorCode user_lib::user::ConvertFoodBook(){
+        //Write pending catalog changes
+        ErrorCode ec = persist::Flush(1);
+        if (ec != EC_None){
+            return ec;
+        }
+        bool binary = food::IsCatalogBinary(username);
+        uint8_t num_input;
+        do {
+            ClearConsole;
+            cout << "Food book format: " << (binary ? "binary" : "text") << ".\n";
+            cout << "Do you want to convert it to " << (binary ? "text" : "binary") << " format?\n";
+            cout << "1.Yes\n2.No\n\n";
+            if (!input::GetNumericInput(&num_input, Mode_UInt8) || num_input == 2){
+                return EC_UserCancelled;
+            }
+        } while (num_input != 1);
+        //Convert catalog
+        filemanager::BeginGroupCommit();
+        ec = food::ConvertFoodCatalog(username, !binary);
+        ErrorCode g_ec = EndNotedWrites();
+        ec = ec != EC_None ? ec : g_ec;
+        if (ec != EC_None){
+            return ec;
+        }
+        cout << "Food book converted.\n";
+        input::ConsoleWait();
+        return EC_None;
+    }
+    /**
+     * @brief Build the food search index from the user food catalog, if it is not built already.
+     * @returns Possible ErrorCodes: EC_None;
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); food::GetFoodNames();
+    **/
+    ErrorCode user_lib::user::LoadFoodIndex(){
+        //Index is up to date, return.
+        if (food_index_ready){
+            return EC_None;
+        }
+        //Write pending catalog changes
+        ErrorCode ec = persist::Flush(1);
+        if (ec != EC_None){
+            return ec;
+        }
+        //Get food names and build index
+        vector<string> foods;
+        ec = food::GetFoodNames(username, foods);
+        if (ec != EC_None){
+            food_index.Clear();
+            return ec;
+        }
+        food_index.Build(foods);
+        food_index_ready = 1;
+        return EC_None;
+    }
+    /**
+     * @brief Search food form. Asks the user for a food name. If it is not registered, it suggests the closest names (prefix completion with typo tolerance) to choose from.
+     * @param food String that will contain the chosen in-file food name.
+     * @returns Possible ErrorCodes: EC_UserCancelled; EC_FileEmpty; EC_None;
+     * @returns [OR] ErrorCodes thrown by LoadFoodIndex();
+    **/
+    ErrorCode user_lib::user::SearchFood(string& food){
+        //Load index
+        ErrorCode ec = LoadFoodIndex();
+        if (ec != EC_None){
+            return ec;
+        }
+        if (food_index.IsEmpty()){
+            return EC_FileEmpty;
+        }
+        do {
+            ClearConsole;
+            cout << "Enter a food name (empty to cancel): ";
+            //Get food name
+            string input;
+            if (!input::GetStringInput(SM_FoodName, input)){
+                return EC_UserCancelled;
+            }
+            //If food is registered, return it.
+            input = name::NameToInFileName(input);
+            if (food_index.Contains(input)){
+                food = input;
+                return EC_None;
+            }
+            //Else, look for the closest foods.
+            vector<search::s_match> matches;
+            food_index.Match(input, 10, matches);
+            //If nothing is close, retry.
+            if (matches.empty()){
+                cout << "Food doesn't exist.\n";
+                input::ConsoleWait();
+                continue;
+            }
+            //Print suggestions
+            ClearConsole;
+            cout << "Food not found. Did you mean:\n\n";
+            for (size_t i = 0; i < matches.size(); i++){
+                cout << '[' << (i + 1) << ']' << name::InFileNameToName(matches[i].name, 1) << '\n';
+            }
+            cout << '\n';
+            //Select suggestion, or retry if cancelled.
+            unsigned long chosen_f = 0;
+            if (input::GetNumericInput(&chosen_f, Mode_UIntLong) && chosen_f > 0 && chosen_f <= matches.size()){
+                food = matches[chosen_f - 1].name;
+                return EC_None;
+            }
+        } while (true);
+    }
+    /**
+     * @brief Paged food list form. Shows the user food catalog FOOD_PAGE_SIZE foods at a time, reading only the shown page, and lets the user move between pages and choose a food.
+     * @param food String that will contain the chosen in-file food name.
+     * @returns Possible ErrorCodes: EC_UserCancelled; EC_FileEmpty; EC_None;
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); food::GetFoodPage();
+    **/
+    ErrorCode user_lib::user::SelectFood(string& food){
+        //Write pending catalog changes
+        ErrorCode ec = persist::Flush(1);
+        if (ec != EC_None){
+            return ec;
+        }
+        //Cursor offsets of every visited page, the last one is the shown page.
+        vector<uint64_t> pages = {0};
+        do {
+            //Read page
+            food::s_food_cursor cursor = {pages.back(), 0};
+            vector<string> foods;
+            ec = food::GetFoodPage(username, cursor, FOOD_PAGE_SIZE, foods);
+            if (ec != EC_None){
+                return ec;
+            }
+            if (foods.empty() && pages.size() == 1){
+                return EC_FileEmpty;
+            }
+            //Print page
+            ClearConsole;
+            cout << "Foods (page " << pages.size() << "):\n\n";
+            for (size_t i = 0; i < foods.size(); i++){
+                cout << '[' << (i + 1) << ']' << name::InFileNameToName(foods[i], 1) << '\n';
+            }
+            cout << '\n';
+            //Print page commands
+            if (!cursor.end){
+                cout << "n.Next page\n";
+            }
+            if (pages.size() > 1){
+                cout << "p.Previous page\n";
+            }
+            cout << "Choose a food (leave empty to cancel): ";
+            //Get user input
+            string input;
+            if (!input::GetStringInput(SM_Command, input)){
+                return EC_UserCancelled;
+            }
+            //Move to next page
+            if (input == "n" && !cursor.end){
+                pages.push_back(cursor.offset);
+            }
+            //Move to previous page
+            else if (input == "p" && pages.size() > 1){
+                pages.pop_back();
+            }
+            //If valid index selected, save food and return.
+            else if (strings::IsNumericStr(input, Mode_UIntLong) && input.length() < 10){
+                unsigned long chosen_f = stoul(input);
+                if (chosen_f > 0 && chosen_f <= foods.size()){
+                    food = foods[chosen_f - 1];
+                    return EC_None;
+                }
+            }
+        } while (true);
+    }
     #pragma endregion
     #pragma region Macros
+    /**
+     * @brief Get today's macros from the cached totals. The day file is only read when there is no snapshot yet or the date changed; EatFood() keeps the snapshot up to date.
+     * @param today Current date.
+     * @param macros Set that will contain today's macros.
+     * @returns Possible ErrorCodes: EC_None;
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); food::GetDayMacros();
+    **/
+    ErrorCode user_lib::user::GetTodayMacros(date::s_date& today, macro_totals& macros){
+        //Refresh snapshot if missing or outdated. Pending eats are written first.
+        if (!today_ready || today.year != today_date.year || today.month != today_date.month || today.month_day != today_date.month_day){
+            today_ready = 0;
+            ErrorCode ec = persist::Flush();
+            if (ec != EC_None){
+                return ec;
+            }
+            ec = food::GetDayMacros(username, today_macros, today);
+            if (ec != EC_None){
+                return ec;
+            }
+            today_date = today;
+            today_ready = 1;
+        }
+        macros = today_macros;
+        return EC_None;
+    }
     /**
      * @brief Print macros for the current date.
      * @param timeframe Use timeframe 0 for day, 1 for week, 2 for month, 3 for year.
      * @param console_wait If true, wait for user confirmation before exit.
      * @returns Possible ErrorCodes: EC_None;
-     * @returns [OR] ErrorCodes thrown by any of this functions: GetDayMacros(); GetWeekMacros(); GetMonthMacros(); GetYearMacros();
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); GetTodayMacros(); GetWeekMacros(); GetMonthMacros(); GetYearMacros();
     **/
     ErrorCode user_lib::user::PrintCurrentMacros(const uint8_t timeframe, const bool console_wait){
-        //Create date struct
+        //Get current date
         date::s_date date;
-        //Get current date and destroy object.
-        date::calendar* t_calendar = new date::calendar();
-        t_calendar->PassDateToStruct(date);
-        delete t_calendar;
-        //Create vector
-        vector<double> macros;
-        //Get macros
+        date::calendar().PassDateToStruct(date);
+        //Create macro set
+        macro_totals macros;
+        //Get macros. Anything but today is read from files, write pending eats first.
         ErrorCode ec;
+        if (timeframe != 0){
+            ec = persist::Flush();
+            if (ec != EC_None){
+                return ec;
+            }
+        }
         switch(timeframe){
-            //Day
+            //Day (cached)
             case 0: {
                 cout << "Current day macros:\n\n";
-                ec = food::GetDayMacros(username, macros, date);
+                ec = GetTodayMacros(date, macros);
                 break;
             }
             //Week
@@ -760,17 +1174,17 @@ using namespace std::chrono;
         switch (ec){
             //If macros were retrieved, print them.
             case EC_None:{
-                for (uint8_t i = 0; i < macros.size(); i++){
-                    food::PrintMacro(i);
-                    cout << macros[i] << '\n';
+                for (uint8_t i = 0; i < nutrients::Count(); i++){
+                    PrintMacro(i);
+                    cout << fixed_point::ToDouble(macros[i]) << '\n';
                 }
                 cout << '\n';
                 break;
             }
             //If macros were not found, print "0.0" for each macro.
             case EC_ItemNotFound:{
-                for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-                    food::PrintMacro(i);
+                for (uint8_t i = 0; i < nutrients::Count(); i++){
+                    PrintMacro(i);
                     cout << 0.0 << '\n';
                 }
                 cout << '\n';
@@ -797,8 +1211,8 @@ using namespace std::chrono;
     ErrorCode user_lib::user::PrintDateMacros(const uint8_t timeframe, date::s_date& date){
         //Calculate day of the week
         date.week_day = date::CalcDayOfWeek(date.year, date.month, date.month_day);
-        //Create vector
-        vector<double> macros;
+        //Create macro set
+        macro_totals macros;
         //Get macros
         ErrorCode ec;
         switch(timeframe){
@@ -837,17 +1251,17 @@ using namespace std::chrono;
         switch (ec){
             //If macros have been retrieved, print them.
             case EC_None:{
-                for (uint8_t i = 0; i < macros.size(); i++){
-                    food::PrintMacro(i);
-                    cout << macros[i] << '\n';
+                for (uint8_t i = 0; i < nutrients::Count(); i++){
+                    PrintMacro(i);
+                    cout << fixed_point::ToDouble(macros[i]) << '\n';
                 }
                 cout << '\n';
                 break;
             }
             //If no macros were found, print "0.0" for each macro.
             case EC_ItemNotFound:{
-                for (uint8_t i = 0; i < NUM_OF_MACROS; i++){
-                    food::PrintMacro(i);
+                for (uint8_t i = 0; i < nutrients::Count(); i++){
+                    PrintMacro(i);
                     cout << 0.0 << '\n';
                 }
                 cout << '\n';
@@ -860,12 +1274,117 @@ using namespace std::chrono;
         //All good, return.
         return EC_None;
     }
+    /**
+     * @brief Top foods report. Lets the user choose a time frame (current month or year) and a ranking (times eaten or a schema nutrient), then prints the best TOP_FOODS_COUNT foods.
+     * @returns Possible ErrorCodes: EC_UserCancelled; EC_None;
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); events::TopFoods();
+    **/
+    ErrorCode user_lib::user::PrintTopFoods(){
+        uint8_t timeframe = 0, rank = 0;
+        //Select time frame
+        do {
+            ClearConsole;
+            cout << "Choose a time frame:\n\n1.Current month\n2.Current year\n\n";
+            if (!input::GetNumericInput(&timeframe, Mode_UInt8)){
+                return EC_UserCancelled;
+            }
+        } while (timeframe < 1 || timeframe > 2);
+        //Select ranking
+        do {
+            ClearConsole;
+            cout << "Rank foods by:\n\n1.Times eaten\n";
+            for (uint8_t i = 0; i < nutrients::Count(); i++){
+                cout << (i + 2) << '.' << food::GetMacroLabel(i) << '\n';
+            }
+            cout << '\n';
+            if (!input::GetNumericInput(&rank, Mode_UInt8)){
+                return EC_UserCancelled;
+            }
+        } while (rank < 1 || rank > nutrients::Count() + 1);
+        //Get date range
+        date::s_date from, to;
+        date::calendar().PassDateToStruct(from);
+        to = from;
+        from.month_day = 1;
+        if (timeframe == 2){
+            from.month = date::January;
+            to.month = date::December;
+        }
+        to.month_day = date::GetMonthLength(to.month, to.year);
+        //Write pending eats and get top foods
+        ErrorCode ec = persist::Flush();
+        if (ec != EC_None){
+            return ec;
+        }
+        vector<events::s_food_stats> top;
+        ec = events::TopFoods(username, from, to, rank == 1 ? RANK_BY_TIMES : rank - 2, TOP_FOODS_COUNT, top);
+        if (ec != EC_None){
+            return ec;
+        }
+        //Print them
+        ClearConsole;
+        cout << "Top foods (" << (timeframe == 1 ? date::MonthToStr(from.month) + '/' : "") << from.year << "):\n\n";
+        if (top.empty()){
+            cout << "No entries logged yet.\n";
+        }
+        for (size_t i = 0; i < top.size(); i++){
+            cout << '[' << (i + 1) << ']' << name::InFileNameToName(top[i].food, 1) << " - eaten " << top[i].times << " time(s)";
+            if (rank != 1){
+                cout << " - ";
+                PrintMacro(rank - 2);
+                cout << top[i].macros[rank - 2];
+            }
+            cout << '\n';
+        }
+        cout << '\n';
+        input::ConsoleWait();
+        return EC_None;
+    }
+    /**
+     * @brief Print every food eaten on a given day, in the order it was eaten (time, food, amount and calories).
+     * @param date Date to print. Week day is ignored.
+     * @returns Possible ErrorCodes: EC_None;
+     * @returns [OR] ErrorCodes thrown by events::ReadDayEvents();
+    **/
+    ErrorCode user_lib::user::PrintDayEvents(const date::s_date& date){
+        vector<events::s_event> day_events;
+        ErrorCode ec = events::ReadDayEvents(username, date, day_events);
+        if (ec != EC_None){
+            return ec;
+        }
+        //Days logged before the event log existed only have totals.
+        if (day_events.empty()){
+            cout << "No entries logged for this day.\n\n";
+            return EC_None;
+        }
+        cout << "Entries:\n\n";
+        for (const events::s_event& event : day_events){
+            //Print time
+            char time_str[6];
+            time_t event_time = event.timestamp;
+            strftime(time_str, sizeof(time_str), "%H:%M", localtime(&event_time));
+            cout << '[' << time_str << "] ";
+            //Print food and amount
+            cout << name::InFileNameToName(string(event.food, strnlen(event.food, MAX_FOOD_NAME)), 1) << " - " << event.amount;
+            cout << (event.portions ? " portion(s) - " : "g - ");
+            //Print calories
+            PrintMacro(0);
+            cout << event.macros[0] << '\n';
+        }
+        cout << '\n';
+        return EC_None;
+    }
     /**
      * @brief Allow user to navigate through its history with menu.
      * @returns Possible ErrorCodes: EC_DirNotFound; EC_UserCancelled;
-     * @returns [OR] ErrorCodes thrown by any of this functions: PrintDateMacros();
+     * @returns [OR] ErrorCodes thrown by any of this functions: persist::Flush(); PrintDateMacros(); PrintDayEvents(); filemanager::ReadYearMap();
     **/
     ErrorCode user_lib::user::BrowseHistory(){
+        //Write pending eats
+        ErrorCode ec = persist::Flush();
+        if (ec != EC_None){
+            return ec;
+        }
         //Load user data folder
         filesystem::path usr_p = user_folder(username);
         //If folder does not exist or is empty, we cancel
@@ -882,73 +1401,39 @@ using namespace std::chrono;
         date::s_date date;
         do {
             ClearConsole;
-            //Prepare error code
-            ErrorCode ec;
             //Prepare a vector of entries.
             vector<int> entries;
-            //Construct current path (cp)
-            filesystem::path cp = usr_p;
-            //If selecting month, append year
-            if (mode == 2){
-                cp.append(to_string(date.year));
-            }
-            //If selecting day, append year and month.
-            else if (mode == 3){
-                cp.append(to_string(date.year));
-                cp.append(to_string(date.month));
-            }
-            //Fill entries vector
-            for (const auto& entry : filesystem::directory_iterator(cp)) {
-                //If entry is a non empty folder
-                if (filesystem::is_directory(entry.path()) && !filesystem::is_empty(entry.path())){
-                    //Get folder name
-                    string tmp_dir = entry.path().filename().string();
-                    switch (mode){
-                        //If looking for a year folder.                        
-                        case 1: {
-                            //If folder is numeric string (Int), save it.
-                            if (strings::IsNumericStr(tmp_dir, Mode_Int)){
-                                entries.push_back(stoi(tmp_dir));
-                            }
-                        }
-                        //If looking for a month folder
-                        case 2: {
-                            //If folder is numeric string (Uint8).
-                            if (strings::IsNumericStr(tmp_dir, Mode_UInt8)){
-                                //And is a valid month number (1 to 12), save it.
-                                if (stoul(tmp_dir) > 0 && stoul(tmp_dir) <= 12){
-                                    entries.push_back(stoi(tmp_dir));
-                                }
-                            }
-                        }
-                        //If looking for a day folder
-                        case 3: {
-                            //If folder is numeric string (Uint8).
-                            if (strings::IsNumericStr(tmp_dir, Mode_UInt8)){
-                                //And is a valid month day number (1 to month_length).
-                                if (stoul(tmp_dir) > 0 && stoul(tmp_dir) <= date::GetMonthLength(date.month, date.year)){
-                                    //Get current day and week day
-                                    date.month_day = stoul(tmp_dir);
-                                    date.week_day = date::CalcDayOfWeek(date.year, date.month, date.month_day);
-                                    //Construct file path
-                                    filesystem::path day_dat = entry.path();
-                                    day_dat.append(to_string(date.week_day) + "_day.dat");
-                                    //If file exists and it is a file, validate it.
-                                    if (filesystem::exists(day_dat) && !filesystem::is_directory(day_dat)){
-                                        ec = filemanager::DayDataCheck(day_dat);
-                                        //If file is not valid, return error.
-                                        if (ec != EC_None){
-                                            return ec;
-                                        }
-                                        //We passed the validation, save entry.
-                                        entries.push_back(stoi(tmp_dir));
-                                        break;
-                                    }                                    
-                                }
+            //If selecting a year, every year with data has a presence map.
+            if (mode == 1){
+                int year;
+                for (const auto& entry : filesystem::directory_iterator(usr_p)){
+                    if (entry.is_regular_file() && filemanager::IsYearFileName(entry.path().filename().string(), "_days.map", &year)){
+                        entries.push_back(year);
+                    }
+                }
+            }
+            //Else, get months or days with data from the year presence map.
+            else {
+                filemanager::year_map days;
+                ec = filemanager::ReadYearMap(username, date.year, days);
+                if (ec != EC_None && ec != EC_FileNotFound){
+                    return ec;
+                }
+                for (uint8_t m = date::January; m <= date::December; m++){
+                    //If selecting days, only check selected month.
+                    if (mode == 3 && m != date.month){
+                        continue;
+                    }
+                    for (uint8_t d = 1; d <= date::GetMonthLength(static_cast<date::month_name>(m), date.year); d++){
+                        //Save month (once) or day
+                        if (days[date::GetYearDay(date.year, static_cast<date::month_name>(m), d)]){
+                            entries.push_back(mode == 2 ? m : d);
+                            if (mode == 2){
+                                break;
                             }
                         }
-                    }             
-                }                
+                    }
+                }
             }
             //If no valid entries are found, switch on mode
             if (entries.empty()){
@@ -1070,6 +1555,11 @@ using namespace std::chrono;
                             if (ec != EC_None){
                                 return ec;
                             }
+                            //Print what was eaten that day
+                            ec = PrintDayEvents(date);
+                            if (ec != EC_None){
+                                return ec;
+                            }
                             //Wait for user input
                             input::ConsoleWait();
                             break;
@@ -1088,141 +1578,22 @@ using namespace std::chrono;
     #pragma endregion
 #pragma endregion
 #pragma region Free Functions
-/**
- * @brief Checks if an username is already taken (written inside users.dat). User name will be converted to in-file name inside this function.
- * @param name Name we want to check. It will be transformed into an in-file name.
- * @return Possible ErrorCodes: EC_FileReadNoPerm; EC_ItemFound; EC_ItemNotFound;
- * @return [OR] ErrorCodes thrown by any of this functions: filemanager::UsersDataCheck();
-**/
-ErrorCode user_lib::IsUsernameTaken(const string& name){
-    //Validate users.dat
-    ErrorCode ec = filemanager::UsersDataCheck();
-    if (ec == EC_FileEmpty){
-        return EC_ItemNotFound;
-    }
-    else if (ec != EC_None){
-        return ec;
-    }   
-    //Check if username already registered.
-    ifstream data_in;
-    data_in.open(users_dat_p);
-    if (!data_in.is_open()){
-        return EC_FileReadNoPerm;
-    }
-    //Get data
-    string data;
-    while(getline(data_in, data, '|')){
-        //Remove brackets
-        strings::RemoveBrackets(data);
-        //Evaluate
-        if (data == name::NameToInFileName(name)){
-            data_in.close();
-            return EC_ItemFound;
-        }
-    }
-    //Username not taken, close and return.
-    data_in.close();
-    return EC_ItemNotFound;
-}
-/**
- * @brief Register a new user inside users.dat. User name will be converted to in-file name inside this function.
- * @param name Name we want to register. This must be an user friendly name, that will be transformed later on into an in-file name.
- * @return Possible ErrorCodes: EC_FileNotFound; EC_FileWriteNoPerm;
- * @return [OR] ErrorCodes thrown by any of this functions: filemanager::UsersDataCheck(); filemanager::CreateTempFile(); filemanager::SafeDeleteFile();
- * @warning This function does NOT check if username is taken, this must be manually done before.
-**/
-ErrorCode user_lib::RegisterNewUser(const string& name){
-    filesystem::path usersdat_p = users_dat_p;
-    //If user data does not exist, return error
-    if (!filesystem::exists(usersdat_p)){
-        return EC_FileNotFound;
-    }
-    //Validate users.dat
-    ErrorCode ec = filemanager::UsersDataCheck();
-    if (ec != EC_None && ec != EC_FileEmpty){
-        return ec;
-    }
-    //Register new user
-    else {
-        ofstream data_out;
-        //If data is empty, open it straight.
-        if (ec == EC_FileEmpty){
-            data_out.open(usersdat_p);
-            //If we could not open the file, return error.
-            if (!data_out.is_open()){
-                return EC_FileWriteNoPerm;
-            }
-            //Write name to file and close
-            data_out << strings::DataToFile(name);
-            data_out.close();
-        }
-        //If data is not empty, create temp file and open the original file in app mode.
-        else {
-            filesystem::path usersdat_tmp;
-            filemanager::CreateTempFile(usersdat_p, usersdat_tmp);            
-            data_out.open(usersdat_p, std::ofstream::app);
-            //If we could not open the file, delete the temp file and return error.
-            if (!data_out.is_open()){
-                ec = filemanager::SafeDeleteFile(usersdat_tmp);
-                if (ec != EC_None){
-                    return ec;
-                }
-                return EC_FileWriteNoPerm;
-            }
-            //Write name to file and close
-            data_out << strings::DataToFile(name);
-            data_out.close();
-            //Delete temp file.
-            ec = filemanager::SafeDeleteFile(usersdat_tmp);
-            if (ec != EC_None){
-                return ec;
-            }            
-        }
-    }
-    return EC_None;
-}
 /**
  * @brief Prints all users and returns a vector with all found usernames. This function is meant to be a precursor to any log in selection.
  * @param all_users Vector of strings to dump valid usernames.
- * @return Possible ErrorCodes: EC_FileNotFound; EC_FileReadNoPerm; EC_None;
- * @return [OR] ErrorCodes thrown by any of this functions: filemanager::UsersDataCheck();
+ * @return Possible ErrorCodes: EC_None;
+ * @return [OR] ErrorCodes thrown by GetAllUsers();
 **/
 ErrorCode user_lib::PrintAllUsers(vector<string>& all_users){
-    //Clear vector
-    all_users.clear();
-    //If user data is not found, return error.
-    if (!filesystem::exists(users_dat_p)){
-        return EC_FileNotFound;
-    }
-    //Validate users.dat
-    ErrorCode ec = filemanager::UsersDataCheck();
+    //Get user names
+    ErrorCode ec = GetAllUsers(all_users);
     if (ec != EC_None){
         return ec;
     }
-    //Open user data
-    ifstream data_in;
-    data_in.open(users_dat_p);
-    if (!data_in.is_open()){
-        return EC_FileReadNoPerm;
-    }
-    //Retrieve and print user names
-    string tmp_data;
-    uint8_t i = 0;
-    while(getline(data_in, tmp_data, '|')){
-        //If not at the end of file
-        if (!data_in.eof()){
-            //Remove brackets
-            tmp_data = tmp_data.substr(1, tmp_data.size() - 2);            
-            //Print user number and name
-            cout << '[' + to_string(i + 1) + ']' + name::InFileNameToName(tmp_data, 2) + '\n';
-            //Save user name
-            all_users.push_back(tmp_data);
-            //Set last index
-            i++;
-        }
+    //Print user number and name
+    for (size_t i = 0; i < all_users.size(); i++){
+        cout << '[' + to_string(i + 1) + ']' + name::InFileNameToName(all_users[i], 2) + '\n';
     }
-    //Close file and return
-    data_in.close();
     return EC_None;
 }
 #pragma endregion
\ No newline at end of file
@@ -2,13 +2,21 @@
 using namespace std;
 #include <string>
 #include <vector>
+#include <filesystem>
 #include "../errors/errors.h"
 #include "../io/io_fb.h"
+#include "../io/console.h"
 using namespace io_fb;
 #include "../date/date.h"
+#include "../search/search.h"
+#include "users.h"
 
 //User amount fits inside uint8_t. Be mindful about it if you want to bump this number! You might need to change some (uint8_t)s scattered among the codebase.
 #define MAX_USERS 255
+//Amount of foods shown per page in food lists.
+#define FOOD_PAGE_SIZE 20
+//Amount of foods shown in top foods reports.
+#define TOP_FOODS_COUNT 10
 
 namespace user_lib {
 #pragma region User Class
@@ -17,25 +25,32 @@ class user {
     //Public
     public:
     ErrorCode LoadUser(const string& usrname);
-    void LogOut();
+    ErrorCode LogOut();
     ErrorCode DeleteUser();
     ErrorCode RestoreData();
     ErrorCode BackupFiles();
     string GetUserName();
+    ErrorCode SyncDataChanges();
     //Private
     private:
     string username = "";
-    ErrorCode CreateUserFiles();
-    ErrorCode CreateDailyData();
+    ErrorCode RestoreArchive(const filesystem::path& archive_p);
     #pragma endregion
     #pragma region Macros
     //Public
     public:
     ErrorCode PrintCurrentMacros(const uint8_t timeframe, const bool console_wait = 1);
     ErrorCode BrowseHistory();
+    ErrorCode PrintTopFoods();
     //Private
     private:
+    //Snapshot of today's totals, so menu redraws do not touch the day file.
+    macro_totals today_macros;
+    date::s_date today_date;
+    bool today_ready = 0;
+    ErrorCode GetTodayMacros(date::s_date& today, macro_totals& macros);
     ErrorCode PrintDateMacros(const uint8_t timeframe, date::s_date& date);
+    ErrorCode PrintDayEvents(const date::s_date& date);
     #pragma endregion
     #pragma region Food
     //Public
@@ -45,12 +60,18 @@ class user {
     ErrorCode ModifyFood(string* food = NULL);
     ErrorCode RegisterFood();
     ErrorCode RemoveFood();
+    ErrorCode ConvertFoodBook();
+    //Private
+    private:
+    search::name_index food_index;
+    bool food_index_ready = 0;
+    ErrorCode LoadFoodIndex();
+    ErrorCode SearchFood(string& food);
+    ErrorCode SelectFood(string& food);
     #pragma endregion
 };
 #pragma endregion
 #pragma region Free Functions
-ErrorCode RegisterNewUser(const string& name);
-ErrorCode IsUsernameTaken(const string& name);
 ErrorCode PrintAllUsers(vector<string>& all_users);
 #pragma endregion
 }
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include <filesystem>
+#include <fstream>
+#include "users.h"
+#include "../food/food.h"
+#include "../filemanager/filemanager.h"
+#include "../latency/latency.h"
+
+#pragma region Public Functions
+/**
+ * @brief Checks if an username is already taken (written inside users.dat). User name will be converted to in-file name inside this function.
+ * @param name Name we want to check. It will be transformed into an in-file name.
+ * @return Possible ErrorCodes: EC_FileReadNoPerm; EC_ItemFound; EC_ItemNotFound;
+ * @return [OR] ErrorCodes thrown by any of this functions: filemanager::UsersDataCheck();
+**/
+ErrorCode user_lib::IsUsernameTaken(const string& name){
+    latency::phase_scope phase(latency::PH_Parse);
+    //Validate users.dat
+    ErrorCode ec = filemanager::UsersDataCheck();
+    if (ec == EC_FileEmpty){
+        return EC_ItemNotFound;
+    }
+    else if (ec != EC_None){
+        return ec;
+    }   
+    //Check if username already registered.
+    ifstream data_in;
+    data_in.open(users_dat_p);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    //Get data
+    string data;
+    while(getline(data_in, data, '|')){
+        //Remove brackets
+        strings::RemoveBrackets(data);
+        //Evaluate
+        if (data == name::NameToInFileName(name)){
+            data_in.close();
+            return EC_ItemFound;
+        }
+    }
+    //Username not taken, close and return.
+    data_in.close();
+    return EC_ItemNotFound;
+}
+/**
+ * @brief Register a new user inside users.dat. User name will be converted to in-file name inside this function.
+ * @param name Name we want to register. This must be an user friendly name, that will be transformed later on into an in-file name.
+ * @return Possible ErrorCodes: EC_FileNotFound; EC_None;
+ * @return [OR] ErrorCodes thrown by any of this functions: filemanager::UsersDataCheck(); filemanager::ReadFileData(); filemanager::CommitFile();
+ * @warning This function does NOT check if username is taken, this must be manually done before.
+**/
+ErrorCode user_lib::RegisterNewUser(const string& name){
+    filesystem::path usersdat_p = users_dat_p;
+    //If user data does not exist, return error
+    if (!filesystem::exists(usersdat_p)){
+        return EC_FileNotFound;
+    }
+    //Validate users.dat
+    ErrorCode ec = filemanager::UsersDataCheck();
+    if (ec != EC_None && ec != EC_FileEmpty){
+        return ec;
+    }
+    //If data is not empty, read current users.
+    string users_data;
+    if (ec != EC_FileEmpty){
+        ec = filemanager::ReadFileData(usersdat_p, users_data);
+        if (ec != EC_None){
+            return ec;
+        }
+    }
+    //Append name and commit users.dat
+    users_data += strings::DataToFile(name);
+    ec = filemanager::CommitFile(usersdat_p, users_data);
+    if (ec != EC_None){
+        return ec;
+    }
+    return EC_None;
+}
+/**
+ * @brief Get every registered user. This function is meant to be a precursor to any log in selection.
+ * @param all_users Vector of strings to dump valid in-file usernames, in register order. It will be cleared.
+ * @return Possible ErrorCodes: EC_FileNotFound; EC_FileReadNoPerm; EC_None;
+ * @return [OR] ErrorCodes thrown by any of this functions: filemanager::UsersDataCheck();
+**/
+ErrorCode user_lib::GetAllUsers(vector<string>& all_users){
+    latency::phase_scope phase(latency::PH_Parse);
+    //Clear vector
+    all_users.clear();
+    //If user data is not found, return error.
+    if (!filesystem::exists(users_dat_p)){
+        return EC_FileNotFound;
+    }
+    //Validate users.dat
+    ErrorCode ec = filemanager::UsersDataCheck();
+    if (ec != EC_None){
+        return ec;
+    }
+    //Open user data
+    ifstream data_in;
+    data_in.open(users_dat_p);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    //Retrieve user names
+    string tmp_data;
+    while(getline(data_in, tmp_data, '|')){
+        //If not at the end of file
+        if (!data_in.eof()){
+            //Remove brackets and save user name
+            strings::RemoveBrackets(tmp_data);
+            all_users.push_back(tmp_data);
+        }
+    }
+    //Close file and return
+    data_in.close();
+    return EC_None;
+}
+/**
+ * @brief Creates user folder and user foods data if missing. Day data is not created here, it is written on the first eat of each day (a missing day reads as zero).
+ * @param username In-file name of the user.
+ * @returns Possible ErrorCodes: EC_DirCreateNoPerm; EC_FileWriteNoPerm; EC_None;
+**/
+ErrorCode user_lib::CreateUserFiles(const string& username){
+    //Create user folder
+    if (!filesystem::exists(user_folder(username))){
+        error_code f_ec;
+        if (!filesystem::create_directories(user_folder(username), f_ec)){
+            return EC_DirCreateNoPerm;
+        }
+    }
+    //Create personal food (unless the user has a binary catalog)
+    if (!filesystem::exists(foods_dat(username)) && !food::IsCatalogBinary(username)){
+        ofstream data_out;
+        data_out.open(foods_dat(username));
+        if (!data_out.is_open()){
+            return EC_FileWriteNoPerm;
+        }
+        data_out.close();
+    }
+    return EC_None;
+}
+/**
+ * @brief Delete every file of an user and remove its name from users.dat.
+ * @param username In-file name of the user.
+ * @returns Possible ErrorCodes: EC_FileReadNoPerm; EC_None;
+ * @returns [OR] ErrorCodes thrown by any of this functions: filemanager::SafeDeleteFolder(); filemanager::UsersDataCheck(); filemanager::CommitFile();
+ * @warning Files can not be recovered afterwards. Back them up first if needed.
+**/
+ErrorCode user_lib::RemoveUser(const string& username){
+    //Delete user files
+    filesystem::path mut_path = user_folder(username);
+    ErrorCode ec = filemanager::SafeDeleteFolder(mut_path);
+    if (ec != EC_None){
+        return ec;
+    }
+    //Check if users.dat is valid
+    ec = filemanager::UsersDataCheck();
+    if (ec != EC_None){
+        return ec;
+    }
+    //Open users.dat to read
+    mut_path = users_dat_p;
+    ifstream data_in;
+    data_in.open(mut_path);
+    if (!data_in.is_open()){
+        return EC_FileReadNoPerm;
+    }
+    //Gather data skipping target name
+    string data, users_data;
+    while (getline(data_in, data, '|')){
+        //Remove brackets
+        strings::RemoveBrackets(data);
+        //If data is not username, keep it.
+        if (data != username){
+            users_data += strings::DataToFile(data);
+        }
+    }
+    data_in.close();
+    //Commit users.dat
+    return filemanager::CommitFile(mut_path, users_data);
+}
+#pragma endregion
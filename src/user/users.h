@@ -0,0 +1,20 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <vector>
+#include "../errors/errors.h"
+#include "../io/io_fb.h"
+using namespace io_fb;
+
+#ifndef _USERS_
+#define _USERS_
+namespace user_lib {
+#pragma region Public Function Headers
+ErrorCode RegisterNewUser(const string& name);
+ErrorCode IsUsernameTaken(const string& name);
+ErrorCode GetAllUsers(vector<string>& all_users);
+ErrorCode CreateUserFiles(const string& username);
+ErrorCode RemoveUser(const string& username);
+#pragma endregion
+}
+#endif
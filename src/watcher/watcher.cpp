@@ -0,0 +1,246 @@
+#include <iostream>
+using namespace std;
+#include <string>
+#include <filesystem>
+namespace fs = filesystem;
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <map>
+#include "watcher.h"
+using namespace watcher;
+#include "../io/io_fb.h"
+using namespace io_fb;
+namespace fm = filemanager;
+#if LINUX
+#include <unordered_map>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#pragma region Internal Use Functions
+//Watcher thread, its stop request and the changes it found (guarded by c_mutex).
+static thread c_thread;
+static atomic<bool> c_stop;
+static mutex c_mutex;
+static vector<s_invalidation> c_changes;
+/**
+ * @brief Data file as this program last wrote it (see NoteWrites()).
+ * @param size (uintmax_t) File size right after the write.
+ * @param write_time (filesystem::file_time_type) Last write time right after the write.
+**/
+typedef struct {
+    uintmax_t size;
+    fs::file_time_type write_time;
+} s_own_write;
+//Files written by this program, by normalized path (guarded by c_mutex).
+static map<string, s_own_write> c_own_writes;
+/**
+ * @brief Get the size and last write time of a file.
+ * @param file_p Path to file.
+ * @param stamp Struct that will contain size and write time.
+ * @returns 1(true) if the file exists and could be read, 0(false) if not.
+**/
+bool GetStamp(const fs::path& file_p, s_own_write& stamp){
+    error_code f_ec;
+    stamp.size = fs::file_size(file_p, f_ec);
+    if (f_ec){
+        return 0;
+    }
+    stamp.write_time = fs::last_write_time(file_p, f_ec);
+    return !f_ec;
+}
+#if LINUX
+//Events that may replace, create or remove a watched file or folder.
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE)
+//Buffer for inotify events, big enough for several events with file names.
+#define WATCH_BUFFER 4096
+/**
+ * @brief Get today's date. Unlike date::calendar, it is safe to call from the watcher thread (localtime_r).
+ * @param today Struct that will contain today's date.
+**/
+void Today(date::s_date& today){
+    time_t epoch_time = chrono::system_clock::to_time_t(chrono::system_clock::now());
+    tm time_local;
+    localtime_r(&epoch_time, &time_local);
+    today.year = time_local.tm_year + 1900;
+    today.month = static_cast<date::month_name>(time_local.tm_mon + 1);
+    today.month_day = time_local.tm_mday;
+    today.week_day = time_local.tm_wday == 0 ? date::Sunday : static_cast<date::wday_name>(time_local.tm_wday);
+}
+/**
+ * @brief Queue a change for the main thread. Changes already waiting for the same file are not queued twice.
+ * @param change Change to queue.
+**/
+void PushChange(const s_invalidation& change){
+    lock_guard<mutex> lock(c_mutex);
+    for (s_invalidation& c : c_changes){
+        if (c.path == change.path){
+            return;
+        }
+    }
+    c_changes.push_back(change);
+}
+/**
+ * @brief Watcher thread. Watches the data folder (users.dat), the user folder (food catalogs) and today's year, month and day folders (today's day file), and queues a change for every watched file that is written, replaced or removed.
+ * @param fd Inotify file descriptor. Closed when the thread ends.
+ * @param username In-file name of the watched user.
+**/
+void WatchLoop(const int fd, const string username){
+    unordered_map<int, fs::path> folders;
+    fs::path user_f = user_folder(username);
+    //Watch data and user folders
+    for (const fs::path& folder : {fs::path(data_f), user_f}){
+        int wd = inotify_add_watch(fd, folder.c_str(), WATCH_MASK);
+        if (wd >= 0){
+            folders[wd] = folder;
+        }
+    }
+    //Today's folders are (re)watched when the date changes or a folder is created.
+    date::s_date today = {}, now;
+    vector<int> day_wds;
+    fs::path day_p;
+    bool rescan = 1;
+    char buffer[WATCH_BUFFER] __attribute__((aligned(__alignof__(inotify_event))));
+    while (!c_stop){
+        //Check date
+        Today(now);
+        if (now.year != today.year || now.month != today.month || now.month_day != today.month_day){
+            today = now;
+            day_p = fm::GetDateDataPath(username, today);
+            for (int wd : day_wds){
+                inotify_rm_watch(fd, wd);
+                folders.erase(wd);
+            }
+            day_wds.clear();
+            rescan = 1;
+        }
+        //Watch today's folders that exist and are not watched yet
+        if (rescan){
+            rescan = 0;
+            for (const fs::path& folder : {day_p.parent_path().parent_path().parent_path(), day_p.parent_path().parent_path(), day_p.parent_path()}){
+                if (!fs::is_directory(folder)){
+                    break;
+                }
+                int wd = inotify_add_watch(fd, folder.c_str(), WATCH_MASK);
+                if (wd >= 0 && !folders.contains(wd)){
+                    folders[wd] = folder;
+                    day_wds.push_back(wd);
+                }
+            }
+        }
+        //Wait for events
+        pollfd p_fd = {fd, POLLIN, 0};
+        if (poll(&p_fd, 1, WATCH_POLL_MS) <= 0){
+            continue;
+        }
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0){
+            continue;
+        }
+        //Translate events into changes
+        for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + ((inotify_event*)ptr)->len){
+            const inotify_event* event = (const inotify_event*)ptr;
+            if (event->mask & IN_IGNORED){
+                folders.erase(event->wd);
+                continue;
+            }
+            if (event->len == 0 || !folders.contains(event->wd)){
+                continue;
+            }
+            const fs::path& folder = folders[event->wd];
+            string fname = event->name;
+            //A new folder may be one of today's folders.
+            if (event->mask & IN_ISDIR){
+                rescan = 1;
+            }
+            else if (folder == fs::path(data_f) && fname == "users.dat"){
+                PushChange({fm::users_dat, folder / fname, today});
+            }
+            else if (folder == user_f && (fname == username + "_foods.dat" || fname == username + "_foods.bin")){
+                PushChange({fm::usr_foods_dat, folder / fname, today});
+            }
+            else if (folder == day_p.parent_path() && fname == day_p.filename().string()){
+                PushChange({fm::x_day_dat, day_p, today});
+            }
+        }
+    }
+    close(fd);
+}
+#endif
+#pragma endregion
+#pragma region Public Functions
+/**
+ * @brief Start watching the data files of an user for changes made from outside the program (sync tools, restores from other machines...). Any previous watch is stopped. Linux only (inotify); elsewhere it does nothing.
+ * @param username In-file name of the user to watch.
+ * @returns 1(true) if the watcher is running, 0(false) if it could not start (changes will simply go unnoticed).
+**/
+bool watcher::Start(const string& username){
+    Stop();
+    #if LINUX
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0){
+        return 0;
+    }
+    c_stop = 0;
+    c_thread = thread(WatchLoop, fd, username);
+    return 1;
+    #else
+    return 0;
+    #endif
+}
+/**
+ * @brief Stop watching and drop any change not polled yet, and every write noted.
+**/
+void watcher::Stop(){
+    if (c_thread.joinable()){
+        c_stop = 1;
+        c_thread.join();
+    }
+    lock_guard<mutex> lock(c_mutex);
+    c_changes.clear();
+    c_own_writes.clear();
+}
+/**
+ * @brief Take every change found since the last poll. It never blocks on the file system.
+ * @param changes Vector that will contain the changes, in the order they were found. It will be cleared.
+**/
+void watcher::Poll(vector<s_invalidation>& changes){
+    changes.clear();
+    lock_guard<mutex> lock(c_mutex);
+    changes.swap(c_changes);
+}
+/**
+ * @brief Note files this program just wrote, with their size and write time, so the changes the watcher finds for them can be told apart from outside changes (see DropOwnWrites()). Call it once the files are written.
+ * @param paths Paths to the written files.
+**/
+void watcher::NoteWrites(const vector<filesystem::path>& paths){
+    lock_guard<mutex> lock(c_mutex);
+    for (const fs::path& p : paths){
+        s_own_write stamp;
+        if (GetStamp(p, stamp)){
+            c_own_writes[p.lexically_normal().generic_string()] = stamp;
+        }
+        else {
+            c_own_writes.erase(p.lexically_normal().generic_string());
+        }
+    }
+}
+/**
+ * @brief Drop the changes made by this program: files that still have the size and write time they had when this program last wrote them (see NoteWrites()). Removed files are always kept as changes.
+ * @param changes Changes taken by Poll(). Only outside changes are left, in the same order.
+ * @warning Pending writes must be finished (persist::Flush()) first, or their changes may be kept.
+**/
+void watcher::DropOwnWrites(vector<s_invalidation>& changes){
+    lock_guard<mutex> lock(c_mutex);
+    erase_if(changes, [](const s_invalidation& c){
+        s_own_write stamp;
+        map<string, s_own_write>::iterator it = c_own_writes.find(c.path.lexically_normal().generic_string());
+        return it != c_own_writes.end() && GetStamp(c.path, stamp) && stamp.size == it->second.size && stamp.write_time == it->second.write_time;
+    });
+}
+#pragma endregion
@@ -0,0 +1,33 @@
+#include "../errors/errors.h"
+#include "../filemanager/filemanager.h"
+#include <filesystem>
+#include <vector>
+
+#ifndef _WATCHER_
+#define _WATCHER_
+
+namespace watcher {
+#pragma region Data
+//Milliseconds the watcher thread waits for changes before checking for a stop request or a date change.
+#define WATCH_POLL_MS 250
+/**
+ * @brief Data file changed outside the program (or by it, until DropOwnWrites() tells them apart).
+ * @param type (filemanager::files) File type: users_dat, usr_foods_dat (text or binary catalog) or x_day_dat.
+ * @param path (filesystem::path) Path to the changed file.
+ * @param date (date::s_date) Day the file belongs to (x_day_dat only).
+**/
+typedef struct {
+    filemanager::files type;
+    filesystem::path path;
+    date::s_date date;
+} s_invalidation;
+#pragma endregion
+#pragma region Public Function Headers
+bool Start(const string& username);
+void Stop();
+void Poll(vector<s_invalidation>& changes);
+void NoteWrites(const vector<filesystem::path>& paths);
+void DropOwnWrites(vector<s_invalidation>& changes);
+#pragma endregion
+}
+#endif